@@ -0,0 +1,11 @@
+$input v_normal, v_texcoord0
+
+#include <bgfx_shader.sh>
+
+void main()
+{
+    // Simple directional light so the shape reads without textures.
+    vec3 lightDir = normalize(vec3(0.4, 1.0, 0.6));
+    float diffuse = max(dot(normalize(v_normal), lightDir), 0.0);
+    gl_FragColor = vec4(vec3_splat(0.3 + 0.5 * diffuse), 1.0);
+}
@@ -0,0 +1,13 @@
+$input a_position, a_normal, a_texcoord0, i_data0, i_data1, i_data2, i_data3
+$output v_normal, v_texcoord0
+
+#include <bgfx_shader.sh>
+
+void main()
+{
+    mat4 model = mtxFromCols(i_data0, i_data1, i_data2, i_data3);
+    vec4 worldPos = mul(model, vec4(a_position, 1.0));
+    gl_Position = mul(u_viewProj, worldPos);
+    v_normal = mul(model, vec4(a_normal, 0.0)).xyz;
+    v_texcoord0 = a_texcoord0;
+}
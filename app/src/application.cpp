@@ -11,8 +11,10 @@
  */
 
 #include "application.h"
+#include <nyanchu/profiler.h>
 #include <iostream>
 #include <chrono>
+#include <cstdlib>
 #include "platform_utils.h"
 
 #define GLM_FORCE_RADIANS
@@ -31,17 +33,38 @@ Application::~Application()
     // calling the Engine's destructor which now handles shutdown.
 }
 
-bool Application::initialize()
+bool Application::initialize(int argc, char** argv)
 {
-    m_engine->init();
+    nyanchu::EngineConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const std::string option = argv[i];
+        if (option == "--headless") {
+            config.headless = true;
+        } else if (option == "--frames" && i + 1 < argc) {
+            m_maxFrames = std::strtoull(argv[++i], nullptr, 10);
+        }
+    }
+    m_engine->init(config);
 
     std::string executableDir = getExecutableDir();
     std::string modelPath = executableDir + "/materials/model(1).obj";
 
     m_engine->playBgm("materials/bgm.wav");
-    m_mesh = std::make_unique<nyanchu::Mesh>(modelPath.c_str());
+    m_mesh = m_engine->getAssets().loadMesh(modelPath);
+    // The model stays at the origin and is drawn by the ECS once it has loaded.
+    m_engine->getECS().spawn(nyanchu::Transform{}, m_mesh);
 
     m_engine->cursor_disable();
+    m_cameraPos = m_prevCameraPos = m_engine->getCamera().getPosition();
+
+    for (int i = 1; i + 1 < argc; ++i) {
+        const std::string option = argv[i];
+        if (option == "--record") {
+            if (!m_engine->startRecording(argv[++i])) return false;
+        } else if (option == "--replay") {
+            if (!m_engine->startReplay(argv[++i])) return false;
+        }
+    }
     return true;
 }
 
@@ -52,22 +75,41 @@ void Application::run()
 
     // For FPS calculation
     float timeAccumulator = 0.0f;
+    int framesThisSecond = 0;
 
     float cameraSpeed = 2.5f;
     float mouseSensitivity = 0.1f;
 
 
     float frame = 0.0f;
+    uint64_t frameCount = 0;
     while (m_engine->isRunning())
     {
+        if (m_maxFrames != 0 && frameCount++ >= m_maxFrames) {
+            m_engine->quit();
+            break;
+        }
+        m_engine->pollEvents();
+        // Movement runs on the engine's fixed steps, so it is identical at any
+        // frame rate and in replays; the FPS counter keeps measuring wall time.
+        const uint32_t steps = m_engine->getSimulationSteps();
+        const float stepTime = m_engine->getFixedDeltaTime();
+
         auto currentTime = clock::now();
-        float deltaTime = std::chrono::duration<float>(currentTime - lastFrameTime).count();
+        float frameTime = std::chrono::duration<float>(currentTime - lastFrameTime).count();
         lastFrameTime = currentTime;
 
-        m_engine->pollEvents();
+        timeAccumulator += frameTime;
+        ++framesThisSecond;
+        if (timeAccumulator >= 1.0f) {
+            std::cout << "FPS: " << framesThisSecond << " (" << 1000.0f * timeAccumulator / framesThisSecond << " ms/frame)" << std::endl;
+            timeAccumulator = 0.0f;
+            framesThisSecond = 0;
+        }
 
         // --- Input and Camera Control ---
         {
+            NYANCHU_PROFILE_SCOPE("Application::input");
             auto& input = m_engine->getInput();
             auto& camera = m_engine->getCamera();
             glm::vec3 front(camera.getFront().x, 0.0f, camera.getFront().z);
@@ -75,19 +117,42 @@ void Application::run()
 
             glm::vec3 right = glm::normalize(glm::cross(front, glm::vec3(0.0f, 1.0f, 0.0f)));
 
+            glm::vec3 velocity(0.0f);
             if (input.IsKeyDown(GLFW_KEY_W))
-                camera.MoveCamera(front * cameraSpeed * deltaTime);
+                velocity += front;
             if (input.IsKeyDown(GLFW_KEY_S))
-                camera.MoveCamera(-front * cameraSpeed * deltaTime);
+                velocity -= front;
             if (input.IsKeyDown(GLFW_KEY_A))
-                camera.MoveCamera(-right * cameraSpeed * deltaTime);
+                velocity -= right;
             if (input.IsKeyDown(GLFW_KEY_D))
-                camera.MoveCamera(right * cameraSpeed * deltaTime);
+                velocity += right;
+            velocity *= cameraSpeed;
+
+            for (uint32_t step = 0; step < steps; ++step) {
+                m_prevCameraPos = m_cameraPos;
+                m_cameraPos += velocity * stepTime;
+            }
+            camera.SetCameraPosition(glm::mix(m_prevCameraPos, m_cameraPos, m_engine->getInterpolationAlpha()));
 
 
             if (input.IsKeyDown(GLFW_KEY_Q))
                 m_engine->cursor_able();
 
+            // Dump the recent frames for chrome://tracing or ui.perfetto.dev
+            if (input.IsKeyPressed(GLFW_KEY_F12)) {
+                const std::string tracePath = getExecutableDir() + "/frame_trace.json";
+                if (nyanchu::Profiler::writeChromeTrace(tracePath))
+                    std::cout << "Wrote " << tracePath << std::endl;
+            }
+
+            // Pick whatever is under the crosshair
+            if (input.IsMouseButtonPressed(GLFW_MOUSE_BUTTON_LEFT)) {
+                const nyanchu::Ray ray{ camera.getPosition(), glm::normalize(camera.getFront()) };
+                nyanchu::PickHit hit;
+                if (m_engine->getECS().raycast(ray, 1000.0f, hit))
+                    std::cout << "Picked entity " << hit.entity.id() << " triangle " << hit.triangle << " at " << hit.distance << std::endl;
+            }
+
             // Rotation
             glm::vec2 mouseDelta = input.GetMouseDelta();
             if (glm::length(mouseDelta) > 0.01f) {
@@ -101,12 +166,9 @@ void Application::run()
 
         // --- Drawing ---
         {
-            // The object now stays at the origin, the camera moves around it
-            glm::mat4 model = glm::mat4(1.0f);
-            m_engine->getRenderer().drawMesh(*m_mesh, model);
-
+            NYANCHU_PROFILE_SCOPE("Application::draw");
             // Draw a cube slightly offset to see it
-            model = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 2.0f, 4.0f));
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 2.0f, 4.0f));
             m_engine->getRenderer().drawCube(model);
 
         }
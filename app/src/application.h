@@ -20,11 +20,18 @@ public:
     Application();
     ~Application();
 
-    bool initialize();
+    // Options: --record <file> saves this session's input; --replay <file>
+    // runs a saved session with its recorded delta times and exits;
+    // --headless runs without a window or GPU; --frames <n> quits after n frames.
+    bool initialize(int argc, char** argv);
     void run();
 
 private:
     std::unique_ptr<nyanchu::Engine> m_engine;
-    std::unique_ptr<nyanchu::Mesh> m_mesh;
+    nyanchu::MeshHandle m_mesh;
     float m_angle = 0.0f;
+    // Camera position at the last two fixed steps; rendering blends them.
+    glm::vec3 m_prevCameraPos{0.0f};
+    glm::vec3 m_cameraPos{0.0f};
+    uint64_t m_maxFrames = 0; // 0 = run until closed
 };
@@ -10,10 +10,10 @@
  */
 
 
-int main()
+int main(int argc, char** argv)
 {
     Application app;
-    if (!app.initialize())
+    if (!app.initialize(argc, argv))
     {
         return -1;
     }
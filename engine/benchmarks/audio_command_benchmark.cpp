@@ -0,0 +1,143 @@
+// Times every game-thread Audio call one by one while miniaudio's null
+// backend mixes on its own thread: 200 plays, 100 stops and an update per
+// frame for five seconds of 60 Hz frames. The calls only post commands, so
+// their worst case should stay near their median whatever the audio thread
+// is doing. Also checks that the queue drains and nothing is allocated.
+
+#include <nyanchu/audio.h>
+#include "bench_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> g_newCalls{ 0 };
+
+constexpr uint32_t kFrames = 300;
+constexpr uint32_t kPlaysPerFrame = 200;
+constexpr uint32_t kVoices = 64;
+
+// A 0.3 second 16-bit mono tone at 48 kHz.
+bool writeClip(const std::filesystem::path& path) {
+    const uint32_t sampleRate = 48000;
+    const uint32_t frames = sampleRate * 3 / 10;
+    std::vector<int16_t> samples(frames);
+    for (uint32_t i = 0; i < frames; ++i) {
+        samples[i] = static_cast<int16_t>(8000.0f * std::sin(6.2831853f * 440.0f * i / sampleRate));
+    }
+    FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file) return false;
+    auto put32 = [&](uint32_t v) { std::fwrite(&v, 4, 1, file); };
+    auto put16 = [&](uint16_t v) { std::fwrite(&v, 2, 1, file); };
+    const uint32_t dataBytes = frames * 2;
+    std::fwrite("RIFF", 1, 4, file); put32(36 + dataBytes); std::fwrite("WAVE", 1, 4, file);
+    std::fwrite("fmt ", 1, 4, file); put32(16); put16(1); put16(1); put32(sampleRate); put32(sampleRate * 2); put16(2); put16(16);
+    std::fwrite("data", 1, 4, file); put32(dataBytes);
+    std::fwrite(samples.data(), 2, frames, file);
+    std::fclose(file);
+    return true;
+}
+
+struct Timings {
+    std::vector<double> ns;
+
+    template <typename F>
+    void time(F&& f) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        ns.push_back(1e6 * bench::millisecondsSince(start));
+    }
+
+    void report(const char* name) {
+        std::sort(ns.begin(), ns.end());
+        auto percentile = [&](double p) { return ns[static_cast<size_t>(p * (ns.size() - 1))]; };
+        std::printf("%14s %10zu %10.0f %10.0f %10.0f %12.0f\n", name, ns.size(), percentile(0.5), percentile(0.99),
+                    percentile(0.999), ns.back());
+    }
+};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    g_newCalls.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+    using namespace nyanchu;
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "nyanchu_command_tone.wav";
+    if (!writeClip(path)) {
+        std::printf("Could not write %s\n", path.string().c_str());
+        return 1;
+    }
+
+    Audio audio;
+    audio.init(true, kVoices);
+    const SoundId sound = audio.load_sound(path.string().c_str());
+    if (sound == kInvalidSound) return 1;
+
+    Timings plays, stops, updates;
+    plays.ns.reserve(kFrames * kPlaysPerFrame);
+    stops.ns.reserve(kFrames * kPlaysPerFrame / 2);
+    updates.ns.reserve(kFrames);
+    std::vector<VoiceHandle> handles(kPlaysPerFrame);
+    SoundParams params;
+    params.positional = true;
+
+    const uint64_t newBefore = g_newCalls.load();
+    const uint64_t miniaudioBefore = audio.get_stats().allocations;
+    uint32_t peakQueued = 0;
+    auto frameStart = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < kFrames; ++frame) {
+        for (uint32_t i = 0; i < kPlaysPerFrame; ++i) {
+            params.position = glm::vec3(std::sin(float(i)) * 20.0f, 0.0f, std::cos(float(frame + i)) * 20.0f);
+            params.priority = static_cast<uint8_t>(i % 4 * 64);
+            plays.time([&] { handles[i] = audio.play_sound(sound, params); });
+        }
+        for (uint32_t i = 0; i < kPlaysPerFrame; i += 2) {
+            stops.time([&] { audio.stop_sound(handles[i]); });
+        }
+        audio.set_listener(glm::vec3(std::sin(frame * 0.05f) * 10.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+                           glm::vec3(0.0f, 1.0f, 0.0f));
+        updates.time([&] { audio.update(); });
+        peakQueued = std::max(peakQueued, audio.get_stats().queuedCommands);
+
+        frameStart += std::chrono::microseconds(16667);
+        std::this_thread::sleep_until(frameStart);
+    }
+    const uint64_t newCalls = g_newCalls.load() - newBefore;
+    const uint64_t miniaudioAllocations = audio.get_stats().allocations - miniaudioBefore;
+
+    // A few device periods are enough for the audio thread to catch up.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const AudioStats stats = audio.get_stats();
+
+    std::printf("%14s %10s %10s %10s %10s %12s\n", "call", "count", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+    plays.report("play_sound");
+    stops.report("stop_sound");
+    updates.report("update");
+    std::printf("peak queued commands: %u, queued after: %u, deferred updates: %llu, dropped: %llu\n", peakQueued,
+                stats.queuedCommands, static_cast<unsigned long long>(stats.deferredUpdates),
+                static_cast<unsigned long long>(stats.dropped));
+    std::printf("operator new: %llu, miniaudio allocations: %llu\n", static_cast<unsigned long long>(newCalls),
+                static_cast<unsigned long long>(miniaudioAllocations));
+
+    audio.shutdown();
+    std::filesystem::remove(path);
+    return newCalls == 0 && miniaudioAllocations == 0 && stats.queuedCommands == 0 ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+// Places 5,000 looping emitters across a 600 m square, dense enough that
+// more are in range than there are voices, and walks the listener through
+// them for two seconds of 60 Hz frames on miniaudio's null backend. Reports
+// the cost of the per-frame update that ranks every emitter and hands the
+// 64 voices to the loudest, and counts heap allocations made meanwhile;
+// moving emitters and the listener must not make any.
+
+#include <nyanchu/audio.h>
+#include "bench_util.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> g_newCalls{ 0 };
+
+constexpr uint32_t kEmitters = 5000;
+constexpr uint32_t kFrames = 120;
+constexpr uint32_t kVoices = 64;
+constexpr float kHalfExtent = 300.0f;
+
+// A one second 16-bit mono hum at 48 kHz, looped by the emitters.
+bool writeLoop(const std::filesystem::path& path, float frequency) {
+    const uint32_t sampleRate = 48000;
+    std::vector<int16_t> samples(sampleRate);
+    for (uint32_t i = 0; i < sampleRate; ++i) {
+        samples[i] = static_cast<int16_t>(6000.0f * std::sin(6.2831853f * frequency * i / sampleRate));
+    }
+    FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file) return false;
+    auto put32 = [&](uint32_t v) { std::fwrite(&v, 4, 1, file); };
+    auto put16 = [&](uint16_t v) { std::fwrite(&v, 2, 1, file); };
+    const uint32_t dataBytes = sampleRate * 2;
+    std::fwrite("RIFF", 1, 4, file); put32(36 + dataBytes); std::fwrite("WAVE", 1, 4, file);
+    std::fwrite("fmt ", 1, 4, file); put32(16); put16(1); put16(1); put32(sampleRate); put32(sampleRate * 2); put16(2); put16(16);
+    std::fwrite("data", 1, 4, file); put32(dataBytes);
+    std::fwrite(samples.data(), 2, samples.size(), file);
+    std::fclose(file);
+    return true;
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    g_newCalls.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+    using namespace nyanchu;
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "nyanchu_emitter_loop.wav";
+    if (!writeLoop(path, 110.0f)) {
+        std::printf("Could not write %s\n", path.string().c_str());
+        return 1;
+    }
+
+    Audio audio;
+    audio.init(true, kVoices);
+    const SoundId sound = audio.load_sound(path.string().c_str());
+    if (sound == kInvalidSound) return 1;
+
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> coordinate(-kHalfExtent, kHalfExtent);
+    std::uniform_real_distribution<float> range(20.0f, 80.0f);
+    std::uniform_int_distribution<int> priority(0, 3);
+    std::vector<EmitterId> emitters;
+    std::vector<glm::vec3> positions;
+    for (uint32_t i = 0; i < kEmitters; ++i) {
+        EmitterParams params;
+        params.maxDistance = range(rng);
+        params.priority = static_cast<uint8_t>(64 * priority(rng));
+        emitters.push_back(audio.create_emitter(sound, params));
+        positions.emplace_back(coordinate(rng), 0.0f, coordinate(rng));
+        audio.set_emitter_position(emitters.back(), positions.back());
+    }
+
+    // Warm up once so the frames below see steady state.
+    audio.set_listener(glm::vec3(-kHalfExtent, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    audio.update();
+
+    const uint64_t newBefore = g_newCalls.load();
+    const uint64_t miniaudioBefore = audio.get_stats().allocations;
+    double updateMs = 0.0, worstMs = 0.0;
+    uint64_t audible = 0, voiced = 0;
+    uint32_t peakVoiced = 0;
+    auto frameStart = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < kFrames; ++frame) {
+        // The listener crosses the whole square; every emitter drifts.
+        const float x = -kHalfExtent + 2.0f * kHalfExtent * float(frame) / kFrames;
+        const float t = float(frame) / 60.0f;
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < kEmitters; ++i) {
+            audio.set_emitter_position(emitters[i], positions[i] + glm::vec3(std::sin(t + i), 0.0f, std::cos(t + i)));
+        }
+        audio.set_listener(glm::vec3(x, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        audio.update();
+        const double ms = bench::millisecondsSince(start);
+        updateMs += ms;
+        worstMs = std::max(worstMs, ms);
+
+        const AudioStats stats = audio.get_stats();
+        audible += stats.audibleEmitters;
+        voiced += stats.emitterVoices;
+        peakVoiced = std::max(peakVoiced, stats.emitterVoices);
+
+        frameStart += std::chrono::microseconds(16667);
+        std::this_thread::sleep_until(frameStart);
+    }
+    const uint64_t newCalls = g_newCalls.load() - newBefore;
+    const AudioStats stats = audio.get_stats();
+    const uint64_t miniaudioAllocations = stats.allocations - miniaudioBefore;
+
+    std::printf("%9s %8s %12s %10s %14s %14s %12s %12s\n", "emitters", "voices", "ms/frame", "worst ms",
+                "avg audible", "avg voiced", "operator new", "ma allocs");
+    std::printf("%9u %8u %12.3f %10.3f %14.1f %14.1f %12llu %12llu\n", stats.emitters, stats.voices,
+                updateMs / kFrames, worstMs, double(audible) / kFrames, double(voiced) / kFrames,
+                static_cast<unsigned long long>(newCalls), static_cast<unsigned long long>(miniaudioAllocations));
+    std::printf("peak emitter voices: %u, voices stolen: %llu\n", peakVoiced,
+                static_cast<unsigned long long>(stats.stolen));
+
+    audio.shutdown();
+    std::filesystem::remove(path);
+    return newCalls == 0 && miniaudioAllocations == 0 && peakVoiced <= kVoices ? 0 : 1;
+}
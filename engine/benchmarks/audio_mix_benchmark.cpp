@@ -0,0 +1,131 @@
+// Renders ten seconds of 48 kHz stereo offline, in 10 ms periods, through
+// nyanchu's AudioMixer and, for comparison, through miniaudio's ma_engine
+// with one ma_sound per voice. Clips are 44.1 kHz so every voice is
+// resampled, pitches vary and voices are spread across the stereo field.
+// Reports voices mixed per millisecond of CPU: voice count times the
+// milliseconds of audio rendered, divided by the milliseconds it took.
+
+#include <nyanchu/audio_mixer.h>
+#include "bench_util.h"
+#include <miniaudio.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace nyanchu;
+
+namespace {
+
+constexpr uint32_t kSampleRate = 48000;
+constexpr uint32_t kClipRate = 44100;
+constexpr uint32_t kPeriodFrames = 480;
+constexpr uint32_t kSeconds = 10;
+
+// A two second looping tone, mono or stereo.
+std::vector<float> makeClip(uint32_t channels, float frequency) {
+    std::vector<float> frames(2 * kClipRate * channels);
+    for (uint32_t i = 0; i < 2 * kClipRate; ++i) {
+        const float s = 0.1f * std::sin(6.2831853f * frequency * i / kClipRate);
+        for (uint32_t c = 0; c < channels; ++c) frames[i * channels + c] = s;
+    }
+    return frames;
+}
+
+float pitchOf(uint32_t voice) { return 0.9f + 0.2f * float(voice % 7) / 6.0f; }
+float panOf(uint32_t voice) { return -1.0f + 2.0f * float(voice % 9) / 8.0f; }
+
+double renderMixer(uint32_t voices, uint32_t channels, bool effects, std::vector<float>& out) {
+    const std::vector<float> clip = makeClip(channels, 220.0f);
+    AudioMixer mixer(kSampleRate, voices);
+    BusId reverb = kMasterBus;
+    if (effects) {
+        mixer.addEffect(kMasterBus, std::make_unique<LowPassEffect>(kSampleRate, 4000.0f));
+        reverb = mixer.addBus(kMasterBus);
+        mixer.addEffect(reverb, std::make_unique<ReverbEffect>(kSampleRate));
+    }
+    MixerClip view{ clip.data(), 2 * kClipRate, channels, kClipRate };
+    for (uint32_t v = 0; v < voices; ++v) {
+        mixer.setRouting(v, kMasterBus, reverb);
+        mixer.play(v, view, true, pitchOf(v), 1.0f / voices, panOf(v), effects ? 0.3f : 0.0f);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t period = 0; period < kSeconds * kSampleRate / kPeriodFrames; ++period) {
+        std::fill(out.begin(), out.end(), 0.0f);
+        // Moving sources: every voice gets new parameters each period.
+        for (uint32_t v = 0; v < voices; ++v) {
+            mixer.setVoice(v, 1.0f / voices, panOf(v + period), effects ? 0.3f : 0.0f);
+        }
+        mixer.render(out.data(), kPeriodFrames, 2);
+    }
+    return bench::millisecondsSince(start);
+}
+
+double renderEngine(uint32_t voices, uint32_t channels, std::vector<float>& out) {
+    const std::vector<float> clip = makeClip(channels, 220.0f);
+    ma_engine_config config = ma_engine_config_init();
+    config.noDevice = MA_TRUE;
+    config.channels = 2;
+    config.sampleRate = kSampleRate;
+    ma_engine engine;
+    if (ma_engine_init(&config, &engine) != MA_SUCCESS) return 0.0;
+
+    std::vector<ma_audio_buffer> buffers(voices);
+    std::vector<ma_sound> sounds(voices);
+    for (uint32_t v = 0; v < voices; ++v) {
+        ma_audio_buffer_config bufferConfig = ma_audio_buffer_config_init(ma_format_f32, channels, 2 * kClipRate, clip.data(), NULL);
+        bufferConfig.sampleRate = kClipRate;
+        ma_audio_buffer_init(&bufferConfig, &buffers[v]);
+        ma_sound_init_from_data_source(&engine, &buffers[v], MA_SOUND_FLAG_NO_SPATIALIZATION, NULL, &sounds[v]);
+        ma_sound_set_looping(&sounds[v], MA_TRUE);
+        ma_sound_set_pitch(&sounds[v], pitchOf(v));
+        ma_sound_set_volume(&sounds[v], 1.0f / voices);
+        ma_sound_set_pan(&sounds[v], panOf(v));
+        ma_sound_start(&sounds[v]);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t period = 0; period < kSeconds * kSampleRate / kPeriodFrames; ++period) {
+        for (uint32_t v = 0; v < voices; ++v) {
+            ma_sound_set_pan(&sounds[v], panOf(v + period));
+        }
+        ma_engine_read_pcm_frames(&engine, out.data(), kPeriodFrames, NULL);
+    }
+    const double ms = bench::millisecondsSince(start);
+
+    for (uint32_t v = 0; v < voices; ++v) {
+        ma_sound_uninit(&sounds[v]);
+        ma_audio_buffer_uninit(&buffers[v]);
+    }
+    ma_engine_uninit(&engine);
+    return ms;
+}
+
+} // namespace
+
+int main() {
+    std::vector<float> out(2 * kPeriodFrames);
+    const double audioMs = 1000.0 * kSeconds;
+    auto row = [&](const char* name, uint32_t voices, double ms) {
+        std::printf("%-28s %7u %12.1f %18.0f %16.1fx\n", name, voices, ms, voices * audioMs / ms, audioMs / ms);
+    };
+
+    std::printf("%-28s %7s %12s %18s %17s\n", "path", "voices", "cpu ms", "voices per cpu ms", "realtime");
+    bool silent = false;
+    for (uint32_t voices : { 64u, 256u }) {
+        row("ma_engine, mono", voices, renderEngine(voices, 1, out));
+        row("mixer, mono", voices, renderMixer(voices, 1, false, out));
+        silent |= std::abs(out[0]) + std::abs(out[1]) == 0.0f;
+        row("mixer, stereo", voices, renderMixer(voices, 2, false, out));
+        row("mixer, mono + lp + reverb", voices, renderMixer(voices, 1, true, out));
+    }
+    if (silent) {
+        std::printf("FAILED: the mixer rendered silence\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// Timing and thread sweep helpers shared by the benchmarks.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+inline double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Thread counts to compare scaling over: powers of two below the hardware
+// thread count, then the count itself.
+inline std::vector<uint32_t> threadSweep() {
+    const uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint32_t> counts;
+    for (uint32_t threads = 1; threads < maxThreads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+} // namespace bench
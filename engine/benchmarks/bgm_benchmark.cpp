@@ -0,0 +1,124 @@
+// Streams a 10 second and a 5 minute track on miniaudio's null backend,
+// crossfading from one to the other. Reports how long play_bgm blocks the
+// calling thread and the peak memory miniaudio holds while each track
+// plays. Streaming keeps a fixed window decoded, so the long track must not
+// need more memory than the short one.
+
+#include <nyanchu/audio.h>
+#include "bench_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kSampleRate = 48000;
+constexpr float kCrossfadeSeconds = 0.5f;
+
+// A 16-bit stereo tone, written a second at a time.
+bool writeTrack(const std::filesystem::path& path, uint32_t seconds, float frequency) {
+    FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file) return false;
+    auto put32 = [&](uint32_t v) { std::fwrite(&v, 4, 1, file); };
+    auto put16 = [&](uint16_t v) { std::fwrite(&v, 2, 1, file); };
+    const uint32_t dataBytes = seconds * kSampleRate * 4;
+    std::fwrite("RIFF", 1, 4, file); put32(36 + dataBytes); std::fwrite("WAVE", 1, 4, file);
+    std::fwrite("fmt ", 1, 4, file); put32(16); put16(1); put16(2); put32(kSampleRate); put32(kSampleRate * 4); put16(4); put16(16);
+    std::fwrite("data", 1, 4, file); put32(dataBytes);
+    std::vector<int16_t> second(kSampleRate * 2);
+    for (uint32_t s = 0; s < seconds; ++s) {
+        for (uint32_t i = 0; i < kSampleRate; ++i) {
+            const float t = float(s) + float(i) / kSampleRate;
+            second[2 * i] = second[2 * i + 1] = static_cast<int16_t>(8000.0f * std::sin(6.2831853f * frequency * t));
+        }
+        std::fwrite(second.data(), 2, second.size(), file);
+    }
+    std::fclose(file);
+    return true;
+}
+
+struct Watch {
+    double callMs = 0.0;
+    uint64_t peakBytes = 0;
+    uint32_t peakStreams = 0;
+    uint32_t streamsAfter = 0;
+};
+
+// Samples memory for `seconds`, pumping update() at 60 Hz.
+Watch watchFor(nyanchu::Audio& audio, float seconds) {
+    Watch watch;
+    const auto start = std::chrono::steady_clock::now();
+    auto frame = start;
+    while (bench::millisecondsSince(start) < 1000.0 * seconds) {
+        audio.update();
+        const nyanchu::AudioStats stats = audio.get_stats();
+        watch.peakBytes = std::max(watch.peakBytes, stats.heapBytes);
+        watch.peakStreams = std::max(watch.peakStreams, stats.bgmStreams);
+        frame += std::chrono::microseconds(16667);
+        std::this_thread::sleep_until(frame);
+    }
+    watch.streamsAfter = audio.get_stats().bgmStreams;
+    return watch;
+}
+
+Watch playAndWatch(nyanchu::Audio& audio, const std::filesystem::path& path, float seconds) {
+    const auto start = std::chrono::steady_clock::now();
+    audio.play_bgm(path.string().c_str(), kCrossfadeSeconds);
+    const double callMs = bench::millisecondsSince(start);
+    Watch watch = watchFor(audio, seconds);
+    watch.callMs = callMs;
+    return watch;
+}
+
+} // namespace
+
+int main() {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::filesystem::path shortTrack = dir / "nyanchu_bgm_short.wav";
+    const std::filesystem::path longTrack = dir / "nyanchu_bgm_long.wav";
+    if (!writeTrack(shortTrack, 10, 220.0f) || !writeTrack(longTrack, 300, 330.0f)) {
+        std::printf("Could not write the test tracks to %s\n", dir.string().c_str());
+        return 1;
+    }
+
+    nyanchu::Audio audio;
+    audio.init(true, 0);
+    const uint64_t baseline = audio.get_stats().heapBytes;
+
+    const Watch first = playAndWatch(audio, shortTrack, 3.0f);
+    const Watch second = playAndWatch(audio, longTrack, 3.0f);
+    const Watch back = playAndWatch(audio, shortTrack, 3.0f);
+    audio.stop_bgm(kCrossfadeSeconds);
+    const Watch stopped = watchFor(audio, 1.0f);
+
+    std::printf("%12s %10s %14s %13s %13s\n", "track", "play ms", "peak KiB", "peak streams", "streams after");
+    auto row = [&](const char* name, const Watch& w) {
+        std::printf("%12s %10.3f %14.1f %13u %13u\n", name, w.callMs, (w.peakBytes - baseline) / 1024.0, w.peakStreams,
+                    w.streamsAfter);
+    };
+    row("10 s", first);
+    row("5 min", second);
+    row("10 s again", back);
+    std::printf("a fully decoded 5 minute track would take %.1f MiB\n",
+                300.0 * kSampleRate * 2 * sizeof(float) / (1024.0 * 1024.0));
+
+    audio.shutdown();
+    std::filesystem::remove(shortTrack);
+    std::filesystem::remove(longTrack);
+
+    // The crossfade holds two streams at once; the long one alone must fit
+    // in what two short ones did.
+    const bool bounded = second.peakBytes <= first.peakBytes + (first.peakBytes - baseline);
+    const bool crossfaded = second.peakStreams == 2 && second.streamsAfter == 1 && stopped.streamsAfter == 0;
+    if (!bounded || !crossfaded) {
+        std::printf("FAILED: %s\n", !bounded ? "memory grew with track length" : "tracks did not crossfade");
+        return 1;
+    }
+    return 0;
+}
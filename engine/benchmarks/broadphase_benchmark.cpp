@@ -0,0 +1,168 @@
+// Compares DynamicTree against brute force on random boxes at 1k, 10k and
+// 100k objects: building the tree, moving every box, finding all
+// overlapping pairs, and nearest-hit raycasts. The brute-force pair search
+// is O(n^2), so the 100k row takes around half a minute.
+
+#include <nyanchu/dynamic_tree.h>
+#include "bench_util.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace nyanchu;
+
+namespace {
+
+constexpr uint32_t kRayCount = 1000;
+
+struct Scene {
+    std::vector<AABB> boxes;
+    std::vector<glm::vec3> motion;
+    std::vector<Ray> rays;
+    float size;
+};
+
+// Boxes spread so each one overlaps a handful of neighbours at any count.
+Scene makeScene(uint32_t count) {
+    std::mt19937 rng(count);
+    Scene scene;
+    scene.size = 2.5f * std::cbrt(float(count));
+    std::uniform_real_distribution<float> position(0.0f, scene.size);
+    std::uniform_real_distribution<float> extent(0.25f, 1.0f);
+    std::uniform_real_distribution<float> step(-0.05f, 0.05f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const glm::vec3 center(position(rng), position(rng), position(rng));
+        const glm::vec3 half(extent(rng), extent(rng), extent(rng));
+        scene.boxes.push_back({ center - half, center + half });
+        scene.motion.emplace_back(step(rng), step(rng), step(rng));
+    }
+    for (uint32_t i = 0; i < kRayCount; ++i) {
+        glm::vec3 direction(unit(rng), unit(rng), unit(rng));
+        if (glm::dot(direction, direction) < 1e-4f) direction = glm::vec3(1.0f, 0.0f, 0.0f);
+        scene.rays.push_back({ glm::vec3(position(rng), position(rng), position(rng)), glm::normalize(direction) });
+    }
+    return scene;
+}
+
+uint64_t treePairs(const DynamicTree& tree, const std::vector<AABB>& boxes) {
+    uint64_t pairs = 0;
+    for (uint32_t i = 0; i < boxes.size(); ++i) {
+        tree.query(boxes[i], [&](int32_t proxy) {
+            const uint32_t j = tree.getUserData(proxy);
+            if (j > i && boxes[i].overlaps(boxes[j])) ++pairs;
+            return true;
+        });
+    }
+    return pairs;
+}
+
+uint64_t brutePairs(const std::vector<AABB>& boxes) {
+    uint64_t pairs = 0;
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        for (size_t j = i + 1; j < boxes.size(); ++j) {
+            if (boxes[i].overlaps(boxes[j])) ++pairs;
+        }
+    }
+    return pairs;
+}
+
+// Sum of nearest-hit distances (misses count as maxDistance), to check both
+// methods agree. Ties make comparing hit ids unreliable.
+double treeRays(const DynamicTree& tree, const std::vector<AABB>& boxes, const std::vector<Ray>& rays, float maxDistance) {
+    double checksum = 0.0;
+    for (const Ray& ray : rays) {
+        const glm::vec3 inverseDirection = 1.0f / ray.direction;
+        float nearest = maxDistance;
+        tree.raycast(ray, maxDistance, [&](int32_t proxy, float limit) {
+            const uint32_t id = tree.getUserData(proxy);
+            float distance;
+            if (intersectRay(ray.origin, inverseDirection, boxes[id], limit, distance) && distance < limit) {
+                nearest = distance;
+                return distance;
+            }
+            return limit;
+        });
+        checksum += nearest;
+    }
+    return checksum;
+}
+
+double bruteRays(const std::vector<AABB>& boxes, const std::vector<Ray>& rays, float maxDistance) {
+    double checksum = 0.0;
+    for (const Ray& ray : rays) {
+        const glm::vec3 inverseDirection = 1.0f / ray.direction;
+        float limit = maxDistance;
+        for (uint32_t id = 0; id < boxes.size(); ++id) {
+            float distance;
+            if (intersectRay(ray.origin, inverseDirection, boxes[id], limit, distance) && distance < limit) {
+                limit = distance;
+            }
+        }
+        checksum += limit;
+    }
+    return checksum;
+}
+
+} // namespace
+
+int main() {
+    std::printf("%8s %9s %9s %9s %11s %11s %9s %11s %11s %7s\n", "objects", "build ms", "move ms", "moved", "pairs tree",
+                "pairs brute", "pairs", "rays tree", "rays brute", "height");
+
+    for (uint32_t count : { 1000u, 10000u, 100000u }) {
+        Scene scene = makeScene(count);
+        DynamicTree tree;
+        std::vector<int32_t> proxies(count);
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < count; ++i) {
+            proxies[i] = tree.insert(scene.boxes[i], i);
+        }
+        const double buildMs = bench::millisecondsSince(start);
+
+        // Ten frames of small motion; most boxes stay inside their fat box.
+        uint32_t moved = 0;
+        start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < 10; ++frame) {
+            for (uint32_t i = 0; i < count; ++i) {
+                scene.boxes[i].min += scene.motion[i];
+                scene.boxes[i].max += scene.motion[i];
+                moved += tree.update(proxies[i], scene.boxes[i], scene.motion[i]) ? 1 : 0;
+            }
+        }
+        const double moveMs = bench::millisecondsSince(start) / 10.0;
+
+        start = std::chrono::steady_clock::now();
+        const uint64_t pairs = treePairs(tree, scene.boxes);
+        const double treePairsMs = bench::millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        const uint64_t expectedPairs = brutePairs(scene.boxes);
+        const double brutePairsMs = bench::millisecondsSince(start);
+
+        const float maxDistance = scene.size;
+        start = std::chrono::steady_clock::now();
+        const double rayDistance = treeRays(tree, scene.boxes, scene.rays, maxDistance);
+        const double treeRaysMs = bench::millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        const double expectedRayDistance = bruteRays(scene.boxes, scene.rays, maxDistance);
+        const double bruteRaysMs = bench::millisecondsSince(start);
+
+        std::printf("%8u %9.3f %9.3f %9u %11.3f %11.3f %9llu %11.3f %11.3f %7d\n", count, buildMs, moveMs, moved / 10,
+                    treePairsMs, brutePairsMs, static_cast<unsigned long long>(pairs), treeRaysMs, bruteRaysMs,
+                    tree.getHeight());
+        if (pairs != expectedPairs || std::abs(rayDistance - expectedRayDistance) > 1e-3 * kRayCount) {
+            std::printf("MISMATCH: pairs %llu vs %llu, ray distances %.3f vs %.3f\n",
+                        static_cast<unsigned long long>(pairs), static_cast<unsigned long long>(expectedPairs),
+                        rayDistance, expectedRayDistance);
+            return 1;
+        }
+    }
+    return 0;
+}
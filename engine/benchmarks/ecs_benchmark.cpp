@@ -0,0 +1,81 @@
+// Updates 1M entities with Position and Velocity through three parallel
+// systems and reports the average ECS::progress time for 1 to N threads.
+
+#include <nyanchu/ecs.h>
+#include "bench_util.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace nyanchu;
+
+namespace {
+
+constexpr uint32_t kEntityCount = 1000000;
+constexpr int kWarmupFrames = 5;
+constexpr int kMeasuredFrames = 50;
+constexpr float kDeltaTime = 1.0f / 60.0f;
+
+struct Position {
+    glm::vec3 value;
+};
+
+struct Velocity {
+    glm::vec3 value;
+};
+
+} // namespace
+
+int main() {
+    ECS ecs;
+    flecs::world& world = ecs.getWorld();
+
+    ecs.system<Velocity>("Gravity", flecs::OnUpdate, SystemExecution::Parallel)
+        .each([](Velocity& velocity) {
+            velocity.value.y -= 9.81f * kDeltaTime;
+        });
+    ecs.system<Position, const Velocity>("Integrate", flecs::OnUpdate, SystemExecution::Parallel)
+        .each([](Position& position, const Velocity& velocity) {
+            position.value += velocity.value * kDeltaTime;
+        });
+    ecs.system<Position, Velocity>("Bounce", flecs::OnUpdate, SystemExecution::Parallel)
+        .each([](Position& position, Velocity& velocity) {
+            if (position.value.y < 0.0f) {
+                position.value.y = -position.value.y;
+                velocity.value.y = -velocity.value.y * 0.8f;
+            }
+        });
+
+    for (uint32_t i = 0; i < kEntityCount; ++i) {
+        const float x = float(i % 1000);
+        const float z = float(i / 1000);
+        world.entity()
+            .set<Position>({ glm::vec3(x, 10.0f + float(i % 7), z) })
+            .set<Velocity>({ glm::vec3(0.0f, float(i % 5), 0.0f) });
+    }
+
+    std::printf("%u entities, 3 parallel systems\n", kEntityCount);
+    std::printf("%8s %14s %10s\n", "threads", "progress ms", "speedup");
+
+    double baselineMs = 0.0;
+    for (uint32_t threads : bench::threadSweep()) {
+        ecs.setThreadCount(threads);
+
+        double totalMs = 0.0;
+        for (int frame = 0; frame < kWarmupFrames + kMeasuredFrames; ++frame) {
+            const auto start = std::chrono::steady_clock::now();
+            ecs.progress(kDeltaTime);
+            if (frame >= kWarmupFrames) {
+                totalMs += bench::millisecondsSince(start);
+            }
+        }
+
+        const double averageMs = totalMs / kMeasuredFrames;
+        if (threads == 1) {
+            baselineMs = averageMs;
+        }
+        std::printf("%8u %14.3f %9.2fx\n", threads, averageMs, baselineMs / averageMs);
+    }
+    return 0;
+}
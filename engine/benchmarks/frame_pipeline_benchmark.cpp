@@ -0,0 +1,117 @@
+// Runs the same frame twice on bgfx's Noop backend: once with RendererBGFX
+// on the calling thread and once through ThreadedRenderer. Each frame burns
+// a fixed amount of "simulation" time and then records 20k mesh draws, so
+// the sequential frame costs sim + render while the pipelined one should
+// approach max(sim, render).
+
+#include <nyanchu/camera.h>
+#include <nyanchu/mesh.h>
+#include <nyanchu/renderer_opengl.h>
+#include <nyanchu/threaded_renderer.h>
+#include "bench_util.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace nyanchu;
+
+namespace {
+
+constexpr uint32_t kDrawCount = 20000;
+constexpr int kWarmupFrames = 5;
+constexpr int kMeasuredFrames = 100;
+
+Mesh makeCube() {
+    std::vector<Vertex> vertices;
+    for (int i = 0; i < 8; ++i) {
+        Vertex v{};
+        v.position = glm::vec3((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f);
+        v.normal = glm::normalize(v.position);
+        vertices.push_back(v);
+    }
+    std::vector<uint32_t> indices = {
+        0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,
+        0, 1, 4, 1, 5, 4,  2, 6, 3, 3, 6, 7,
+        0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5,
+    };
+    return Mesh(std::move(vertices), std::move(indices));
+}
+
+// Busy work standing in for game logic; volatile keeps it from being folded away.
+void simulate(double milliseconds) {
+    const auto start = std::chrono::steady_clock::now();
+    volatile float sink = 0.0f;
+    while (bench::millisecondsSince(start) < milliseconds) {
+        for (int i = 0; i < 1000; ++i) sink = sink + 1.0f;
+    }
+}
+
+double runFrames(IRenderer& renderer, const Mesh& cube, const std::vector<glm::mat4>& transforms, double simMs) {
+    Camera camera;
+    camera.SetAspectRatio(1280.0f / 720.0f);
+    renderer.uploadMesh(cube);
+
+    double totalMs = 0.0;
+    for (int frame = 0; frame < kWarmupFrames + kMeasuredFrames; ++frame) {
+        const auto start = std::chrono::steady_clock::now();
+        simulate(simMs);
+        renderer.beginFrame(camera);
+        for (const glm::mat4& transform : transforms) {
+            renderer.drawMesh(cube, transform);
+        }
+        renderer.endFrame();
+        if (frame >= kWarmupFrames) {
+            totalMs += bench::millisecondsSince(start);
+        }
+    }
+    return totalMs / kMeasuredFrames;
+}
+
+} // namespace
+
+int main() {
+    Mesh cube = makeCube();
+    std::vector<glm::mat4> transforms(kDrawCount);
+    for (uint32_t i = 0; i < kDrawCount; ++i) {
+        const float x = float(i % 200) - 100.0f;
+        const float z = float(i / 200) * -1.0f;
+        transforms[i] = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+    }
+
+    std::printf("%u draws per frame, Noop backend, %u hardware threads\n", kDrawCount, std::thread::hardware_concurrency());
+    std::printf("%8s %16s %16s\n", "sim ms", "sequential ms", "pipelined ms");
+
+    for (double simMs : { 0.0, 2.0, 5.0, 10.0 }) {
+        double sequentialMs = 0.0;
+        {
+            RendererBGFX renderer;
+            if (!renderer.initialize(nullptr, 1280, 720)) {
+                std::fprintf(stderr, "Failed to initialize the Noop renderer\n");
+                return 1;
+            }
+            sequentialMs = runFrames(renderer, cube, transforms, simMs);
+            renderer.releaseMesh(cube);
+            renderer.shutdown();
+        }
+
+        double pipelinedMs = 0.0;
+        {
+            ThreadedRenderer renderer(std::make_unique<RendererBGFX>());
+            if (!renderer.initialize(nullptr, 1280, 720)) {
+                std::fprintf(stderr, "Failed to initialize the Noop renderer\n");
+                return 1;
+            }
+            pipelinedMs = runFrames(renderer, cube, transforms, simMs);
+            renderer.releaseMesh(cube);
+            renderer.shutdown();
+        }
+
+        std::printf("%8.1f %16.3f %16.3f\n", simMs, sequentialMs, pipelinedMs);
+    }
+    return 0;
+}
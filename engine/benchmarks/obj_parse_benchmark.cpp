@@ -0,0 +1,95 @@
+// OBJ ingest throughput in MB/s: the serial tinyobj path against the chunked
+// parallel parser with 1, 2, 4 and 8 threads. Pass an .obj path to measure a
+// real asset; otherwise a textured quad grid of roughly 100 MB is generated.
+
+#include <nyanchu/job_system.h>
+#include <nyanchu/mesh.h>
+#include "bench_util.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace nyanchu;
+
+namespace {
+
+constexpr int kRuns = 3;
+constexpr uint32_t kGridSide = 1000;
+
+std::string writeGridObj() {
+    const std::string path = (std::filesystem::temp_directory_path() / "nyanchu_obj_parse_benchmark.obj").string();
+    std::ofstream file(path);
+    char line[128];
+    for (uint32_t z = 0; z <= kGridSide; ++z) {
+        for (uint32_t x = 0; x <= kGridSide; ++x) {
+            std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\n",
+                          x * 0.01f, 0.05f * ((x * 7 + z * 13) % 17), z * 0.01f,
+                          float(x) / kGridSide, float(z) / kGridSide);
+            file << line;
+        }
+    }
+    file << "vn 0 1 0\n";
+    const uint32_t row = kGridSide + 1;
+    for (uint32_t z = 0; z < kGridSide; ++z) {
+        for (uint32_t x = 0; x < kGridSide; ++x) {
+            const uint32_t a = z * row + x + 1, b = a + 1, c = a + row + 1, d = a + row;
+            std::snprintf(line, sizeof(line), "f %u/%u/1 %u/%u/1 %u/%u/1 %u/%u/1\n", a, a, d, d, c, c, b, b);
+            file << line;
+        }
+    }
+    return path;
+}
+
+bool sameGeometry(const Mesh& a, const Mesh& b) {
+    return a.getVertices().size() == b.getVertices().size() && a.getIndices().size() == b.getIndices().size() &&
+        std::memcmp(a.getVertices().data(), b.getVertices().data(), a.getVertices().size_bytes()) == 0 &&
+        std::memcmp(a.getIndices().data(), b.getIndices().data(), a.getIndices().size_bytes()) == 0;
+}
+
+// Best of kRuns, in milliseconds.
+double timeParse(const std::string& path, JobSystem* jobs) {
+    double best = 1e30;
+    for (int run = 0; run < kRuns; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        Mesh mesh = Mesh::parseObj(path, jobs);
+        const double ms = bench::millisecondsSince(start);
+        best = ms < best ? ms : best;
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const bool generated = argc < 2;
+    const std::string path = generated ? writeGridObj() : argv[1];
+    const double megabytes = std::filesystem::file_size(path) / (1024.0 * 1024.0);
+
+    Mesh reference = Mesh::parseObj(path);
+    std::printf("%s: %.1f MB, %zu vertices, %zu indices\n", path.c_str(), megabytes,
+                reference.getVertices().size(), reference.getIndices().size());
+    std::printf("%10s %12s %10s %10s\n", "threads", "ms", "MB/s", "identical");
+
+    const double serialMs = timeParse(path, nullptr);
+    std::printf("%10s %12.1f %10.1f %10s\n", "serial", serialMs, megabytes / (serialMs / 1000.0), "-");
+
+    int result = 0;
+    for (uint32_t threads : { 1u, 2u, 4u, 8u }) {
+        JobSystem jobs(threads);
+        Mesh mesh = Mesh::parseObj(path, &jobs);
+        const double ms = timeParse(path, &jobs);
+        const bool identical = sameGeometry(reference, mesh);
+        result |= identical ? 0 : 1;
+        std::printf("%10u %12.1f %10.1f %10s\n", threads, ms, megabytes / (ms / 1000.0), identical ? "yes" : "NO");
+    }
+
+    if (generated) {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+    return result;
+}
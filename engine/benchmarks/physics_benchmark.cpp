@@ -0,0 +1,87 @@
+// Drops 10k boxes onto a static ground box and reports the average
+// Physics::step time for 1 to N job threads, split by stage.
+
+#include <nyanchu/job_system.h>
+#include <nyanchu/physics.h>
+#include "bench_util.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace nyanchu;
+
+namespace {
+
+constexpr uint32_t kBoxCount = 10000;
+constexpr uint32_t kGridSide = 50; // boxes per row and column of each layer
+constexpr int kSettleSteps = 60;   // let the pile form before measuring
+constexpr int kMeasuredSteps = 120;
+constexpr float kStep = 1.0f / 60.0f;
+
+void populate(Physics& physics) {
+    BodyDesc ground;
+    ground.type = BodyType::Static;
+    ground.collider = Collider::box(glm::vec3(60.0f, 0.5f, 60.0f));
+    ground.position = glm::vec3(0.0f, -0.5f, 0.0f);
+    physics.createBody(ground);
+
+    BodyDesc box;
+    box.collider = Collider::box(glm::vec3(0.5f));
+    for (uint32_t i = 0; i < kBoxCount; ++i) {
+        const uint32_t layer = i / (kGridSide * kGridSide);
+        const uint32_t cell = i % (kGridSide * kGridSide);
+        // Offset every other layer so boxes land on edges and topple.
+        const float shift = (layer % 2) * 0.5f;
+        box.position = glm::vec3(float(cell % kGridSide) * 1.1f - 27.5f + shift,
+                                 0.5f + float(layer) * 1.2f,
+                                 float(cell / kGridSide) * 1.1f - 27.5f + shift);
+        physics.createBody(box);
+    }
+}
+
+} // namespace
+
+int main() {
+    std::printf("%u boxes on a static ground\n", kBoxCount);
+    std::printf("%8s %10s %10s %10s %10s %9s %8s %9s %7s\n",
+                "threads", "step ms", "broad ms", "narrow ms", "solve ms", "speedup", "pairs", "contacts", "colors");
+
+    double baselineMs = 0.0;
+    for (uint32_t threads : bench::threadSweep()) {
+        // Each run starts from the same scene so the thread counts compare
+        // the same amount of work.
+        std::unique_ptr<JobSystem> jobs = threads > 1 ? std::make_unique<JobSystem>(threads) : nullptr;
+        Physics physics(jobs.get());
+        populate(physics);
+
+        for (int i = 0; i < kSettleSteps; ++i) {
+            physics.step(kStep);
+        }
+
+        double totalMs = 0.0;
+        PhysicsStats stages;
+        for (int i = 0; i < kMeasuredSteps; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            physics.step(kStep);
+            totalMs += bench::millisecondsSince(start);
+
+            const PhysicsStats& stats = physics.getStats();
+            stages.broadphaseMs += stats.broadphaseMs;
+            stages.narrowphaseMs += stats.narrowphaseMs;
+            stages.solverMs += stats.solverMs;
+        }
+
+        const PhysicsStats& last = physics.getStats();
+        const double averageMs = totalMs / kMeasuredSteps;
+        if (threads == 1) {
+            baselineMs = averageMs;
+        }
+        std::printf("%8u %10.3f %10.3f %10.3f %10.3f %8.2fx %8u %9u %7u\n", threads, averageMs,
+                    stages.broadphaseMs / kMeasuredSteps, stages.narrowphaseMs / kMeasuredSteps,
+                    stages.solverMs / kMeasuredSteps, baselineMs / averageMs,
+                    last.pairs, last.contacts, last.colors);
+    }
+    return 0;
+}
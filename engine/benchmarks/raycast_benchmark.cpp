@@ -0,0 +1,115 @@
+// Raycasts against a procedural terrain of about a million triangles: the
+// TriangleBVH build time, then the cost per ray through the BVH and by
+// testing every triangle. Both must find the same nearest hits.
+
+#include <nyanchu/triangle_bvh.h>
+#include "bench_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace nyanchu;
+
+namespace {
+
+constexpr uint32_t kGrid = 700; // cells per side, two triangles each
+constexpr uint32_t kRayCount = 1000;
+constexpr uint32_t kBruteRayCount = 100;
+constexpr float kEdgeEpsilon = 1e-5f;
+
+// Rolling hills, so rays hit at many different depths.
+float height(float x, float z) {
+    return 2.0f * std::sin(x * 0.05f) * std::cos(z * 0.07f) + 0.5f * std::sin(x * 0.31f + z * 0.23f);
+}
+
+bool bruteRaycast(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const Ray& ray,
+                  float maxDistance, float& distance) {
+    bool found = false;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const glm::vec3& v0 = positions[indices[i]];
+        const glm::vec3 e1 = positions[indices[i + 1]] - v0;
+        const glm::vec3 e2 = positions[indices[i + 2]] - v0;
+        const glm::vec3 p = glm::cross(ray.direction, e2);
+        const float det = glm::dot(e1, p);
+        if (std::abs(det) <= 1e-20f) continue;
+        const glm::vec3 s = ray.origin - v0;
+        const float u = glm::dot(s, p) / det;
+        const glm::vec3 q = glm::cross(s, e1);
+        const float v = glm::dot(ray.direction, q) / det;
+        if (u < -kEdgeEpsilon || v < -kEdgeEpsilon || u + v > 1.0f + kEdgeEpsilon) continue;
+        const float t = glm::dot(e2, q) / det;
+        if (t < 0.0f || t >= maxDistance) continue;
+        maxDistance = t;
+        found = true;
+    }
+    distance = maxDistance;
+    return found;
+}
+
+} // namespace
+
+int main() {
+    std::vector<glm::vec3> positions;
+    positions.reserve((kGrid + 1) * (kGrid + 1));
+    for (uint32_t z = 0; z <= kGrid; ++z) {
+        for (uint32_t x = 0; x <= kGrid; ++x) {
+            positions.emplace_back(float(x), height(float(x), float(z)), float(z));
+        }
+    }
+    std::vector<uint32_t> indices;
+    indices.reserve(kGrid * kGrid * 6);
+    for (uint32_t z = 0; z < kGrid; ++z) {
+        for (uint32_t x = 0; x < kGrid; ++x) {
+            const uint32_t i = z * (kGrid + 1) + x;
+            indices.insert(indices.end(), { i, i + kGrid + 1, i + 1, i + 1, i + kGrid + 1, i + kGrid + 2 });
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const TriangleBVH bvh = TriangleBVH::build(positions, indices);
+    const double buildMs = bench::millisecondsSince(start);
+
+    // Rays from above the terrain, pointing down at shallow to steep angles.
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> across(0.0f, float(kGrid));
+    std::uniform_real_distribution<float> tilt(-1.0f, 1.0f);
+    std::vector<Ray> rays;
+    for (uint32_t i = 0; i < kRayCount; ++i) {
+        const glm::vec3 origin(across(rng), 10.0f, across(rng));
+        rays.push_back({ origin, glm::normalize(glm::vec3(tilt(rng), -0.5f, tilt(rng))) });
+    }
+    const float maxDistance = 2.0f * float(kGrid);
+
+    std::vector<float> distances(kRayCount);
+    uint32_t hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < kRayCount; ++i) {
+        MeshHit hit;
+        distances[i] = bvh.raycast(rays[i], maxDistance, hit) ? hit.distance : maxDistance;
+        hits += distances[i] < maxDistance ? 1 : 0;
+    }
+    const double bvhUs = 1000.0 * bench::millisecondsSince(start) / kRayCount;
+
+    uint32_t mismatches = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < kBruteRayCount; ++i) {
+        float distance;
+        bruteRaycast(positions, indices, rays[i], maxDistance, distance);
+        if (std::abs(distance - distances[i]) > 1e-3f * std::max(1.0f, distance)) ++mismatches;
+    }
+    const double bruteUs = 1000.0 * bench::millisecondsSince(start) / kBruteRayCount;
+
+    std::printf("%10s %8s %8s %10s %9s %14s %14s\n", "triangles", "nodes", "blocks", "build ms", "hits", "bvh us/ray",
+                "brute us/ray");
+    std::printf("%10zu %8zu %8zu %10.1f %9u %14.2f %14.1f\n", indices.size() / 3, bvh.getNodes().size(),
+                bvh.getBlocks().size(), buildMs, hits, bvhUs, bruteUs);
+    if (mismatches != 0) {
+        std::printf("MISMATCH: %u of %u rays disagree with brute force\n", mismatches, kBruteRayCount);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Records 50k mesh draws per frame through RendererBGFX::recordParallel on
+// bgfx's Noop backend and reports the cost with 1, 2, 4 and 8 threads, along
+// with how many of the draws frustum culling rejected.
+
+#include <nyanchu/camera.h>
+#include <nyanchu/job_system.h>
+#include <nyanchu/mesh.h>
+#include <nyanchu/renderer_opengl.h>
+#include "bench_util.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace nyanchu;
+
+namespace {
+
+constexpr uint32_t kDrawCount = 50000;
+constexpr int kWarmupFrames = 5;
+constexpr int kMeasuredFrames = 50;
+
+Mesh makeCube() {
+    std::vector<Vertex> vertices;
+    for (int i = 0; i < 8; ++i) {
+        Vertex v{};
+        v.position = glm::vec3((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f);
+        v.normal = glm::normalize(v.position);
+        vertices.push_back(v);
+    }
+    std::vector<uint32_t> indices = {
+        0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,
+        0, 1, 4, 1, 5, 4,  2, 6, 3, 3, 6, 7,
+        0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5,
+    };
+    return Mesh(std::move(vertices), std::move(indices));
+}
+
+} // namespace
+
+int main() {
+    RendererBGFX renderer;
+    if (!renderer.initialize(nullptr, 1280, 720)) {
+        std::fprintf(stderr, "Failed to initialize the Noop renderer\n");
+        return 1;
+    }
+
+    Camera camera;
+    camera.SetAspectRatio(1280.0f / 720.0f);
+    Mesh cube = makeCube();
+    renderer.uploadMesh(cube);
+
+    std::vector<glm::mat4> transforms(kDrawCount);
+    for (uint32_t i = 0; i < kDrawCount; ++i) {
+        const float x = float(i % 250) - 125.0f;
+        const float z = float(i / 250) * -1.0f;
+        transforms[i] = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+    }
+
+    std::printf("%u draws per frame, Noop backend\n", kDrawCount);
+    std::printf("%8s %14s %14s %10s %10s\n", "threads", "record ms", "frame ms", "visible", "culled");
+
+    for (uint32_t threads : { 1u, 2u, 4u, 8u }) {
+        JobSystem jobs(threads);
+        double recordMs = 0.0;
+        double frameMs = 0.0;
+        RenderStats stats;
+
+        for (int frame = 0; frame < kWarmupFrames + kMeasuredFrames; ++frame) {
+            renderer.beginFrame(camera);
+
+            auto start = std::chrono::steady_clock::now();
+            renderer.recordParallel(jobs, kDrawCount, [&](RenderEncoder& encoder, uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i) {
+                    encoder.drawMesh(cube, transforms[i]);
+                }
+            });
+            const double recorded = bench::millisecondsSince(start);
+            stats = renderer.getStats();
+
+            start = std::chrono::steady_clock::now();
+            renderer.endFrame();
+            const double submitted = bench::millisecondsSince(start);
+
+            if (frame >= kWarmupFrames) {
+                recordMs += recorded;
+                frameMs += submitted;
+            }
+        }
+
+        std::printf("%8u %14.3f %14.3f %10u %10u\n", threads, recordMs / kMeasuredFrames, frameMs / kMeasuredFrames,
+                    stats.visible, stats.culled);
+    }
+
+    renderer.shutdown();
+    return 0;
+}
@@ -0,0 +1,136 @@
+// Triggers 1,000 sound effects per frame for two seconds of 60 Hz frames on
+// miniaudio's null backend, so the audio thread mixes the voices in real
+// time while the game thread fires. Reports the trigger cost and counts
+// heap allocations made meanwhile, both through operator new and inside
+// miniaudio; the trigger path must not make any.
+
+#include <nyanchu/audio.h>
+#include "bench_util.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> g_newCalls{ 0 };
+
+constexpr uint32_t kFrames = 120;
+constexpr uint32_t kTriggersPerFrame = 1000;
+constexpr uint32_t kVoices = 64;
+
+// A short 16-bit mono blip at 48 kHz.
+bool writeClip(const std::filesystem::path& path, float seconds, float frequency) {
+    const uint32_t sampleRate = 48000;
+    const uint32_t frames = static_cast<uint32_t>(seconds * sampleRate);
+    std::vector<int16_t> samples(frames);
+    for (uint32_t i = 0; i < frames; ++i) {
+        const float fade = 1.0f - float(i) / frames;
+        samples[i] = static_cast<int16_t>(12000.0f * fade * std::sin(6.2831853f * frequency * i / sampleRate));
+    }
+    FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file) return false;
+    auto put32 = [&](uint32_t v) { std::fwrite(&v, 4, 1, file); };
+    auto put16 = [&](uint16_t v) { std::fwrite(&v, 2, 1, file); };
+    const uint32_t dataBytes = frames * 2;
+    std::fwrite("RIFF", 1, 4, file); put32(36 + dataBytes); std::fwrite("WAVE", 1, 4, file);
+    std::fwrite("fmt ", 1, 4, file); put32(16); put16(1); put16(1); put32(sampleRate); put32(sampleRate * 2); put16(2); put16(16);
+    std::fwrite("data", 1, 4, file); put32(dataBytes);
+    std::fwrite(samples.data(), 2, frames, file);
+    std::fclose(file);
+    return true;
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    g_newCalls.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+    using namespace nyanchu;
+
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    std::vector<std::filesystem::path> paths;
+    for (int i = 0; i < 8; ++i) {
+        paths.push_back(dir / ("nyanchu_sfx_" + std::to_string(i) + ".wav"));
+        if (!writeClip(paths.back(), 0.1f + 0.05f * i, 220.0f * (i + 1))) {
+            std::printf("Could not write %s\n", paths.back().string().c_str());
+            return 1;
+        }
+    }
+
+    Audio audio;
+    audio.init(true, kVoices);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SoundId> sounds;
+    for (const auto& path : paths) {
+        sounds.push_back(audio.load_sound(path.string().c_str()));
+        if (sounds.back() == kInvalidSound) return 1;
+    }
+    const double loadMs = bench::millisecondsSince(start);
+
+    // Parameters are drawn up front so the loop only measures triggering.
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> pick(0, int(sounds.size()) - 1);
+    std::uniform_int_distribution<int> priority(0, 3);
+    std::uniform_real_distribution<float> coordinate(-50.0f, 50.0f);
+    std::vector<std::pair<SoundId, SoundParams>> triggers(kTriggersPerFrame);
+    for (auto& [sound, params] : triggers) {
+        sound = sounds[pick(rng)];
+        params.priority = static_cast<uint8_t>(64 * priority(rng));
+        params.positional = priority(rng) != 0;
+        params.position = glm::vec3(coordinate(rng), 0.0f, coordinate(rng));
+        params.pitch = 0.8f + 0.1f * priority(rng);
+    }
+
+    const uint64_t newBefore = g_newCalls.load();
+    const uint64_t miniaudioBefore = audio.get_stats().allocations;
+    double triggerMs = 0.0, worstFrameMs = 0.0;
+    uint32_t peakPlaying = 0;
+    auto frameStart = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < kFrames; ++frame) {
+        start = std::chrono::steady_clock::now();
+        audio.update();
+        for (const auto& [sound, params] : triggers) {
+            audio.play_sound(sound, params);
+        }
+        const double ms = bench::millisecondsSince(start);
+        triggerMs += ms;
+        worstFrameMs = std::max(worstFrameMs, ms);
+        peakPlaying = std::max(peakPlaying, audio.get_stats().playing);
+
+        frameStart += std::chrono::microseconds(16667);
+        std::this_thread::sleep_until(frameStart);
+    }
+    const uint64_t newCalls = g_newCalls.load() - newBefore;
+    const AudioStats stats = audio.get_stats();
+    const uint64_t miniaudioAllocations = stats.allocations - miniaudioBefore;
+
+    std::printf("loaded %zu clips in %.2f ms, %u voices\n", sounds.size(), loadMs, stats.voices);
+    std::printf("%8s %10s %12s %12s %10s %10s %10s %10s %12s %12s\n", "frames", "triggers", "ms/frame", "worst ms",
+                "ns/play", "stolen", "dropped", "culled", "operator new", "ma allocs");
+    std::printf("%8u %10llu %12.3f %12.3f %10.1f %10llu %10llu %10llu %12llu %12llu\n", kFrames,
+                static_cast<unsigned long long>(stats.triggered), triggerMs / kFrames, worstFrameMs,
+                1e6 * triggerMs / (double(kFrames) * kTriggersPerFrame), static_cast<unsigned long long>(stats.stolen),
+                static_cast<unsigned long long>(stats.dropped), static_cast<unsigned long long>(stats.culled),
+                static_cast<unsigned long long>(newCalls), static_cast<unsigned long long>(miniaudioAllocations));
+    std::printf("peak voices playing: %u\n", peakPlaying);
+
+    audio.shutdown();
+    for (const auto& path : paths) std::filesystem::remove(path);
+    return newCalls == 0 && miniaudioAllocations == 0 ? 0 : 1;
+}
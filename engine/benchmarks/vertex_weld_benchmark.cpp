@@ -0,0 +1,97 @@
+// Welds the unindexed vertex stream of a flat grid (three corners per
+// triangle, as the OBJ loader produces) with the old std::unordered_map path
+// and with VertexWelder, at 10k, 100k and 1M triangles.
+
+#include <nyanchu/mesh.h>
+#include <nyanchu/vertex_welder.h>
+#include "bench_util.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+using namespace nyanchu;
+
+namespace {
+
+constexpr int kRuns = 5;
+
+// Integer grid positions are the worst case for the XOR-combined std::hash.
+std::vector<Vertex> makeGridStream(uint32_t triangleCount) {
+    const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(triangleCount / 2.0)));
+    std::vector<Vertex> stream;
+    stream.reserve(size_t(triangleCount) * 3);
+    auto corner = [&](uint32_t x, uint32_t z) {
+        Vertex v{};
+        v.position = glm::vec3(float(x), 0.0f, float(z));
+        v.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        v.texcoord = glm::vec2(float(x) / side, float(z) / side);
+        stream.push_back(v);
+    };
+    for (uint32_t z = 0; z < side && stream.size() < stream.capacity(); ++z) {
+        for (uint32_t x = 0; x < side && stream.size() < stream.capacity(); ++x) {
+            corner(x, z); corner(x, z + 1); corner(x + 1, z);
+            corner(x + 1, z); corner(x, z + 1); corner(x + 1, z + 1);
+        }
+    }
+    stream.resize(size_t(triangleCount) * 3);
+    return stream;
+}
+
+void weldWithUnorderedMap(const std::vector<Vertex>& stream, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+    for (const Vertex& vertex : stream) {
+        if (uniqueVertices.count(vertex) == 0) {
+            uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(vertex);
+        }
+        indices.push_back(uniqueVertices[vertex]);
+    }
+}
+
+void weldWithWelder(const std::vector<Vertex>& stream, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    VertexWelder welder(stream.size());
+    indices.reserve(stream.size());
+    for (const Vertex& vertex : stream) {
+        indices.push_back(welder.weld(vertex));
+    }
+    vertices = welder.takeVertices();
+}
+
+template <typename Fn>
+double bestOf(const std::vector<Vertex>& stream, Fn fn, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    double best = 1e30;
+    for (int run = 0; run < kRuns; ++run) {
+        vertices.clear();
+        indices.clear();
+        const auto start = std::chrono::steady_clock::now();
+        fn(stream, vertices, indices);
+        const double ms = bench::millisecondsSince(start);
+        best = ms < best ? ms : best;
+    }
+    return best;
+}
+
+} // namespace
+
+int main() {
+    std::printf("%10s %10s %16s %16s %8s\n", "triangles", "vertices", "unordered_map ms", "VertexWelder ms", "speedup");
+
+    for (uint32_t triangles : { 10000u, 100000u, 1000000u }) {
+        const std::vector<Vertex> stream = makeGridStream(triangles);
+
+        std::vector<Vertex> mapVertices, weldVertices;
+        std::vector<uint32_t> mapIndices, weldIndices;
+        const double mapMs = bestOf(stream, weldWithUnorderedMap, mapVertices, mapIndices);
+        const double weldMs = bestOf(stream, weldWithWelder, weldVertices, weldIndices);
+
+        if (mapVertices != weldVertices || mapIndices != weldIndices) {
+            std::fprintf(stderr, "Mismatch at %u triangles\n", triangles);
+            return 1;
+        }
+        std::printf("%10u %10zu %16.2f %16.2f %7.1fx\n", triangles, weldVertices.size(), mapMs, weldMs, mapMs / weldMs);
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "job_system.h"
+#include "mesh.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nyanchu {
+
+class IRenderer;
+
+enum class AssetState {
+    Loading, // queued or being read and parsed on an I/O thread
+    Ready,   // finalized on the main thread; safe to draw
+    Failed,
+};
+
+// A mesh being loaded by the AssetManager. Poll isReady() from the main loop;
+// the mesh is only handed out once it has been uploaded to the renderer.
+class MeshAsset {
+public:
+    AssetState getState() const { return m_state.load(std::memory_order_acquire); }
+    bool isReady() const { return getState() == AssetState::Ready; }
+    const Mesh* get() const { return isReady() ? m_mesh.get() : nullptr; }
+    const std::string& getPath() const { return m_path; }
+    const std::string& getError() const { return m_error; }
+
+private:
+    friend class AssetManager;
+
+    std::string m_path;
+    std::unique_ptr<Mesh> m_mesh;
+    std::string m_error;
+    std::atomic<AssetState> m_state{ AssetState::Loading };
+};
+
+using MeshHandle = std::shared_ptr<const MeshAsset>;
+
+// Loads assets on a small pool of I/O threads so the main loop never blocks on
+// disk or parsing. Work that has to happen on the main thread (GPU upload) is
+// queued and done in update(), a bounded amount per frame.
+class AssetManager {
+public:
+    // `jobs` is used to parse large files in parallel from the I/O threads.
+    AssetManager(IRenderer& renderer, JobSystem& jobs, uint32_t ioThreadCount = 2);
+    ~AssetManager();
+
+    AssetManager(const AssetManager&) = delete;
+    AssetManager& operator=(const AssetManager&) = delete;
+
+    // Returns immediately. Loading the same path again returns the same handle.
+    MeshHandle loadMesh(const std::string& path);
+
+    // Finalizes finished loads on the calling (main) thread, stopping once
+    // `budgetMs` has been spent. At least one asset is finalized per call.
+    void update(double budgetMs = 2.0);
+
+    // Number of assets still queued, loading or waiting for update().
+    uint32_t getPendingCount() const { return m_pending.load(std::memory_order_acquire); }
+
+private:
+    IRenderer& m_renderer;
+    JobSystem& m_jobs;
+
+    std::unordered_map<std::string, std::shared_ptr<MeshAsset>> m_meshes;
+
+    std::mutex m_finishedMutex;
+    std::vector<std::shared_ptr<MeshAsset>> m_finished;
+    std::atomic<uint32_t> m_pending{ 0 };
+    std::atomic<bool> m_shuttingDown{ false };
+
+    // Declared last so its threads are joined before the members they touch go away.
+    JobSystem m_io;
+};
+
+} // namespace nyanchu
@@ -1,19 +1,202 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "audio_mixer.h"
+
 // Foward declaration
 typedef struct ma_engine ma_engine;
 typedef struct ma_sound ma_sound;
+typedef struct ma_context ma_context;
+typedef struct ma_device ma_device;
 
 namespace nyanchu {
 
+class ECS;
+
+// A clip in the sound bank.
+using SoundId = uint32_t;
+constexpr SoundId kInvalidSound = ~0u;
+
+// One playback of a clip. Stays valid until the clip ends, is stopped or
+// its voice is stolen; after that it refers to nothing.
+struct VoiceHandle {
+    uint32_t voice = ~0u;
+    uint32_t generation = 0;
+    explicit operator bool() const { return voice != ~0u; }
+};
+
+struct SoundParams {
+    float volume = 1.0f;
+    float pitch = 1.0f;
+    // When the pool is full, lower priorities are stolen first, then the
+    // quietest voices at the listener, then the oldest.
+    uint8_t priority = 128;
+    // Non-positional sounds (UI, music stingers) play centered.
+    bool positional = false;
+    glm::vec3 position{ 0.0f };
+    // Full volume up to minDistance, then inverse distance, faded out to
+    // silence at maxDistance. Positional sounds beyond it are not played.
+    float minDistance = 1.0f;
+    float maxDistance = 50.0f;
+    float reverbSend = 0.0f; // share of the signal also sent to kReverbBus
+};
+
+// A looping positional source, such as a fire or a machine. Emitters are
+// cheap: only the audible ones hold a voice, and those beyond their
+// maxDistance are skipped without touching the mixer.
+using EmitterId = uint32_t;
+constexpr EmitterId kInvalidEmitter = ~0u;
+
+struct EmitterParams {
+    float volume = 1.0f;
+    float minDistance = 1.0f;
+    float maxDistance = 30.0f;
+    uint8_t priority = 128;
+    float reverbSend = 0.0f;
+};
+
+// Links an ECS entity to an emitter, which follows the entity's world
+// position. Removing the component (or deleting the entity) destroys the
+// emitter.
+struct AudioEmitter {
+    EmitterId id = kInvalidEmitter;
+};
+
+struct AudioStats {
+    uint32_t voices = 0;
+    uint32_t playing = 0;
+    uint64_t triggered = 0;
+    uint64_t stolen = 0;
+    uint64_t dropped = 0;     // nothing of lower rank to steal
+    uint64_t allocations = 0; // heap allocations made by miniaudio so far
+    uint64_t heapBytes = 0;   // held by miniaudio and the sound bank now
+    uint32_t bgmStreams = 0;  // the current track plus any still fading out
+    uint32_t emitters = 0;
+    uint32_t audibleEmitters = 0; // within range at the last update()
+    uint32_t emitterVoices = 0;   // audible emitters that got a voice
+    uint64_t culled = 0;          // positional one-shots out of range
+    uint32_t queuedCommands = 0;  // posted but not yet seen by the audio thread
+    uint64_t deferredUpdates = 0; // volume/pan changes left for a later frame
+};
+
+// Buses of Audio's mixer. The master bus carries a LowPassEffect (effect 0,
+// open by default); the reverb bus carries a ReverbEffect (effect 0) and
+// feeds the master bus. Music bypasses both.
+constexpr BusId kReverbBus = 1;
+
+// Sound effects play on pooled voices of an AudioMixer that runs in the
+// device callback; music streams through miniaudio's engine and the mix is
+// added on top. The game thread posts play, stop and parameter commands to
+// a ring that the callback drains before mixing each period. Those calls
+// do not wait on the audio thread or allocate, and a late audio period
+// cannot stall a frame.
 class Audio {
 public:
-    void init();
+    Audio();
+    ~Audio();
+
+    // Headless audio runs on miniaudio's null backend: sounds load and play
+    // through the graph in real time, nothing reaches the hardware. The
+    // voice count is capped at 1023 so a play needs at most half the command
+    // ring.
+    void init(bool headless = false, uint32_t voiceCount = 64);
     void shutdown();
-    void play_bgm(const char* soundName);
+    // Streams the track from disk on miniaudio's job thread, so neither the
+    // file open nor the decode happens here, and memory stays the same for
+    // any track length. The previous track fades out while this one fades
+    // in over `crossfadeSeconds`.
+    void play_bgm(const char* soundName, float crossfadeSeconds = 1.0f);
+    void stop_bgm(float fadeSeconds = 1.0f);
+
+    // Decodes the whole file to the engine's format once; loading the same
+    // path again returns the same id. Call at load time, not per trigger.
+    SoundId load_sound(const char* path);
+    // Plays a one-shot on a pooled voice without allocating or touching
+    // the disk. Returns an empty handle if every voice outranks it or the
+    // audio thread has fallen too far behind on commands.
+    VoiceHandle play_sound(SoundId sound, const SoundParams& params = {});
+    void stop_sound(VoiceHandle handle);
+    bool is_playing(VoiceHandle handle) const;
+
+    // Ears for positional sounds; the engine syncs it from the Camera.
+    void set_listener(const glm::vec3& position, const glm::vec3& forward, const glm::vec3& up);
+
+    EmitterId create_emitter(SoundId sound, const EmitterParams& params = {});
+    void destroy_emitter(EmitterId emitter);
+    void set_emitter_position(EmitterId emitter, const glm::vec3& position);
+
+    // Appends an effect to a bus; it takes effect within one audio period.
+    // Returns its index on the bus, or ~0u if the bus is full. Build it
+    // with get_sample_rate().
+    uint32_t add_effect(BusId bus, std::unique_ptr<AudioEffect> effect);
+    // For example set_effect_param(kMasterBus, 0, LowPassEffect::Cutoff,
+    // 800.0f) to muffle everything. False if the queue is backed up.
+    bool set_effect_param(BusId bus, uint32_t effect, uint32_t param, float value);
+    uint32_t get_sample_rate() const;
+
+    // Adds the AudioEmitter component and a PostUpdate system that copies
+    // world positions into emitters. Audio must outlive the ECS.
+    void attach(ECS& ecs);
+
+    // Once per frame, after emitters have moved: one batched pass computes
+    // every emitter's gain, hands voices to the loudest audible ones and
+    // sets volume and pan on the positional voices. It also parks voices
+    // whose clips have finished and releases tracks that have faded out.
+    void update();
+    AudioStats get_stats() const;
+
 private:
-    ma_engine* m_engine;
-    ma_sound* m_bgm;
+    struct Clip;
+    struct Voice;
+    struct HeapCounter;
+    struct EmitterSet;
+    struct Command;
+    struct Commands;
+
+    bool isFree(const Voice& voice) const;
+    Voice* claimVoice(uint8_t priority, float gain);
+    void startVoice(Voice& voice, SoundId sound, bool looping, float pitch, float pan);
+    void releaseVoice(Voice& voice);
+    float gainAt(const glm::vec3& position, float volume, float minDistance, float maxDistance) const;
+    // Updates the voice's gain and returns its pan.
+    float spatialize(Voice& voice);
+
+    static constexpr uint32_t kBusCount = 2;
+
+    ma_context* m_context = nullptr;
+    ma_device* m_device = nullptr;
+    ma_engine* m_engine = nullptr;
+    ma_sound* m_bgm = nullptr;
+    std::vector<ma_sound*> m_fadingBgm;
+
+    // Reserved up front and never reallocated, since voices read clips
+    // from the audio thread.
+    std::vector<Clip> m_clips;
+    std::unordered_map<std::string, SoundId> m_clipIds;
+    std::unique_ptr<Voice[]> m_voices;
+    uint32_t m_voiceCount = 0;
+
+    uint64_t m_triggered = 0;
+    uint64_t m_stolen = 0;
+    uint64_t m_dropped = 0;
+    uint64_t m_culled = 0;
+    uint64_t m_deferredUpdates = 0;
+    std::unique_ptr<Commands> m_commands;
+    std::unique_ptr<AudioMixer> m_mixer;
+    uint32_t m_effectCounts[kBusCount] = {};
+    std::unique_ptr<HeapCounter> m_heap;
+
+    glm::vec3 m_listenerPosition{ 0.0f };
+    glm::vec3 m_listenerRight{ 1.0f, 0.0f, 0.0f };
+    std::unique_ptr<EmitterSet> m_emitters;
+    uint32_t m_audibleEmitters = 0;
 };
 
 } // namespace nyanchu
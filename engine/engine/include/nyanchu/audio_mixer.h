@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace nyanchu {
+
+// Processes one bus in place. Runs on the thread that renders the mixer,
+// and so do setParam() calls; neither may allocate or block.
+class AudioEffect {
+public:
+    virtual ~AudioEffect() = default;
+    virtual void process(float* left, float* right, uint32_t frames) = 0;
+    virtual void setParam(uint32_t param, float value) = 0;
+};
+
+// Biquad low-pass (Butterworth Q). Cutoffs near Nyquist bypass the filter.
+class LowPassEffect : public AudioEffect {
+public:
+    enum Param : uint32_t { Cutoff };
+
+    explicit LowPassEffect(uint32_t sampleRate, float cutoffHz = 20000.0f);
+    void process(float* left, float* right, uint32_t frames) override;
+    void setParam(uint32_t param, float value) override;
+
+private:
+    float m_sampleRate;
+    bool m_bypass = true;
+    float m_b0 = 1.0f, m_b1 = 0.0f, m_b2 = 0.0f, m_a1 = 0.0f, m_a2 = 0.0f;
+    float m_state[2][2] = {}; // transposed direct form II, per channel
+};
+
+// Freeverb-style reverb: parallel damped combs into series allpasses, with
+// the right channel's delays spread from the left's. Outputs only the wet
+// signal, for use on a send bus.
+class ReverbEffect : public AudioEffect {
+public:
+    enum Param : uint32_t { RoomSize, Damping, Wet };
+
+    explicit ReverbEffect(uint32_t sampleRate);
+    void process(float* left, float* right, uint32_t frames) override;
+    void setParam(uint32_t param, float value) override;
+
+private:
+    struct Comb {
+        std::vector<float> buffer;
+        uint32_t index = 0;
+        float filtered = 0.0f;
+    };
+    struct Allpass {
+        std::vector<float> buffer;
+        uint32_t index = 0;
+    };
+    static constexpr uint32_t kCombs = 4;
+    static constexpr uint32_t kAllpasses = 2;
+
+    Comb m_combs[2][kCombs];
+    Allpass m_allpasses[2][kAllpasses];
+    float m_feedback = 0.84f;
+    float m_damping = 0.2f;
+    float m_wet = 1.0f;
+};
+
+// Interleaved f32 frames at their own rate; the mixer resamples on the fly.
+struct MixerClip {
+    const float* frames = nullptr;
+    uint64_t frameCount = 0;
+    uint32_t channels = 1; // 1 or 2
+    uint32_t sampleRate = 48000;
+};
+
+using BusId = uint32_t;
+constexpr BusId kMasterBus = 0;
+
+// Software mixer: each voice is resampled, then scaled and panned into its
+// bus (and optionally sent to a second one) with SIMD kernels. Buses run
+// their effects and feed their output bus; the master bus lands in the
+// caller's buffer. Work happens in fixed blocks on preallocated buffers,
+// so render() never allocates.
+//
+// Not thread-safe: set up the graph first, then call everything else from
+// the rendering thread only.
+class AudioMixer {
+public:
+    static constexpr uint32_t kBlockFrames = 256;
+    static constexpr uint32_t kMaxEffectsPerBus = 8;
+
+    AudioMixer(uint32_t sampleRate, uint32_t voiceCount);
+    ~AudioMixer();
+
+    // A bus feeds one created before it, so the graph has no cycles; an
+    // output that does not exist yet is clamped to the newest bus.
+    BusId addBus(BusId output, float gain = 1.0f);
+    // Returns the effect's index on the bus, or ~0u (dropping it) when the
+    // bus is full. Reserved space keeps this allocation-free.
+    uint32_t addEffect(BusId bus, std::unique_ptr<AudioEffect> effect);
+    void setEffectParam(BusId bus, uint32_t effect, uint32_t param, float value);
+
+    // Starts at full volume and pan, no ramp. Pitch scales the playback rate.
+    void play(uint32_t voice, const MixerClip& clip, bool looping, float pitch, float volume, float pan,
+              float send = 0.0f);
+    void stop(uint32_t voice);
+    // Ramped over the next block, so changes never click.
+    void setVoice(uint32_t voice, float volume, float pan, float send);
+    void setRouting(uint32_t voice, BusId bus, BusId sendBus);
+    bool isPlaying(uint32_t voice) const;
+
+    // Adds the mix to `out` (interleaved, `channels` wide). Mono output
+    // gets the average of both sides; channels past the second are left
+    // alone.
+    void render(float* out, uint32_t frames, uint32_t channels);
+
+    uint32_t getSampleRate() const { return m_sampleRate; }
+    uint32_t getVoiceCount() const { return m_voiceCount; }
+    uint64_t getVoiceBlocksMixed() const { return m_voiceBlocksMixed; }
+
+private:
+    struct Voice;
+    struct Bus;
+
+    uint32_t resample(Voice& voice, uint32_t frames);
+    void renderBlock(float* out, uint32_t frames, uint32_t channels);
+
+    uint32_t m_sampleRate;
+    uint32_t m_voiceCount;
+    std::unique_ptr<Voice[]> m_voices;
+    std::vector<Bus> m_buses;
+    std::unique_ptr<float[]> m_scratch; // resampled left, then right
+    uint64_t m_voiceBlocksMixed = 0;
+};
+
+} // namespace nyanchu
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+namespace nyanchu {
+
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extents() const { return (max - min) * 0.5f; }
+    float surfaceArea() const {
+        const glm::vec3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    bool overlaps(const AABB& other) const {
+        return min.x <= other.max.x && max.x >= other.min.x &&
+               min.y <= other.max.y && max.y >= other.min.y &&
+               min.z <= other.max.z && max.z >= other.min.z;
+    }
+    bool contains(const AABB& other) const {
+        return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+               max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+    }
+    static AABB merge(const AABB& a, const AABB& b) {
+        return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+    }
+
+    // Box enclosing this one after an affine transform (Arvo's method).
+    AABB transformed(const glm::mat4& m) const {
+        const glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1.0f));
+        const glm::vec3 e = extents();
+        const glm::vec3 r(
+            glm::abs(m[0][0]) * e.x + glm::abs(m[1][0]) * e.y + glm::abs(m[2][0]) * e.z,
+            glm::abs(m[0][1]) * e.x + glm::abs(m[1][1]) * e.y + glm::abs(m[2][1]) * e.z,
+            glm::abs(m[0][2]) * e.x + glm::abs(m[1][2]) * e.y + glm::abs(m[2][2]) * e.z);
+        return { c - r, c + r };
+    }
+};
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction; // unit length
+};
+
+// Slab test against a box. `inverseDirection` is 1 / ray direction per axis
+// (infinities are fine). On a hit, `distance` is where the ray enters the box,
+// or 0 when it starts inside.
+inline bool intersectRay(const glm::vec3& origin, const glm::vec3& inverseDirection, const AABB& box,
+                         float maxDistance, float& distance) {
+    const glm::vec3 t0 = (box.min - origin) * inverseDirection;
+    const glm::vec3 t1 = (box.max - origin) * inverseDirection;
+    const glm::vec3 near = glm::min(t0, t1);
+    const glm::vec3 far = glm::max(t0, t1);
+    const float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+    const float exit = std::min(std::min(far.x, far.y), std::min(far.z, maxDistance));
+    distance = enter;
+    return enter <= exit;
+}
+
+struct BoundingSphere {
+    glm::vec3 center;
+    float radius;
+};
+
+} // namespace nyanchu
@@ -17,6 +17,8 @@ public:
     void RotateCameraPitch(float angle);
     void LookAt(const glm::vec3& target);
     void ZoomCamera(float delta);
+    void SetPerspective(float fovDegrees, float nearPlane, float farPlane);
+    void SetAspectRatio(float aspect);
 
     // Getters
     const glm::vec3& getPosition() const { return m_position; }
@@ -24,6 +26,13 @@ public:
     glm::mat4 getViewMatrix() const;
     const glm::vec3& getFront() const { return m_front; }
     const glm::vec3& getRight() const { return m_right; }
+    const glm::vec3& getUp() const { return m_up; }
+    float getFov() const { return m_fov; }
+    float getAspectRatio() const { return m_aspect; }
+    float getNearPlane() const { return m_near; }
+    float getFarPlane() const { return m_far; }
+    // homogeneousDepth selects clip depth in [-1, 1] (OpenGL) instead of [0, 1].
+    glm::mat4 getProjectionMatrix(bool homogeneousDepth = true) const;
 
 private:
     void updateVectors();
@@ -40,6 +49,12 @@ private:
     glm::vec3 m_front;
     glm::vec3 m_right;
     glm::vec3 m_worldUp;
+
+    // Projection
+    float m_fov = 60.0f; // vertical, in degrees
+    float m_aspect = 4.0f / 3.0f;
+    float m_near = 0.1f;
+    float m_far = 100.0f;
 };
 
 } // namespace nyanchu
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "bounds.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace nyanchu {
+
+// Dynamic AABB tree for broadphase and spatial queries. Leaves hold boxes
+// fattened by a margin, so objects that move a little inside their fat box
+// need no tree update at all. Inserting picks the sibling with the lowest
+// surface-area cost, and local rotations on the way back up keep the total
+// surface area (and with it the nodes a query visits) low as objects move.
+class DynamicTree {
+public:
+    static constexpr int32_t kNullNode = -1;
+
+    explicit DynamicTree(float margin = 0.1f);
+
+    // Returns a proxy id that stays valid until remove().
+    int32_t insert(const AABB& bounds, uint32_t userData);
+    void remove(int32_t proxy);
+    // Moves a proxy to `bounds`. The fat box is extended along
+    // `displacement` (the motion expected next step). Returns true when the
+    // proxy had to be reinserted.
+    bool update(int32_t proxy, const AABB& bounds, const glm::vec3& displacement = glm::vec3(0.0f));
+
+    uint32_t getUserData(int32_t proxy) const { return m_nodes[proxy].userData; }
+    const AABB& getFatBounds(int32_t proxy) const { return m_nodes[proxy].bounds; }
+    uint32_t getProxyCount() const { return m_proxyCount; }
+    int32_t getHeight() const { return m_root == kNullNode ? 0 : m_nodes[m_root].height; }
+
+    // Calls fn(proxy) for every proxy whose fat box overlaps `bounds`;
+    // fn returns false to stop early. Safe to call from several threads at
+    // once as long as nobody modifies the tree.
+    template <typename Fn>
+    void query(const AABB& bounds, Fn&& fn) const;
+
+    // Calls fn(proxy, maxDistance) for every proxy whose fat box the ray
+    // enters within maxDistance, nearest subtrees first. fn returns the new
+    // maxDistance: the hit distance to clip the ray, maxDistance to ignore
+    // the proxy, or 0 to stop.
+    template <typename Fn>
+    void raycast(const Ray& ray, float maxDistance, Fn&& fn) const;
+
+private:
+    struct Node {
+        AABB bounds;
+        int32_t parent = kNullNode; // next free node while unused
+        int32_t child1 = kNullNode;
+        int32_t child2 = kNullNode;
+        int32_t height = -1;        // 0 for leaves, -1 while unused
+        uint32_t userData = 0;
+
+        bool isLeaf() const { return child1 == kNullNode; }
+    };
+
+    // Traversals need at most height + 1 stack entries. Trees stay far
+    // shallower than this in practice; deeper ones fall back to the heap.
+    static constexpr int32_t kStackSize = 128;
+
+    int32_t allocateNode();
+    void freeNode(int32_t node);
+    void insertLeaf(int32_t leaf);
+    void removeLeaf(int32_t leaf);
+    void rotate(int32_t node);
+    void refit(int32_t node);
+
+    std::vector<Node> m_nodes;
+    int32_t m_root = kNullNode;
+    int32_t m_freeList = kNullNode;
+    uint32_t m_proxyCount = 0;
+    float m_margin;
+};
+
+template <typename Fn>
+void DynamicTree::query(const AABB& bounds, Fn&& fn) const {
+    if (m_root == kNullNode) {
+        return;
+    }
+    int32_t fixed[kStackSize];
+    std::vector<int32_t> spill;
+    int32_t* stack = fixed;
+    if (getHeight() >= kStackSize) {
+        spill.resize(getHeight() + 1);
+        stack = spill.data();
+    }
+    int32_t count = 0;
+    stack[count++] = m_root;
+    while (count > 0) {
+        const Node& node = m_nodes[stack[--count]];
+        if (!node.bounds.overlaps(bounds)) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            if (!fn(static_cast<int32_t>(&node - m_nodes.data()))) {
+                return;
+            }
+        } else {
+            stack[count++] = node.child1;
+            stack[count++] = node.child2;
+        }
+    }
+}
+
+template <typename Fn>
+void DynamicTree::raycast(const Ray& ray, float maxDistance, Fn&& fn) const {
+    if (m_root == kNullNode) {
+        return;
+    }
+    const glm::vec3 inverseDirection = 1.0f / ray.direction;
+    float distance;
+    if (!intersectRay(ray.origin, inverseDirection, m_nodes[m_root].bounds, maxDistance, distance)) {
+        return;
+    }
+
+    int32_t fixedStack[kStackSize];
+    float fixedEntry[kStackSize];
+    std::vector<int32_t> spillStack;
+    std::vector<float> spillEntry;
+    int32_t* stack = fixedStack;
+    float* entry = fixedEntry; // distance at which the ray enters the node
+    if (getHeight() >= kStackSize) {
+        spillStack.resize(getHeight() + 1);
+        spillEntry.resize(getHeight() + 1);
+        stack = spillStack.data();
+        entry = spillEntry.data();
+    }
+    int32_t count = 0;
+    stack[count] = m_root;
+    entry[count++] = distance;
+    while (count > 0) {
+        --count;
+        if (entry[count] > maxDistance) {
+            // Clipped by a hit found since this node was pushed.
+            continue;
+        }
+        const Node& node = m_nodes[stack[count]];
+        if (node.isLeaf()) {
+            maxDistance = fn(stack[count], maxDistance);
+            if (maxDistance <= 0.0f) {
+                return;
+            }
+            continue;
+        }
+
+        float d1, d2;
+        const bool hit1 = intersectRay(ray.origin, inverseDirection, m_nodes[node.child1].bounds, maxDistance, d1);
+        const bool hit2 = intersectRay(ray.origin, inverseDirection, m_nodes[node.child2].bounds, maxDistance, d2);
+        // Push the farther child first so the nearer one is visited next and
+        // can clip the ray early.
+        if (hit1 && hit2) {
+            const bool firstIsNear = d1 <= d2;
+            stack[count] = firstIsNear ? node.child2 : node.child1;
+            entry[count++] = firstIsNear ? d2 : d1;
+            stack[count] = firstIsNear ? node.child1 : node.child2;
+            entry[count++] = firstIsNear ? d1 : d2;
+        } else if (hit1) {
+            stack[count] = node.child1;
+            entry[count++] = d1;
+        } else if (hit2) {
+            stack[count] = node.child2;
+            entry[count++] = d2;
+        }
+    }
+}
+
+} // namespace nyanchu
@@ -1,18 +1,144 @@
 #pragma once
 
+#include "asset_manager.h"
+#include "bounds.h"
+#include "frustum.h"
+
 #include <flecs.h>
 
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
 namespace nyanchu {
 
+class Camera;
+class IRenderer;
+class JobSystem;
+
+// Local transform, relative to the parent entity (ChildOf) if there is one.
+struct Transform {
+    glm::vec3 position{ 0.0f };
+    glm::quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+    glm::vec3 scale{ 1.0f };
+
+    glm::mat4 toMatrix() const {
+        return glm::scale(glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation), scale);
+    }
+};
+
+// Model-to-world matrix, written by the transform systems. Added
+// automatically with Transform.
+struct WorldMatrix {
+    glm::mat4 value{ 1.0f };
+};
+
+// Mesh drawn at the entity's WorldMatrix once the asset is ready.
+struct MeshRef {
+    MeshHandle mesh;
+};
+
+// World-space box of the entity's mesh, used for culling. Added
+// automatically with MeshRef.
+struct Bounds {
+    AABB world{};
+};
+
+struct PickHit {
+    flecs::entity entity;
+    float distance = 0.0f;    // world units along the ray
+    glm::vec3 point{ 0.0f };
+    glm::vec3 normal{ 0.0f }; // world space, facing the ray
+    uint32_t triangle = 0;    // in the entity's mesh
+};
+
+// How a system's callbacks are scheduled.
+enum class SystemExecution {
+    Serial,   // on the thread calling progress()
+    Parallel, // each matched table is split across the ECS threads
+};
+
+// Owns the flecs world and the built-in scene systems, which run in the
+// world's pipeline on every progress():
+//   PostUpdate  WorldMatrix of root entities (multi-threaded), then of
+//               children in parent-first order, then Bounds (multi-threaded)
+//   OnStore     culls MeshRef entities against the camera and submits
+//               instanced draws per mesh to the renderer, recorded across
+//               the job system when there is one
 class ECS {
 public:
-    ECS();
+    // Extraction is skipped while the renderer or camera is null.
+    explicit ECS(IRenderer* renderer = nullptr, const Camera* camera = nullptr, JobSystem* jobs = nullptr);
     ~ECS();
 
     flecs::world& getWorld();
 
+    // Threads that share the work of Parallel systems, including the one
+    // calling progress(). 0 uses every hardware thread.
+    void setThreadCount(uint32_t count);
+    uint32_t getThreadCount() const { return m_threadCount; }
+
+    // Runs every system once, phase by phase.
+    void progress(float deltaTime);
+
+    // Starts declaring a system in `phase`. Parallel systems may only touch
+    // the entities they are handed. Terms are read-only when const and
+    // read-write otherwise; components reached through other means should be
+    // declared with .read<T>() or .write<T>() so the pipeline knows where
+    // queued changes must be merged before the next system reads them.
+    template <typename... Components>
+    flecs::system_builder<Components...> system(const char* name, flecs::entity_t phase = flecs::OnUpdate,
+                                                SystemExecution execution = SystemExecution::Serial) {
+        auto builder = m_world.system<Components...>(name);
+        builder.kind(phase);
+        if (execution == SystemExecution::Parallel) {
+            builder.multi_threaded();
+        }
+        return builder;
+    }
+
+    // Creates an entity with a Transform and, optionally, a mesh and a
+    // parent. The parent must have a Transform too.
+    flecs::entity spawn(const Transform& transform, MeshHandle mesh = nullptr, flecs::entity parent = flecs::entity());
+
+    // Closest MeshRef entity whose triangles the world-space ray hits within
+    // maxDistance; `ray.direction` must be unit length. Entities are placed
+    // as of the last progress(). Each candidate's Bounds are tested first,
+    // then its mesh BVH in object space. Call outside progress().
+    bool raycast(const Ray& ray, float maxDistance, PickHit& hit);
+
 private:
+    void registerComponents();
+    void registerSystems();
+
     flecs::world m_world;
+    IRenderer* m_renderer;
+    const Camera* m_camera;
+    JobSystem* m_jobs;
+    uint32_t m_threadCount = 1;
+    flecs::query<const WorldMatrix, const MeshRef, const Bounds> m_pickQuery;
+
+    // Visible instances per mesh, rebuilt every frame; the vectors keep
+    // their capacity between frames. Keyed by Mesh::getId() so a mesh
+    // freed and replaced at the same address never joins its batch.
+    struct MeshBatch {
+        const Mesh* mesh = nullptr;
+        std::vector<glm::mat4> matrices;
+    };
+    // The batches cut into instanced draws of bounded size, so that even a
+    // single mesh's instances can be recorded on several threads.
+    struct InstancedDraw {
+        const Mesh* mesh;
+        std::span<const glm::mat4> matrices;
+    };
+    Frustum m_frustum;
+    std::unordered_map<uint64_t, MeshBatch> m_batches;
+    std::vector<InstancedDraw> m_draws;
 };
 
-} // namespace nyanchu
\ No newline at end of file
+} // namespace nyanchu
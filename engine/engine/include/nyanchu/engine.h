@@ -1,26 +1,55 @@
 #pragma once
 
 #include "renderer.h"
+#include "asset_manager.h"
 #include "audio.h"
 #include "camera.h"
+#include "ecs.h"
+#include "fixed_timestep.h"
 #include "input.h"
+#include "input_recorder.h"
+#include "job_system.h"
+#include "physics.h"
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 // Forward declare GLFWwindow
 struct GLFWwindow;
 
 namespace nyanchu {
 
+struct EngineConfig {
+    uint32_t width = 800;
+    uint32_t height = 600;
+    // No window, no GLFW: bgfx runs its Noop backend, audio plays on the null
+    // backend and input only changes through replays. The whole frame loop still runs,
+    // so benchmarks work on machines without a display or GPU.
+    bool headless = false;
+    // Simulation rate, independent of the render frame rate.
+    double simulationHz = 60.0;
+    uint32_t maxSubsteps = 8;
+    // Threads for parallel ECS systems; 0 uses every hardware thread.
+    uint32_t ecsThreads = 0;
+};
+
 class Engine {
 public:
     Engine();
     ~Engine();
 
-    void init();
+    void init(const EngineConfig& config = {});
+    bool isHeadless() const { return m_headless; }
+    // Makes isRunning() return false from the next check on.
+    void quit() { m_isRunning = false; }
     bool isRunning();
 
+    // Starts a frame: pumps window events, publishes input and measures the
+    // delta time (or takes both from the replay).
     void pollEvents();
     void beginFrame();
     void endFrame();
@@ -28,8 +57,38 @@ public:
     IRenderer& getRenderer();
     Camera& getCamera();
     Input& getInput();
+    JobSystem& getJobSystem();
+
+    // Seconds since the previous pollEvents; recorded values during replay.
+    float getDeltaTime() const { return m_deltaTime; }
+
+    // Fixed simulation steps due this frame, each getFixedDeltaTime() long.
+    // Render state should blend the last two steps by getInterpolationAlpha().
+    uint32_t getSimulationSteps() const { return m_simulationSteps; }
+    float getFixedDeltaTime() const { return m_timestep.getStepSeconds(); }
+    float getInterpolationAlpha() const { return m_timestep.getAlpha(); }
+    FixedTimestep& getFixedTimestep() { return m_timestep; }
+
+    // Writes every frame's input and delta time to `path` until shutdown.
+    bool startRecording(const std::string& path);
+    // Drives input and delta time from a recording instead of the window.
+    // The engine stops running when the recording ends and prints frame
+    // time statistics for the replayed frames.
+    bool startReplay(const std::string& path);
+    bool isReplaying() const { return m_replay != nullptr; }
+    AssetManager& getAssets();
+    // Scene entities; their systems run in beginFrame and draw through the renderer.
+    ECS& getECS();
+    // Rigid bodies, stepped once per fixed simulation step before the ECS
+    // runs. Entities with a RigidBody follow their body.
+    Physics& getPhysics();
 
-    void playBgm(const std::string& soundName);
+    // Sound effects: load clips up front, then play them through
+    // getAudio().play_sound() as often as needed.
+    Audio& getAudio();
+    SoundId loadSound(std::string_view soundName);
+    // Crossfades from the current track, if any.
+    void playBgm(std::string_view soundName, float crossfadeSeconds = 1.0f);
 
     void resize(int width, int height);
 
@@ -38,14 +97,31 @@ public:
 
 private:
     const std::string& getResourceDir() const;
+    // Joins onto the resource dir in a reused buffer; valid until the next call.
+    const char* resourcePath(std::string_view name);
+    void reportReplay() const;
 
     GLFWwindow* m_window;
     std::unique_ptr<IRenderer> m_renderer;
     std::unique_ptr<Audio> m_audio;
     std::unique_ptr<Camera> m_camera;
     std::unique_ptr<Input> m_input;
+    std::unique_ptr<JobSystem> m_jobs;
+    std::unique_ptr<AssetManager> m_assets;
+    std::unique_ptr<Physics> m_physics;
+    std::unique_ptr<ECS> m_ecs;
+    std::unique_ptr<InputRecorder> m_recorder;
+    std::unique_ptr<InputReplay> m_replay;
+    std::vector<float> m_replayFrameMs;
+    std::chrono::steady_clock::time_point m_lastFrameTime;
+    float m_deltaTime = 0.0f;
+    FixedTimestep m_timestep;
+    uint32_t m_simulationSteps = 0;
     std::string m_resourceDir;
+    std::string m_pathScratch;
     bool m_isRunning = true;
+    bool m_headless = false;
+    bool m_glfwInitialized = false;
 };
 
 } // namespace nyanchu
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+namespace nyanchu {
+
+// Splits variable frame times into fixed simulation steps. Each frame,
+// advance() adds the frame time to an accumulator and returns how many whole
+// steps to simulate; the leftover fraction is exposed as getAlpha() so the
+// renderer can blend between the previous and current simulation state.
+class FixedTimestep {
+public:
+    // Steps per frame are capped at `maxSubsteps`; time beyond that is
+    // dropped so a slow frame cannot snowball into ever slower frames.
+    explicit FixedTimestep(double hz = 60.0, uint32_t maxSubsteps = 8);
+
+    void setRate(double hz);
+    void setMaxSubsteps(uint32_t maxSubsteps) { m_maxSubsteps = maxSubsteps; }
+
+    uint32_t advance(double frameSeconds);
+    void reset();
+
+    double getStep() const { return m_step; }
+    float getStepSeconds() const { return static_cast<float>(m_step); }
+    // In [0, 1): how far the current frame lies past the last simulated step.
+    float getAlpha() const { return static_cast<float>(m_accumulator / m_step); }
+    // Total steps simulated and seconds dropped by the substep clamp.
+    uint64_t getStepCount() const { return m_stepCount; }
+    double getDroppedTime() const { return m_droppedTime; }
+
+private:
+    double m_step;
+    double m_accumulator = 0.0;
+    double m_droppedTime = 0.0;
+    uint64_t m_stepCount = 0;
+    uint32_t m_maxSubsteps;
+};
+
+} // namespace nyanchu
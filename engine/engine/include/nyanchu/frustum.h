@@ -0,0 +1,50 @@
+#pragma once
+
+#include "bounds.h"
+
+#include <cstdint>
+#include <span>
+#include <glm/glm.hpp>
+
+namespace nyanchu {
+
+// Eight boxes in structure-of-arrays form (center/half-extent), the layout
+// the batched frustum test consumes.
+struct AABBBatch8 {
+    alignas(32) float centerX[8];
+    alignas(32) float centerY[8];
+    alignas(32) float centerZ[8];
+    alignas(32) float extentX[8];
+    alignas(32) float extentY[8];
+    alignas(32) float extentZ[8];
+
+    void set(uint32_t lane, const AABB& box);
+};
+
+class Frustum {
+public:
+    Frustum() = default;
+    // Extracts the six planes from a view-projection matrix. Pass false for
+    // homogeneousDepth when the projection maps depth to [0, 1].
+    explicit Frustum(const glm::mat4& viewProj, bool homogeneousDepth = true);
+
+    bool intersects(const AABB& box) const;
+
+    // Bit i of the result is set when box i touches the frustum. Lanes at or
+    // past `count` are ignored.
+    uint8_t intersects8(const AABBBatch8& boxes, uint32_t count = 8) const;
+
+    // Writes 1/0 per box into `visible` (same size as `boxes`) and returns
+    // the number of visible boxes.
+    uint32_t cull(std::span<const AABB> boxes, std::span<uint8_t> visible) const;
+
+private:
+    // Planes as SoA so one plane can be broadcast against eight boxes.
+    // A point p is inside when nx*p.x + ny*p.y + nz*p.z + d >= 0 for all planes.
+    float m_nx[6] = {};
+    float m_ny[6] = {};
+    float m_nz[6] = {};
+    float m_d[6] = {};
+};
+
+} // namespace nyanchu
@@ -2,7 +2,10 @@
 
 #include <glm/glm.hpp>
 #include <GLFW/glfw3.h>
-#include <array>
+#include <bitset>
+#include <cstdint>
+#include <span>
+#include <vector>
 
 namespace nyanchu {
 
@@ -10,14 +13,34 @@ namespace nyanchu {
 using Key = int;
 using MouseButton = int;
 
+// One key or mouse button transition, in the order GLFW reported it.
+struct InputEvent {
+    enum class Type : uint8_t { Key, MouseButton };
+    Type type;
+    bool pressed;  // false for a release
+    int code;      // GLFW key or mouse button
+    int mods;      // GLFW_MOD_* bits
+};
+
+// Driven by GLFW callbacks (installed by Engine): the callbacks update the
+// live state and append to an event queue, and update() publishes what
+// arrived since the last frame. Nothing is polled per key.
 class Input {
 public:
     Input(GLFWwindow* window);
 
+    // Publishes the events received since the previous call. Cost is
+    // proportional to the number of events, not the number of keys.
     void update();
 
+    // Clears all key, button and event state and places the cursor at
+    // `mousePos` with no pending delta.
+    void reset(glm::vec2 mousePos);
+
     // Keyboard
     bool IsKeyDown(Key key);
+    // Pressed/released at any point during the last frame, so a tap that
+    // starts and ends between two updates reports both.
     bool IsKeyPressed(Key key);
     bool IsKeyReleased(Key key);
 
@@ -28,15 +51,36 @@ public:
     bool IsMouseButtonPressed(MouseButton button);
     bool isMouseButtonReleased(MouseButton button);
 
+    // Every key and button transition of the last frame, oldest first.
+    std::span<const InputEvent> getEvents() const { return m_frameEvents; }
+
+    // Callback entry points.
+    void onKey(int key, int action, int mods);
+    void onMouseButton(int button, int action, int mods);
+    void onCursorPos(double x, double y);
+
 private:
-    GLFWwindow* m_window;
+    using KeyBits = std::bitset<GLFW_KEY_LAST + 1>;
+    using ButtonBits = std::bitset<GLFW_MOUSE_BUTTON_LAST + 1>;
 
-    std::array<bool, GLFW_KEY_LAST + 1> m_currentKeys;
-    std::array<bool, GLFW_KEY_LAST + 1> m_previousKeys;
+    // Written by the callbacks during glfwPollEvents.
+    KeyBits m_liveKeys;
+    KeyBits m_pendingKeysPressed;
+    KeyBits m_pendingKeysReleased;
+    ButtonBits m_liveButtons;
+    ButtonBits m_pendingButtonsPressed;
+    ButtonBits m_pendingButtonsReleased;
+    std::vector<InputEvent> m_pendingEvents;
+    glm::vec2 m_liveMousePos;
 
-    std::array<bool, GLFW_MOUSE_BUTTON_LAST + 1> m_currentMouseButtons;
-    std::array<bool, GLFW_MOUSE_BUTTON_LAST + 1> m_previousMouseButtons;
-    
+    // Published by update() and read by the queries.
+    KeyBits m_keys;
+    KeyBits m_keysPressed;
+    KeyBits m_keysReleased;
+    ButtonBits m_buttons;
+    ButtonBits m_buttonsPressed;
+    ButtonBits m_buttonsReleased;
+    std::vector<InputEvent> m_frameEvents;
     glm::vec2 m_currentMousePos;
     glm::vec2 m_previousMousePos;
 };
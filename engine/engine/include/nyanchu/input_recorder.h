@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace nyanchu {
+
+class Input;
+
+// Writes the published Input of every frame, plus its delta time, to a
+// compact binary file that InputReplay can feed back later.
+class InputRecorder {
+public:
+    // `initialMousePos` is the cursor position before the first frame.
+    bool open(const std::string& path, glm::vec2 initialMousePos);
+    // Call after Input::update().
+    void recordFrame(float deltaTime, Input& input);
+    void close();
+
+    bool isOpen() const { return m_file.is_open(); }
+    uint32_t getFrameCount() const { return m_frameCount; }
+
+private:
+    std::ofstream m_file;
+    std::vector<uint8_t> m_buffer;
+    uint32_t m_frameCount = 0;
+};
+
+// Reads a recording made by InputRecorder and replays it through Input's
+// callback entry points, so the published state matches the recorded run.
+class InputReplay {
+public:
+    bool open(const std::string& path);
+
+    // Restores the recorded starting cursor position.
+    void prime(Input& input) const;
+
+    // Feeds the next frame into `input` and updates it. Returns false once
+    // the recording is exhausted.
+    bool nextFrame(Input& input, float& deltaTime);
+
+    uint32_t getFrameIndex() const { return m_frameIndex; }
+
+private:
+    std::vector<uint8_t> m_data;
+    size_t m_offset = 0;
+    uint32_t m_frameIndex = 0;
+    glm::vec2 m_initialMousePos{ 0.0f };
+};
+
+} // namespace nyanchu
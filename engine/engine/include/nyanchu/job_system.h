@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nyanchu {
+
+// Fixed pool of worker threads shared by the engine subsystems.
+class JobSystem {
+public:
+    using RangeFn = std::function<void(uint32_t begin, uint32_t end)>;
+
+    // `threadCount` includes the calling thread; 0 uses every hardware thread.
+    explicit JobSystem(uint32_t threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Number of threads that run parallelFor ranges, including the caller.
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+    // Runs fn over [0, count) in batches of `batchSize` and returns once every
+    // batch is done. The calling thread works on batches too, so this is safe
+    // to call from inside a job.
+    void parallelFor(uint32_t count, uint32_t batchSize, const RangeFn& fn);
+
+    // Queues a task on the workers without waiting for it.
+    void submit(std::function<void()> task);
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_queue;
+    bool m_stopping = false;
+};
+
+} // namespace nyanchu
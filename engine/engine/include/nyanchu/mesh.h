@@ -1,11 +1,16 @@
-
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
 #include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
 
+#include "bounds.h"
+#include "triangle_bvh.h"
+
 namespace nyanchu {
 
 struct Vertex {
@@ -31,18 +36,81 @@ namespace std {
 
 namespace nyanchu {
 
+class JobSystem;
+
 class Mesh {
 public:
-    Mesh(const std::string& filepath);
+    // Loads `filepath` through its cooked sibling (see cookedPathFor) when that
+    // file exists and records the OBJ's current size and modification time;
+    // otherwise parses the OBJ and writes a fresh cooked file for the next run.
+    // With `jobs`, large OBJ files are parsed in parallel; the result is
+    // identical to the serial parse.
+    Mesh(const std::string& filepath, JobSystem* jobs = nullptr);
+    // Wraps geometry built in code, e.g. procedural or generated meshes.
+    Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices);
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    // The id and the data move together; the source is left empty with an
+    // id of its own.
+    Mesh(Mesh&& other) noexcept;
+    Mesh& operator=(Mesh&& other) noexcept;
+
+    // Names this mesh's geometry for caches keyed across frames and threads,
+    // such as a renderer's GPU buffers. Unlike the address it is never
+    // reused, so a cache entry can outlive its mesh without aliasing another.
+    uint64_t getId() const { return m_id; }
+
+    // Views stay valid for the lifetime of the Mesh. For cooked meshes they
+    // point straight into the memory-mapped file.
+    std::span<const Vertex> getVertices() const { return m_vertexView; }
+    std::span<const uint32_t> getIndices() const { return m_indexView; }
+
+    // Object-space bounds, computed once at load (or read from the cooked file).
+    const AABB& getBounds() const { return m_bounds; }
+    const BoundingSphere& getBoundingSphere() const { return m_sphere; }
 
-    const std::vector<Vertex>& getVertices() const { return m_vertices; }
-    const std::vector<uint32_t>& getIndices() const { return m_indices; }
+    // Triangle BVH over the object-space positions, built at load (or read
+    // from the cooked file).
+    const TriangleBVH& getBVH() const { return m_bvh; }
+    // Closest triangle hit by an object-space ray; see TriangleBVH::raycast.
+    bool raycast(const Ray& ray, float maxDistance, MeshHit& hit) const { return m_bvh.raycast(ray, maxDistance, hit); }
+
+    // True when the data is served from a memory-mapped cooked file.
+    bool isMapped() const { return m_mapping != nullptr; }
+
+    // Parses an OBJ without reading or writing the cooked cache.
+    static Mesh parseObj(const std::string& objPath, JobSystem* jobs = nullptr);
+
+    // Offline cooking: parses `objPath` and writes the binary mesh to `cookedPath`.
+    static bool cook(const std::string& objPath, const std::string& cookedPath, JobSystem* jobs = nullptr);
+    static std::string cookedPathFor(const std::string& objPath);
 
 private:
-    void loadFromFile(const std::string& filepath);
+    Mesh() = default;
 
+    void loadFromFile(const std::string& filepath, JobSystem* jobs);
+    void loadObj(const std::string& filepath, JobSystem* jobs);
+    void loadObjSerial(const std::string& filepath);
+    bool loadObjParallel(const std::string& filepath, JobSystem& jobs);
+    bool loadCooked(const std::string& cookedPath, const std::string& sourcePath);
+    bool writeCooked(const std::string& cookedPath, const std::string& sourcePath) const;
+    void computeBounds();
+    void buildBVH();
+    static uint64_t newId();
+
+    uint64_t m_id = newId();
     std::vector<Vertex> m_vertices;
     std::vector<uint32_t> m_indices;
+
+    // Keeps the mapped cooked file alive while the views point into it.
+    std::shared_ptr<const void> m_mapping;
+    std::span<const Vertex> m_vertexView;
+    std::span<const uint32_t> m_indexView;
+
+    AABB m_bounds{};
+    BoundingSphere m_sphere{};
+    TriangleBVH m_bvh;
 };
 
 } // namespace nyanchu
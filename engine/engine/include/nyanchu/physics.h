@@ -1,10 +1,236 @@
 #pragma once
 
+#include "bounds.h"
+#include "dynamic_tree.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
 namespace nyanchu {
 
+class ECS;
+class FixedTimestep;
+class JobSystem;
+class Mesh;
+
+using BodyId = uint32_t;
+constexpr BodyId kInvalidBody = std::numeric_limits<BodyId>::max();
+
+enum class ShapeType : uint8_t { Sphere, Box, Mesh };
+
+struct Collider {
+    ShapeType type = ShapeType::Sphere;
+    float radius = 0.5f;                // Sphere
+    glm::vec3 halfExtents{ 0.5f };      // Box
+    const Mesh* mesh = nullptr;         // Mesh; must outlive the body
+
+    static Collider sphere(float radius) { Collider c; c.type = ShapeType::Sphere; c.radius = radius; return c; }
+    static Collider box(const glm::vec3& halfExtents) { Collider c; c.type = ShapeType::Box; c.halfExtents = halfExtents; return c; }
+    // Triangle meshes only collide as static bodies.
+    static Collider triangleMesh(const Mesh& mesh) { Collider c; c.type = ShapeType::Mesh; c.mesh = &mesh; return c; }
+};
+
+enum class BodyType : uint8_t { Static, Dynamic };
+
+struct BodyDesc {
+    BodyType type = BodyType::Dynamic;
+    Collider collider;
+    glm::vec3 position{ 0.0f };
+    glm::quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+    glm::vec3 linearVelocity{ 0.0f };
+    glm::vec3 angularVelocity{ 0.0f };
+    float mass = 1.0f; // ignored for static bodies
+    float friction = 0.5f;
+    float restitution = 0.1f;
+};
+
+// Links an ECS entity to a body. The body's pose is written to the entity's
+// Transform every frame, interpolated between the last two physics steps.
+// Removing the component (or deleting the entity) destroys the body. Only
+// root entities should carry one, since the pose is written as a local
+// transform.
+struct RigidBody {
+    BodyId id = kInvalidBody;
+};
+
+struct RayHit {
+    BodyId body = kInvalidBody;
+    float distance = 0.0f;
+    glm::vec3 point{ 0.0f };
+    glm::vec3 normal{ 0.0f }; // surface normal, facing the ray
+};
+
+struct PhysicsStats {
+    uint32_t bodies = 0;
+    uint32_t pairs = 0;    // broadphase overlaps
+    uint32_t contacts = 0; // contact points fed to the solver
+    uint32_t colors = 0;   // constraint batches solved in parallel
+    uint32_t treeHeight = 0;
+    uint32_t reinserted = 0; // bodies that left their fat box this step
+    double broadphaseMs = 0.0;
+    double narrowphaseMs = 0.0;
+    double solverMs = 0.0;
+};
+
+// Rigid-body simulation with sphere, box and static triangle-mesh colliders.
+// Bodies live in a dynamic AABB tree, which each step queries for
+// overlapping pairs and gameplay code queries for rays and volumes. Each
+// step generates contact points for those pairs and solves them with
+// sequential impulses. Contacts are graph colored so that no two in a color
+// share a dynamic body, which lets every color be solved across the job
+// system without locks.
 class Physics {
 public:
-    // Placeholder
+    // Without `jobs` every stage runs on the calling thread.
+    explicit Physics(JobSystem* jobs = nullptr);
+    ~Physics();
+
+    Physics(const Physics&) = delete;
+    Physics& operator=(const Physics&) = delete;
+
+    BodyId createBody(const BodyDesc& desc);
+    void destroyBody(BodyId id);
+    bool isValid(BodyId id) const { return id < m_bodies.size() && m_bodies[id].alive; }
+    uint32_t getBodyCount() const { return m_bodyCount; }
+
+    glm::vec3 getPosition(BodyId id) const { return m_bodies[id].position; }
+    glm::quat getRotation(BodyId id) const { return m_bodies[id].rotation; }
+    glm::vec3 getLinearVelocity(BodyId id) const { return m_bodies[id].linearVelocity; }
+    glm::vec3 getAngularVelocity(BodyId id) const { return m_bodies[id].angularVelocity; }
+    // Pose blended between the previous and the current step; alpha in [0, 1].
+    glm::vec3 getInterpolatedPosition(BodyId id, float alpha) const;
+    glm::quat getInterpolatedRotation(BodyId id, float alpha) const;
+    AABB getBounds(BodyId id) const { return m_bodies[id].bounds; }
+
+    // Teleports the body; interpolation does not blend across the jump.
+    void setTransform(BodyId id, const glm::vec3& position, const glm::quat& rotation);
+    void setLinearVelocity(BodyId id, const glm::vec3& velocity);
+    void setAngularVelocity(BodyId id, const glm::vec3& velocity);
+    void applyImpulse(BodyId id, const glm::vec3& impulse, const glm::vec3& worldPoint);
+
+    void setGravity(const glm::vec3& gravity) { m_gravity = gravity; }
+    const glm::vec3& getGravity() const { return m_gravity; }
+    void setSolverIterations(uint32_t iterations) { m_solverIterations = iterations; }
+
+    // Advances the simulation by `dt` seconds. Meant to be called with a
+    // fixed dt, once per FixedTimestep step.
+    void step(float dt);
+
+    // Adds the RigidBody component and a PreUpdate system that copies body
+    // poses into Transforms, interpolated by the timestep's alpha. Physics
+    // must outlive the ECS.
+    void attach(ECS& ecs, const FixedTimestep& timestep);
+
+    // Nearest body the ray hits within maxDistance; `direction` need not be
+    // normalized. Safe to call from any thread while no step is running.
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) const;
+    // Appends the bodies whose bounds overlap `bounds`.
+    void queryAABB(const AABB& bounds, std::vector<BodyId>& results) const;
+    // Appends the bodies whose shape touches the sphere.
+    void querySphere(const glm::vec3& center, float radius, std::vector<BodyId>& results) const;
+
+    const PhysicsStats& getStats() const { return m_stats; }
+
+private:
+    struct Body {
+        glm::vec3 position{ 0.0f };
+        glm::quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+        glm::vec3 previousPosition{ 0.0f };
+        glm::quat previousRotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+        glm::vec3 linearVelocity{ 0.0f };
+        glm::vec3 angularVelocity{ 0.0f };
+        glm::vec3 inverseInertiaLocal{ 0.0f };
+        glm::mat3 inverseInertiaWorld{ 0.0f };
+        float inverseMass = 0.0f;
+        float friction = 0.5f;
+        float restitution = 0.1f;
+        Collider collider;
+        AABB bounds{};
+        int32_t proxy = DynamicTree::kNullNode;
+        bool alive = false;
+
+        bool isDynamic() const { return inverseMass > 0.0f; }
+    };
+
+    struct ContactPoint {
+        glm::vec3 position;
+        glm::vec3 normal; // from body a towards body b
+        float depth;
+    };
+
+    static constexpr uint32_t kMaxManifoldPoints = 4;
+
+    struct Manifold {
+        uint32_t count = 0;
+        ContactPoint points[kMaxManifoldPoints];
+
+        void add(const ContactPoint& point);
+    };
+
+    struct ConstraintPoint {
+        glm::vec3 position; // world space, to match contacts across steps
+        glm::vec3 rA, rB;
+        glm::vec3 normal, tangent1, tangent2;
+        float normalMass;
+        float tangentMass[2];
+        float bias;
+        float normalImpulse;
+        float tangentImpulse[2];
+    };
+
+    struct Constraint {
+        uint32_t a, b;
+        float friction;
+        uint32_t count;
+        ConstraintPoint points[kMaxManifoldPoints];
+    };
+
+    struct BodyPair {
+        uint32_t a, b;
+    };
+
+    void forEach(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t, uint32_t)>& fn);
+
+    void updateBody(Body& body);
+    void integrateVelocities(float dt);
+    void findPairs();
+    bool raycastBody(const Body& body, const Ray& ray, float maxDistance, RayHit& hit) const;
+    void collide(const BodyPair& pair, Manifold& manifold) const;
+    void buildConstraints(float dt);
+    void colorConstraints();
+    void warmStart();
+    void solve();
+    void solveConstraint(Constraint& constraint);
+    void applyImpulses(Constraint& constraint);
+    void integratePositions(float dt);
+
+    JobSystem* m_jobs;
+    std::vector<Body> m_bodies;
+    std::vector<BodyId> m_freeIds;
+    uint32_t m_bodyCount = 0;
+    DynamicTree m_tree;
+
+    glm::vec3 m_gravity{ 0.0f, -9.81f, 0.0f };
+    uint32_t m_solverIterations = 8;
+
+    // Per-step scratch, kept to avoid reallocating every step.
+    std::vector<std::vector<BodyPair>> m_batchPairs;
+    std::vector<BodyPair> m_pairs;
+    std::vector<Manifold> m_manifolds;
+    std::vector<uint32_t> m_contactPairs; // indices into m_pairs with contacts
+    std::vector<Constraint> m_constraints;
+    // Last step's constraints, looked up by body pair to warm start the solver.
+    std::vector<Constraint> m_previousConstraints;
+    std::vector<std::pair<uint64_t, uint32_t>> m_previousLookup;
+    std::vector<std::vector<uint32_t>> m_colors;
+    std::vector<uint64_t> m_bodyColors;
+
+    PhysicsStats m_stats;
 };
 
 } // namespace nyanchu
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace nyanchu {
+
+// Scoped CPU timers for frame analysis. Each thread records into its own
+// ring buffer, so the hot path is two clock reads and a store; the last
+// kEventsPerThread events of every thread can be exported as a Chrome trace
+// (chrome://tracing or https://ui.perfetto.dev).
+class Profiler {
+public:
+    static constexpr uint32_t kEventsPerThread = 1 << 16;
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Label for the calling thread in exported traces.
+    static void setThreadName(const std::string& name);
+
+    // Nanoseconds since the profiler's time base.
+    static int64_t now();
+
+    // `name` must outlive the profiler; string literals are expected.
+    static void record(const char* name, int64_t startNs, int64_t endNs);
+
+    // Writes the buffered events of every thread that has recorded anything.
+    // Call between frames: events recorded while exporting may be torn.
+    static bool writeChromeTrace(const std::string& path);
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name)
+        : m_name(name)
+        , m_start(Profiler::isEnabled() ? Profiler::now() : -1)
+    {
+    }
+    ~ProfileScope() {
+        if (m_start >= 0) {
+            Profiler::record(m_name, m_start, Profiler::now());
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* m_name;
+    int64_t m_start;
+};
+
+} // namespace nyanchu
+
+#define NYANCHU_PROFILE_CONCAT_INNER(a, b) a##b
+#define NYANCHU_PROFILE_CONCAT(a, b) NYANCHU_PROFILE_CONCAT_INNER(a, b)
+
+#if NYANCHU_ENABLE_PROFILER
+#define NYANCHU_PROFILE_SCOPE(name) ::nyanchu::ProfileScope NYANCHU_PROFILE_CONCAT(nyanchuProfileScope, __LINE__)(name)
+#else
+#define NYANCHU_PROFILE_SCOPE(name) ((void)0)
+#endif
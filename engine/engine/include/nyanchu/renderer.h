@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
+#include <span>
 
 // Forward declare GLFWwindow
 struct GLFWwindow;
@@ -12,11 +14,32 @@ struct GLFWwindow;
 namespace nyanchu {
 
 class Camera;
+class JobSystem;
+
+// Per-frame counters, reset by beginFrame.
+struct RenderStats {
+    uint32_t visible = 0; // objects submitted to the GPU
+    uint32_t culled = 0;  // objects rejected by frustum culling
+};
+
+// Records draws for one slice of IRenderer::recordParallel, on whichever
+// thread runs that slice.
+class RenderEncoder
+{
+public:
+    virtual void drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix) = 0;
+    virtual void drawMeshInstanced(const Mesh& mesh, std::span<const glm::mat4> modelMatrices) = 0;
+
+protected:
+    ~RenderEncoder() = default;
+};
 
 // Abstract base class for renderers
 class IRenderer
 {
 public:
+    using RecordFn = std::function<void(RenderEncoder& encoder, uint32_t begin, uint32_t end)>;
+
     virtual ~IRenderer() = default;
 
     virtual bool initialize(GLFWwindow* window, uint32_t width, uint32_t height) = 0;
@@ -25,10 +48,46 @@ public:
     virtual void beginFrame(const Camera& camera) = 0;
     virtual void endFrame() = 0;
 
+    // Creates the GPU buffers for `mesh` up front; drawMesh does it lazily otherwise.
+    virtual void uploadMesh(const Mesh& mesh) = 0;
+    // Frees the GPU buffers of a mesh that is about to be destroyed or
+    // assigned over. Buffers are cached by Mesh::getId(), so a mesh that
+    // skips this only leaks them; it never hands them to another mesh.
+    virtual void releaseMesh(const Mesh& mesh) = 0;
+
     virtual void drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix) = 0;
+    // Draws one copy of `mesh` per model matrix with a single instanced submit.
+    virtual void drawMeshInstanced(const Mesh& mesh, std::span<const glm::mat4> modelMatrices) = 0;
     virtual void drawTriangle() = 0;
     virtual void drawCube(const glm::mat4& modelMatrix) = 0;
     virtual void resize(uint32_t width, uint32_t height) = 0;
+
+    // Splits [0, itemCount) into slices and records each through its own
+    // encoder, in parallel where the renderer supports it. Returns once
+    // every slice is recorded, so call it between beginFrame and endFrame.
+    // Meshes drawn this way must already be uploaded with uploadMesh. The
+    // default records everything on the calling thread.
+    virtual void recordParallel(JobSystem& jobs, uint32_t itemCount, const RecordFn& record);
+
+    virtual const RenderStats& getStats() const = 0;
 };
 
+// Serial fallback: the whole range through an encoder that forwards to the
+// renderer's own draw calls.
+inline void IRenderer::recordParallel(JobSystem&, uint32_t itemCount, const RecordFn& record)
+{
+    struct ForwardingEncoder final : RenderEncoder {
+        IRenderer& renderer;
+        explicit ForwardingEncoder(IRenderer& target) : renderer(target) {}
+        void drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix) override { renderer.drawMesh(mesh, modelMatrix); }
+        void drawMeshInstanced(const Mesh& mesh, std::span<const glm::mat4> modelMatrices) override {
+            renderer.drawMeshInstanced(mesh, modelMatrices);
+        }
+    };
+    if (itemCount > 0) {
+        ForwardingEncoder encoder(*this);
+        record(encoder, 0, itemCount);
+    }
+}
+
 } // namespace nyanchu
\ No newline at end of file
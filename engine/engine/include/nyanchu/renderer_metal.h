@@ -22,11 +22,17 @@ public:
     void beginFrame(const Camera& camera) override;
     void endFrame() override;
 
+    void uploadMesh(const Mesh& mesh) override;
+    void releaseMesh(const Mesh& mesh) override;
+
     void drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix) override;
+    void drawMeshInstanced(const Mesh& mesh, std::span<const glm::mat4> modelMatrices) override;
     void drawTriangle() override;
     void drawCube(const glm::mat4& modelMatrix) override;
     void resize(uint32_t width, uint32_t height) override;
 
+    const RenderStats& getStats() const override;
+
 private:
     std::unique_ptr<RendererMetalImpl> _impl;
 };
@@ -1,14 +1,47 @@
 #pragma once
 
 #include "renderer.h"
+#include "frustum.h"
 #include <bgfx/bgfx.h>
 #include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
 
 // Forward declare GLFWwindow
 struct GLFWwindow;
 
 namespace nyanchu {
 
+class JobSystem;
+class RendererBGFX;
+
+// Culling scratch for one instanced draw, kept to avoid per-frame
+// allocations.
+struct InstanceScratch {
+    std::vector<AABB> bounds;
+    std::vector<uint8_t> visible;
+    std::vector<glm::mat4> instances;
+};
+
+// Records draws from one thread into that thread's own bgfx::Encoder.
+// Handed out by RendererBGFX::recordParallel.
+class RenderEncoderBGFX final : public RenderEncoder
+{
+public:
+    void drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix) override;
+    void drawMeshInstanced(const Mesh& mesh, std::span<const glm::mat4> modelMatrices) override;
+
+private:
+    friend class RendererBGFX;
+    RenderEncoderBGFX(RendererBGFX& renderer, bgfx::Encoder* encoder, InstanceScratch& scratch);
+
+    RendererBGFX& m_renderer;
+    bgfx::Encoder* m_encoder;
+    InstanceScratch& m_scratch;
+    RenderStats m_stats;
+};
+
 // Concrete BGFX implementation
 class RendererBGFX : public IRenderer
 {
@@ -16,25 +49,72 @@ public:
     RendererBGFX();
     ~RendererBGFX() override;
 
+    // Passing a null window initializes bgfx with the Noop backend, so the
+    // whole submission path can run headless.
     bool initialize(GLFWwindow* window, uint32_t width, uint32_t height) override;
     void shutdown() override;
 
     void beginFrame(const Camera& camera) override;
     void endFrame() override;
 
+    // Creates the static GPU buffers for `mesh` once; later draws reuse them.
+    void uploadMesh(const Mesh& mesh) override;
+    void releaseMesh(const Mesh& mesh) override;
+
     void drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix) override;
+    void drawMeshInstanced(const Mesh& mesh, std::span<const glm::mat4> modelMatrices) override;
     void drawTriangle() override;
     void drawCube(const glm::mat4& modelMatrix) override;
     void resize(uint32_t width, uint32_t height) override;
 
+    const RenderStats& getStats() const override { return m_stats; }
+
     void render();
 
+    // Records each slice through its own encoder on the job system's
+    // threads, up to the backend's encoder limit.
+    void recordParallel(JobSystem& jobs, uint32_t itemCount, const RecordFn& record) override;
+
 private:
+    friend class RenderEncoderBGFX;
+
+    struct MeshBuffers {
+        bgfx::VertexBufferHandle vbh = BGFX_INVALID_HANDLE;
+        bgfx::IndexBufferHandle ibh = BGFX_INVALID_HANDLE;
+        AABB bounds{}; // object space
+    };
+
+    const MeshBuffers& getMeshBuffers(const Mesh& mesh);
+    const MeshBuffers* findMeshBuffers(const Mesh& mesh) const;
+    void submitMesh(bgfx::Encoder* encoder, const MeshBuffers& buffers, const glm::mat4& modelMatrix);
+    // Culls the instances and submits the survivors; counts into `stats`.
+    void submitMeshInstanced(bgfx::Encoder* encoder, const MeshBuffers& buffers,
+                             std::span<const glm::mat4> modelMatrices, InstanceScratch& scratch, RenderStats& stats);
+    bool isVisible(const MeshBuffers& buffers, const glm::mat4& modelMatrix) const;
+
     bgfx::VertexBufferHandle m_vbh;
     bgfx::ProgramHandle m_program;
 
+    bgfx::VertexLayout m_meshLayout;
+    bgfx::ProgramHandle m_meshProgram;
+    bgfx::ProgramHandle m_meshInstancedProgram;
+    std::unordered_map<uint64_t, MeshBuffers> m_meshBuffers; // by Mesh::getId()
+
+    Frustum m_frustum;
+    RenderStats m_stats;
+
+    // For instanced draws on the API thread, and one per parallel slice.
+    InstanceScratch m_instanceScratch;
+    std::vector<InstanceScratch> m_sliceScratch;
+
+    uint32_t m_maxThreadEncoders = 1;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    bool m_headless = false;
+
     // Helper function to load shader binaries
     static const bgfx::Memory* loadShader(const char* _name);
+    static bgfx::ProgramHandle loadProgram(const char* vsName, const char* fsName);
 };
 
 } // namespace nyanchu
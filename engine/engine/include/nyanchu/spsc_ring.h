@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace nyanchu {
+
+// Fixed-capacity FIFO between exactly one producer thread and one consumer
+// thread. Both ends are wait-free and never allocate; a full ring rejects
+// the push instead of blocking.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer only.
+    bool push(const T& value) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity) return false;
+        m_items[tail & (Capacity - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer only. The consumer can only free more slots meanwhile, so a
+    // producer that sees n free slots can push n items.
+    size_t freeSlots() const {
+        return Capacity - (m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_acquire));
+    }
+
+    // Consumer only. Hands every item pushed so far to `f`, oldest first,
+    // and frees their slots at once. Returns how many there were.
+    template <typename F>
+    size_t drain(F&& f) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        for (size_t i = head; i != tail; ++i) {
+            f(m_items[i & (Capacity - 1)]);
+        }
+        m_head.store(tail, std::memory_order_release);
+        return tail - head;
+    }
+
+    // Either thread; a snapshot that may already be stale.
+    size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    // Each index on its own cache line, so the two threads do not contend.
+    alignas(64) std::atomic<size_t> m_head{ 0 };
+    alignas(64) std::atomic<size_t> m_tail{ 0 };
+    alignas(64) std::array<T, Capacity> m_items{};
+};
+
+} // namespace nyanchu
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "renderer.h"
+#include "camera.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nyanchu {
+
+// Runs another renderer on a dedicated render thread, one frame behind the
+// caller. Draw calls between beginFrame and endFrame are only recorded into
+// a FrameData; endFrame hands that frame to the render thread and recording
+// continues into the other buffer, so simulating frame N+1 overlaps with
+// culling and submitting frame N.
+//
+// Every call into the wrapped renderer happens on the render thread, which
+// therefore owns the graphics API. Meshes passed to draw calls must stay
+// alive until they are released with releaseMesh.
+class ThreadedRenderer : public IRenderer
+{
+public:
+    explicit ThreadedRenderer(std::unique_ptr<IRenderer> renderer);
+    ~ThreadedRenderer() override;
+
+    ThreadedRenderer(const ThreadedRenderer&) = delete;
+    ThreadedRenderer& operator=(const ThreadedRenderer&) = delete;
+
+    // Starts the render thread and initializes the wrapped renderer on it.
+    bool initialize(GLFWwindow* window, uint32_t width, uint32_t height) override;
+    void shutdown() override;
+
+    void beginFrame(const Camera& camera) override;
+    // Waits for the render thread to finish the previous frame, then submits
+    // this one without waiting for it.
+    void endFrame() override;
+
+    void uploadMesh(const Mesh& mesh) override;
+    // Blocks until the render thread has finished the frame in flight, since
+    // that frame may still draw the mesh.
+    void releaseMesh(const Mesh& mesh) override;
+
+    void drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix) override;
+    void drawMeshInstanced(const Mesh& mesh, std::span<const glm::mat4> modelMatrices) override;
+    void drawTriangle() override;
+    void drawCube(const glm::mat4& modelMatrix) override;
+    void resize(uint32_t width, uint32_t height) override;
+
+    // Records each slice on the job system into a command list of its own.
+    // The render thread replays the slices through the wrapped renderer's
+    // recordParallel on the same job system, which must outlive the frame.
+    void recordParallel(JobSystem& jobs, uint32_t itemCount, const RecordFn& record) override;
+
+    // Counters of the last frame the render thread completed.
+    const RenderStats& getStats() const override { return m_stats; }
+
+private:
+    // Everything the render thread needs to replay one frame.
+    struct FrameData {
+        enum class CommandType : uint8_t { Upload, Mesh, MeshInstanced, Triangle, Cube, Parallel };
+        struct Command {
+            CommandType type;
+            const Mesh* mesh;
+            uint64_t meshId; // Mesh::getId(), or 0 without a mesh
+            uint32_t firstMatrix; // Parallel: index into batches
+            uint32_t matrixCount;
+        };
+
+        // Commands with the model matrices they draw at.
+        struct CommandList {
+            std::vector<Command> commands;
+            std::vector<glm::mat4> matrices;
+
+            void clear();
+            void add(CommandType type, const Mesh* mesh, std::span<const glm::mat4> matrices);
+            void remove(const Mesh& mesh);
+        };
+
+        // One recordParallel call, as a run of slices.
+        struct ParallelBatch {
+            JobSystem* jobs;
+            uint32_t firstSlice;
+            uint32_t sliceCount;
+        };
+
+        Camera camera;
+        CommandList draws;
+        // Only the first usedSlices are this frame's; the rest keep their
+        // capacity for later frames.
+        std::vector<CommandList> slices;
+        uint32_t usedSlices = 0;
+        std::vector<ParallelBatch> batches;
+        bool resized = false;
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        void clear();
+    };
+    class SliceEncoder;
+
+    void renderLoop();
+    void renderFrame(FrameData& frame);
+    static void replaySlice(const FrameData::CommandList& slice, RenderEncoder& encoder);
+    void waitForIdle(std::unique_lock<std::mutex>& lock);
+    void runOnRenderThread(const std::function<void()>& task);
+
+    FrameData& recording() { return m_frames[m_recordIndex]; }
+
+    std::unique_ptr<IRenderer> m_renderer;
+    FrameData m_frames[2];
+    uint32_t m_recordIndex = 0;
+    RenderStats m_stats;
+
+    // Hand-off to the render thread: at most one frame or task at a time.
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    FrameData* m_submitted = nullptr;
+    const std::function<void()>* m_task = nullptr;
+    bool m_quit = false;
+    std::thread m_thread;
+};
+
+} // namespace nyanchu
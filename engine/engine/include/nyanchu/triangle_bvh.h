@@ -0,0 +1,126 @@
+#pragma once
+
+#include "bounds.h"
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace nyanchu {
+
+struct MeshHit {
+    float distance = 0.0f;      // along the ray, in multiples of its direction
+    uint32_t triangle = 0;      // first index of the triangle / 3
+    float u = 0.0f, v = 0.0f;   // barycentric weights of corners 1 and 2
+    glm::vec3 normal{ 0.0f };   // unit geometric normal, facing the ray
+};
+
+// Bounding volume hierarchy over a mesh's triangles for ray and box
+// queries. Built once with binned SAH; each leaf packs up to four triangles
+// structure-of-arrays so a ray is tested against all four in one SIMD pass.
+// The arrays are flat and position independent, so a cooked mesh can store
+// them and use them straight from the mapped file.
+class TriangleBVH {
+public:
+    struct Node {
+        float min[3];
+        uint32_t first; // inner: left child (the right one is first + 1); leaf: first block
+        float max[3];
+        uint32_t count; // leaf: number of blocks; 0 for inner nodes
+    };
+
+    // Four triangles as corner 0 plus the edges to corners 1 and 2. Unused
+    // lanes are degenerate and never hit.
+    struct alignas(16) Block {
+        float v0[3][4];
+        float e1[3][4];
+        float e2[3][4];
+        uint32_t triangle[4];
+    };
+
+    TriangleBVH() = default;
+    TriangleBVH(const TriangleBVH&) = delete;
+    TriangleBVH& operator=(const TriangleBVH&) = delete;
+    TriangleBVH(TriangleBVH&&) = default;
+    TriangleBVH& operator=(TriangleBVH&&) = default;
+
+    static TriangleBVH build(std::span<const glm::vec3> positions, std::span<const uint32_t> indices);
+    // Wraps arrays produced by build(), e.g. from a cooked file; they must
+    // outlive the BVH.
+    static TriangleBVH view(std::span<const Node> nodes, std::span<const Block> blocks);
+    // Checks arrays from an untrusted source before view(): every child and
+    // block index in range, children after their parent, triangles below
+    // triangleCount, and a tree shallow enough for raycast()'s stack.
+    static bool validate(std::span<const Node> nodes, std::span<const Block> blocks, uint32_t triangleCount);
+
+    // Closest triangle the ray hits within maxDistance. The direction need
+    // not be unit length; distances are measured in multiples of it, which
+    // keeps them valid after transforming the ray into object space.
+    bool raycast(const Ray& ray, float maxDistance, MeshHit& hit) const;
+    // Calls fn(triangle, v0, v1, v2) for each triangle whose bounds overlap
+    // the box, corners in the mesh's space. Returning false stops the query.
+    template <typename Fn>
+    void query(const AABB& bounds, Fn&& fn) const;
+
+    bool empty() const { return m_nodeView.empty(); }
+    std::span<const Node> getNodes() const { return m_nodeView; }
+    std::span<const Block> getBlocks() const { return m_blockView; }
+
+private:
+    // Deep enough for any tree build() makes; validate() rejects deeper ones.
+    static constexpr int kStackSize = 64;
+
+    std::vector<Node> m_nodes;
+    std::vector<Block> m_blocks;
+    std::span<const Node> m_nodeView;
+    std::span<const Block> m_blockView;
+};
+
+template <typename Fn>
+void TriangleBVH::query(const AABB& bounds, Fn&& fn) const {
+    if (m_nodeView.empty()) {
+        return;
+    }
+    auto overlaps = [&](const Node& node) {
+        return node.min[0] <= bounds.max.x && node.max[0] >= bounds.min.x &&
+               node.min[1] <= bounds.max.y && node.max[1] >= bounds.min.y &&
+               node.min[2] <= bounds.max.z && node.max[2] >= bounds.min.z;
+    };
+    if (!overlaps(m_nodeView[0])) {
+        return;
+    }
+
+    uint32_t stack[kStackSize];
+    int count = 0;
+    stack[count++] = 0;
+    while (count > 0) {
+        const Node& node = m_nodeView[stack[--count]];
+        if (node.count == 0) {
+            for (uint32_t child = node.first; child < node.first + 2; ++child) {
+                if (count < kStackSize && overlaps(m_nodeView[child])) {
+                    stack[count++] = child;
+                }
+            }
+            continue;
+        }
+        for (uint32_t b = node.first; b < node.first + node.count; ++b) {
+            const Block& block = m_blockView[b];
+            for (uint32_t lane = 0; lane < 4; ++lane) {
+                if (block.triangle[lane] == std::numeric_limits<uint32_t>::max()) {
+                    continue;
+                }
+                const glm::vec3 v0(block.v0[0][lane], block.v0[1][lane], block.v0[2][lane]);
+                const glm::vec3 v1 = v0 + glm::vec3(block.e1[0][lane], block.e1[1][lane], block.e1[2][lane]);
+                const glm::vec3 v2 = v0 + glm::vec3(block.e2[0][lane], block.e2[1][lane], block.e2[2][lane]);
+                const AABB triangle{ glm::min(v0, glm::min(v1, v2)), glm::max(v0, glm::max(v1, v2)) };
+                if (triangle.overlaps(bounds) && !fn(block.triangle[lane], v0, v1, v2)) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+} // namespace nyanchu
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "mesh.h"
+
+namespace nyanchu {
+
+// Open-addressing table that merges identical vertices while a mesh is being
+// built. Slots hold the vertex hash next to its index, so most probes never
+// touch the vertex array.
+class VertexWelder {
+public:
+    // `expectedVertices` is an upper bound such as the index count; the table
+    // is sized so it never has to grow when the bound holds.
+    explicit VertexWelder(size_t expectedVertices);
+
+    // Returns the index of `vertex`, appending it if it has not been seen.
+    uint32_t weld(const Vertex& vertex) {
+        const uint64_t hash = hashVertex(vertex);
+        const uint32_t tag = static_cast<uint32_t>(hash >> 32);
+        size_t slot = static_cast<size_t>(hash) & m_mask;
+        for (;;) {
+            Slot& s = m_slots[slot];
+            if (s.index == kEmpty) {
+                const uint32_t index = static_cast<uint32_t>(m_vertices.size());
+                s = { tag, index };
+                m_vertices.push_back(vertex);
+                if (m_vertices.size() > m_growAt) {
+                    grow();
+                }
+                return index;
+            }
+            if (s.tag == tag && m_vertices[s.index] == vertex) {
+                return s.index;
+            }
+            slot = (slot + 1) & m_mask;
+        }
+    }
+
+    const std::vector<Vertex>& vertices() const { return m_vertices; }
+    std::vector<Vertex> takeVertices() { return std::move(m_vertices); }
+
+    // Hashes the raw 32 bytes; -0.0f is folded into 0.0f to agree with Vertex::operator==.
+    static uint64_t hashVertex(const Vertex& vertex) {
+        static_assert(sizeof(Vertex) == 32, "VertexWelder hashes a tightly packed 32-byte Vertex");
+        uint32_t bits[8];
+        std::memcpy(bits, &vertex, sizeof(bits));
+        uint64_t h = 0x9E3779B97F4A7C15ull;
+        for (int i = 0; i < 8; i += 2) {
+            const uint64_t lo = bits[i] == 0x80000000u ? 0u : bits[i];
+            const uint64_t hi = bits[i + 1] == 0x80000000u ? 0u : bits[i + 1];
+            h ^= lo | (hi << 32);
+            h *= 0xBF58476D1CE4E5B9ull;
+            h ^= h >> 31;
+        }
+        // splitmix64 finalizer
+        h ^= h >> 30;
+        h *= 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 27;
+        h *= 0x94D049BB133111EBull;
+        h ^= h >> 31;
+        return h;
+    }
+
+private:
+    static constexpr uint32_t kEmpty = 0xFFFFFFFFu;
+
+    struct Slot {
+        uint32_t tag;
+        uint32_t index;
+    };
+
+    void grow();
+
+    std::vector<Slot> m_slots;
+    std::vector<Vertex> m_vertices;
+    size_t m_mask = 0;
+    size_t m_growAt = 0;
+};
+
+} // namespace nyanchu
@@ -0,0 +1,91 @@
+#include "nyanchu/asset_manager.h"
+#include "nyanchu/profiler.h"
+#include "nyanchu/renderer.h"
+
+#include <chrono>
+#include <exception>
+#include <iostream>
+
+namespace nyanchu {
+
+AssetManager::AssetManager(IRenderer& renderer, JobSystem& jobs, uint32_t ioThreadCount)
+    : m_renderer(renderer)
+    , m_jobs(jobs)
+    // JobSystem counts the calling thread; submit() only runs on the workers.
+    , m_io(ioThreadCount + 1)
+{
+}
+
+AssetManager::~AssetManager() {
+    // Queued loads are skipped; running ones finish when m_io is destroyed.
+    m_shuttingDown.store(true, std::memory_order_release);
+    for (auto& entry : m_meshes) {
+        if (entry.second->isReady()) {
+            m_renderer.releaseMesh(*entry.second->m_mesh);
+        }
+    }
+}
+
+MeshHandle AssetManager::loadMesh(const std::string& path) {
+    auto it = m_meshes.find(path);
+    if (it != m_meshes.end()) {
+        return it->second;
+    }
+
+    auto asset = std::make_shared<MeshAsset>();
+    asset->m_path = path;
+    m_meshes.emplace(path, asset);
+    m_pending.fetch_add(1, std::memory_order_acq_rel);
+
+    m_io.submit([this, asset] {
+        if (m_shuttingDown.load(std::memory_order_acquire)) {
+            return;
+        }
+        NYANCHU_PROFILE_SCOPE("AssetManager::loadMesh");
+        try {
+            asset->m_mesh = std::make_unique<Mesh>(asset->m_path, &m_jobs);
+        } catch (const std::exception& e) {
+            asset->m_error = e.what();
+        }
+        std::lock_guard<std::mutex> lock(m_finishedMutex);
+        m_finished.push_back(asset);
+    });
+    return asset;
+}
+
+void AssetManager::update(double budgetMs) {
+    NYANCHU_PROFILE_SCOPE("AssetManager::update");
+    std::vector<std::shared_ptr<MeshAsset>> finished;
+    {
+        std::lock_guard<std::mutex> lock(m_finishedMutex);
+        if (m_finished.empty()) {
+            return;
+        }
+        finished.swap(m_finished);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t done = 0;
+    for (; done < finished.size(); ++done) {
+        if (done > 0 && std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMs) {
+            break;
+        }
+        MeshAsset& asset = *finished[done];
+        if (asset.m_mesh) {
+            m_renderer.uploadMesh(*asset.m_mesh);
+            asset.m_state.store(AssetState::Ready, std::memory_order_release);
+        } else {
+            std::cerr << "Failed to load mesh " << asset.m_path << ": " << asset.m_error << std::endl;
+            asset.m_state.store(AssetState::Failed, std::memory_order_release);
+        }
+        m_pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    // Whatever did not fit in the budget waits for the next frame, ahead of newer loads.
+    if (done < finished.size()) {
+        std::lock_guard<std::mutex> lock(m_finishedMutex);
+        m_finished.insert(m_finished.begin(), finished.begin() + done, finished.end());
+    }
+}
+
+} // namespace nyanchu
@@ -1,54 +1,774 @@
 #include "nyanchu/audio.h"
+#include "nyanchu/ecs.h"
+#include "nyanchu/spsc_ring.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
 #include <iostream>
 
+// A stream keeps two pages decoded ahead, whatever the track length.
+#ifndef MA_RESOURCE_MANAGER_PAGE_SIZE_IN_MILLISECONDS
+#define MA_RESOURCE_MANAGER_PAGE_SIZE_IN_MILLISECONDS 500
+#endif
 #define MINIAUDIO_IMPLEMENTATION
 #include "external/miniaudio.h"
 
 namespace nyanchu
 {
-    void Audio::init()
+    namespace
     {
+        // The bank is reserved once so clips never move under the audio thread.
+        constexpr uint32_t kMaxSounds = 1024;
+        constexpr uint32_t kNone = ~0u;
+
+        // Inverse distance from minDistance, faded to silence over the last
+        // quarter of maxDistance so culling a source never pops.
+        float attenuation(float distance, float minDistance, float maxDistance)
+        {
+            const float inverse = minDistance / std::max(distance, minDistance);
+            const float edge = std::clamp((maxDistance - distance) / (0.25f * maxDistance), 0.0f, 1.0f);
+            return inverse * edge;
+        }
+
+        // Room for several frames of commands from a full voice pool.
+        constexpr size_t kCommandCapacity = 4096;
+        // Keeps playReserve() within half the ring, so plays still get in
+        // while the callback has a backlog of commands to drain.
+        constexpr uint32_t kMaxVoices = (kCommandCapacity / 2 - 2) / 2;
+    } // namespace
+
+    // Counts everything miniaudio allocates, with a size header per block
+    // so frees can be subtracted.
+    struct Audio::HeapCounter {
+        static constexpr size_t kHeader = alignof(std::max_align_t);
+        std::atomic<uint64_t> allocations{ 0 };
+        std::atomic<int64_t> bytes{ 0 };
+
+        ma_allocation_callbacks callbacks() { return { this, allocate, reallocate, release }; }
+
+        static void* allocate(size_t size, void* userData)
+        {
+            return reallocate(nullptr, size, userData);
+        }
+
+        static void* reallocate(void* p, size_t size, void* userData)
+        {
+            auto& counter = *static_cast<HeapCounter*>(userData);
+            char* block = p ? static_cast<char*>(p) - kHeader : nullptr;
+            const size_t oldSize = block ? *reinterpret_cast<size_t*>(block) : 0;
+            block = static_cast<char*>(std::realloc(block, size + kHeader));
+            if (!block) return nullptr;
+            *reinterpret_cast<size_t*>(block) = size;
+            counter.allocations.fetch_add(1, std::memory_order_relaxed);
+            counter.bytes.fetch_add(static_cast<int64_t>(size) - static_cast<int64_t>(oldSize), std::memory_order_relaxed);
+            return block + kHeader;
+        }
+
+        static void release(void* p, void* userData)
+        {
+            if (!p) return;
+            char* block = static_cast<char*>(p) - kHeader;
+            static_cast<HeapCounter*>(userData)->bytes.fetch_sub(static_cast<int64_t>(*reinterpret_cast<size_t*>(block)), std::memory_order_relaxed);
+            std::free(block);
+        }
+    };
+
+    struct Audio::Clip {
+        float* frames = nullptr; // interleaved f32 at the file's own rate
+        uint64_t frameCount = 0;
+        uint32_t channels = 1;
+        uint32_t sampleRate = 0;
+    };
+
+    // A pooled voice of the mixer. The game thread keeps its own view of
+    // the voice and sends commands; the audio thread applies them and
+    // reports back through `finished`, so neither side waits on the other.
+    struct Audio::Voice {
+        std::atomic<uint32_t> finished{ 0 }; // generation whose clip ran out
+
+        // Audio thread only.
+        uint32_t current = 0; // generation in the mixer
+        bool mixing = false;
+
+        // Game thread only.
+        uint32_t generation = 0;
+        bool active = false;
+        bool positional = false;
+        uint8_t priority = 0;
+        glm::vec3 position{ 0.0f };
+        float volume = 1.0f;
+        float minDistance = 1.0f;
+        float maxDistance = 1.0f;
+        float reverbSend = 0.0f;
+        float gain = 0.0f; // at the listener, as of the last update
+        float sentGain = 0.0f;
+        float sentPan = 0.0f;
+        uint32_t emitter = kNone;
+        uint64_t order = 0;
+    };
+
+    struct Audio::Command {
+        enum class Type : uint8_t { Play, Stop, SetParams, AddEffect, SetEffectParam };
+        Type type = Type::Stop;
+        bool looping = false;
+        uint32_t voice = 0;
+        uint32_t generation = 0;
+        SoundId sound = kInvalidSound;
+        float volume = 1.0f;
+        float pan = 0.0f;
+        float pitch = 1.0f;
+        float send = 0.0f;
+        BusId bus = kMasterBus;
+        uint32_t effect = 0;
+        uint32_t param = 0;
+        float value = 0.0f;
+        AudioEffect* plugin = nullptr; // owned by the command until applied
+    };
+
+    // Game thread pushes, the device callback drains. Plays only go in
+    // while two slots per voice are free and parameter updates while one
+    // is, so the one stop each voice can owe always fits.
+    struct Audio::Commands {
+        SpscRing<Command, kCommandCapacity> ring;
+
+        size_t playReserve(uint32_t voiceCount) const { return 2 * size_t(voiceCount) + 2; }
+        size_t updateReserve(uint32_t voiceCount) const { return size_t(voiceCount) + 1; }
+
+        static void apply(Audio& audio, const Command& command)
+        {
+            AudioMixer& mixer = *audio.m_mixer;
+            switch (command.type) {
+            case Command::Type::Play: {
+                const Clip& clip = audio.m_clips[command.sound];
+                MixerClip view;
+                view.frames = clip.frames;
+                view.frameCount = clip.frameCount;
+                view.channels = clip.channels;
+                view.sampleRate = clip.sampleRate;
+                mixer.play(command.voice, view, command.looping, command.pitch, command.volume, command.pan, command.send);
+                Voice& voice = audio.m_voices[command.voice];
+                voice.current = command.generation;
+                voice.mixing = true;
+                break;
+            }
+            case Command::Type::Stop:
+                mixer.stop(command.voice);
+                audio.m_voices[command.voice].mixing = false;
+                break;
+            case Command::Type::SetParams:
+                mixer.setVoice(command.voice, command.volume, command.pan, command.send);
+                break;
+            case Command::Type::AddEffect:
+                mixer.addEffect(command.bus, std::unique_ptr<AudioEffect>(command.plugin));
+                break;
+            case Command::Type::SetEffectParam:
+                mixer.setEffectParam(command.bus, command.effect, command.param, command.value);
+                break;
+            }
+        }
+
+        // Music streams through ma_engine; the voices are mixed on top.
+        static void onDeviceData(ma_device* device, void* framesOut, const void*, ma_uint32 frameCount)
+        {
+            Audio& audio = *static_cast<Audio*>(device->pUserData);
+            audio.m_commands->ring.drain([&](const Command& command) { apply(audio, command); });
+            ma_engine_read_pcm_frames(audio.m_engine, framesOut, frameCount, NULL);
+            audio.m_mixer->render(static_cast<float*>(framesOut), frameCount, device->playback.channels);
+            for (uint32_t i = 0; i < audio.m_voiceCount; ++i) {
+                Voice& voice = audio.m_voices[i];
+                if (voice.mixing && !audio.m_mixer->isPlaying(i)) {
+                    voice.mixing = false;
+                    voice.finished.store(voice.current, std::memory_order_release);
+                }
+            }
+        }
+    };
+
+    // Emitters as parallel arrays, so the per-frame gain pass streams
+    // through a few floats per emitter.
+    struct Audio::EmitterSet {
+        std::vector<float> x, y, z;
+        std::vector<float> volume, minDistance, maxDistance, send;
+        std::vector<float> gain; // written by update()
+        std::vector<SoundId> sound; // kInvalidSound for free slots
+        std::vector<uint8_t> priority;
+        std::vector<uint32_t> voice; // kNone while virtual
+        std::vector<EmitterId> freeIds;
+        std::vector<uint32_t> candidates; // scratch for update()
+        uint32_t alive = 0;
+
+        bool isValid(EmitterId id) const { return id < sound.size() && sound[id] != kInvalidSound; }
+    };
+
+    Audio::Audio()
+        : m_heap(std::make_unique<HeapCounter>())
+        , m_emitters(std::make_unique<EmitterSet>())
+    {
+    }
+
+    Audio::~Audio() = default;
+
+    void Audio::init(bool headless, uint32_t voiceCount)
+    {
+        if (voiceCount > kMaxVoices) {
+            printf("Audio voice count %u exceeds the command ring, clamping to %u\n", voiceCount, kMaxVoices);
+            voiceCount = kMaxVoices;
+        }
+        const ma_allocation_callbacks callbacks = m_heap->callbacks();
+        m_context = new ma_context();
+        ma_context_config contextConfig = ma_context_config_init();
+        contextConfig.allocationCallbacks = callbacks;
+        const ma_backend nullBackend[] = { ma_backend_null };
+        if (ma_context_init(headless ? nullBackend : NULL, headless ? 1 : 0, &contextConfig, m_context) != MA_SUCCESS) {
+            printf("Failed to initialize the audio context.\n");
+            delete m_context;
+            m_context = nullptr;
+            return;
+        }
+
+        // Our own device, so its callback can drain commands before mixing.
+        m_commands = std::make_unique<Commands>();
+        ma_device_config deviceConfig = ma_device_config_init(ma_device_type_playback);
+        deviceConfig.playback.format = ma_format_f32;
+        deviceConfig.playback.channels = headless ? 2 : 0;
+        deviceConfig.sampleRate = headless ? 48000 : 0;
+        deviceConfig.dataCallback = Commands::onDeviceData;
+        deviceConfig.pUserData = this;
+        m_device = new ma_device();
+        if (ma_device_init(m_context, &deviceConfig, m_device) != MA_SUCCESS) {
+            printf("Failed to initialize the audio device.\n");
+            delete m_device;
+            m_device = nullptr;
+            ma_context_uninit(m_context);
+            delete m_context;
+            m_context = nullptr;
+            return;
+        }
+
+        // Voices are mixed by our own mixer, on this fixed graph: master
+        // (low-pass, open by default) <- reverb send bus.
+        m_mixer = std::make_unique<AudioMixer>(m_device->sampleRate, voiceCount);
+        m_mixer->addEffect(kMasterBus, std::make_unique<LowPassEffect>(m_device->sampleRate));
+        m_mixer->addBus(kMasterBus);
+        m_mixer->addEffect(kReverbBus, std::make_unique<ReverbEffect>(m_device->sampleRate));
+        for (uint32_t i = 0; i < voiceCount; ++i) {
+            m_mixer->setRouting(i, kMasterBus, kReverbBus);
+        }
+        m_effectCounts[kMasterBus] = 1;
+        m_effectCounts[kReverbBus] = 1;
+        m_voices = std::make_unique<Voice[]>(voiceCount);
+        m_voiceCount = voiceCount;
+
+        ma_engine_config config = ma_engine_config_init();
+        config.allocationCallbacks = callbacks;
+        config.pContext = m_context;
+        config.pDevice = m_device;
         m_engine = new ma_engine();
         ma_result result;
-        result = ma_engine_init(NULL, m_engine);
+        result = ma_engine_init(&config, m_engine);
         if (result != MA_SUCCESS) {
             printf("Failed to initialize audio engine.");
+            delete m_engine;
+            m_engine = nullptr;
+            m_mixer.reset();
+            m_voices.reset();
+            m_voiceCount = 0;
+            ma_device_uninit(m_device);
+            delete m_device;
+            m_device = nullptr;
+            ma_context_uninit(m_context);
+            delete m_context;
+            m_context = nullptr;
             return;
         }
         m_bgm = nullptr;
+        m_clips.reserve(kMaxSounds);
     }
 
     void Audio::shutdown()
     {
-        if (m_bgm) {
-            ma_sound_uninit(m_bgm);
-            delete m_bgm;
-            m_bgm = nullptr;
+        if (!m_engine) return;
+        // Stops the callback, so nothing below races the audio thread.
+        ma_device_stop(m_device);
+        if (m_bgm) m_fadingBgm.push_back(m_bgm);
+        m_bgm = nullptr;
+        for (ma_sound* bgm : m_fadingBgm) {
+            ma_sound_uninit(bgm);
+            delete bgm;
         }
+        m_fadingBgm.clear();
         ma_engine_uninit(m_engine);
         delete m_engine;
         m_engine = nullptr;
+        ma_device_uninit(m_device);
+        delete m_device;
+        m_device = nullptr;
+
+        // Whatever the callback never saw, so queued effects get freed.
+        m_commands->ring.drain([&](const Command& command) { Commands::apply(*this, command); });
+        m_commands.reset();
+        m_mixer.reset();
+        m_voices.reset();
+        m_voiceCount = 0;
+        *m_emitters = EmitterSet{};
+        ma_context_uninit(m_context);
+        delete m_context;
+        m_context = nullptr;
+
+        const ma_allocation_callbacks callbacks = m_heap->callbacks();
+        for (Clip& clip : m_clips) {
+            ma_free(clip.frames, &callbacks);
+        }
+        m_clips.clear();
+        m_clipIds.clear();
     }
 
-    void Audio::play_bgm(const char* soundName)
+    void Audio::play_bgm(const char* soundName, float crossfadeSeconds)
     {
-        if (m_bgm) {
-            // Stop and uninitialize existing BGM if any
-            ma_sound_uninit(m_bgm);
-            delete m_bgm;
-            m_bgm = nullptr;
-        }
+        if (!m_engine) return;
+        // The old track keeps playing while it fades; update() releases it
+        // once it has stopped, so there is no gap between the two.
+        stop_bgm(crossfadeSeconds);
 
-        m_bgm = new ma_sound();
-        ma_result result = ma_sound_init_from_file(m_engine, soundName, 0, NULL, NULL, m_bgm);
+        // Streamed and opened on miniaudio's resource manager thread, so this
+        // returns without touching the disk; playback starts once data arrives.
+        ma_sound* bgm = new ma_sound();
+        ma_result result = ma_sound_init_from_file(m_engine, soundName, MA_SOUND_FLAG_STREAM | MA_SOUND_FLAG_ASYNC, NULL, NULL, bgm);
         if (result != MA_SUCCESS) {
             printf("Failed to init sound from file: %s\n", soundName);
-            delete m_bgm;
-            m_bgm = nullptr;
+            delete bgm;
             return;
         }
 
-        ma_sound_set_looping(m_bgm, MA_TRUE);
-        ma_sound_start(m_bgm);
+        ma_sound_set_looping(bgm, MA_TRUE);
+        const ma_uint64 fadeMilliseconds = static_cast<ma_uint64>(std::max(crossfadeSeconds, 0.0f) * 1000.0f);
+        if (fadeMilliseconds > 0) {
+            ma_sound_set_fade_in_milliseconds(bgm, 0.0f, 1.0f, fadeMilliseconds);
+        }
+        ma_sound_start(bgm);
+        m_bgm = bgm;
+    }
+
+    void Audio::stop_bgm(float fadeSeconds)
+    {
+        if (!m_bgm) return;
+        const ma_uint64 fadeMilliseconds = static_cast<ma_uint64>(std::max(fadeSeconds, 0.0f) * 1000.0f);
+        if (fadeMilliseconds > 0) {
+            ma_sound_stop_with_fade_in_milliseconds(m_bgm, fadeMilliseconds);
+        } else {
+            ma_sound_stop(m_bgm);
+        }
+        m_fadingBgm.push_back(m_bgm);
+        m_bgm = nullptr;
+    }
+
+    SoundId Audio::load_sound(const char* path)
+    {
+        if (!m_engine) return kInvalidSound;
+        const auto it = m_clipIds.find(path);
+        if (it != m_clipIds.end()) {
+            return it->second;
+        }
+        if (m_clips.size() == kMaxSounds) {
+            printf("Sound bank is full (%u clips), cannot load %s\n", kMaxSounds, path);
+            return kInvalidSound;
+        }
+
+        // Kept at the file's own rate, since the mixer resamples anyway,
+        // and mono stays mono; only surround is folded down to stereo.
+        ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 0, 0);
+        config.allocationCallbacks = m_heap->callbacks();
+        ma_decoder probe;
+        if (ma_decoder_init_file(path, &config, &probe) != MA_SUCCESS) {
+            printf("Failed to decode sound: %s\n", path);
+            return kInvalidSound;
+        }
+        config.channels = std::min<ma_uint32>(probe.outputChannels, 2);
+        config.sampleRate = probe.outputSampleRate;
+        ma_decoder_uninit(&probe);
+
+        ma_uint64 frameCount = 0;
+        void* frames = nullptr;
+        if (ma_decode_file(path, &config, &frameCount, &frames) != MA_SUCCESS) {
+            printf("Failed to decode sound: %s\n", path);
+            return kInvalidSound;
+        }
+        Clip clip;
+        clip.frames = static_cast<float*>(frames);
+        clip.frameCount = frameCount;
+        clip.channels = config.channels;
+        clip.sampleRate = config.sampleRate;
+
+        const SoundId id = static_cast<SoundId>(m_clips.size());
+        m_clips.push_back(clip);
+        m_clipIds.emplace(path, id);
+        return id;
+    }
+
+    bool Audio::isFree(const Voice& voice) const
+    {
+        return !voice.active || voice.finished.load(std::memory_order_acquire) == voice.generation;
+    }
+
+    Audio::Voice* Audio::claimVoice(uint8_t priority, float gain)
+    {
+        Voice* victim = nullptr;
+        for (uint32_t i = 0; i < m_voiceCount; ++i) {
+            Voice& voice = m_voices[i];
+            if (isFree(voice)) {
+                return &voice;
+            }
+            if (!victim || voice.priority < victim->priority ||
+                (voice.priority == victim->priority &&
+                 (voice.gain < victim->gain || (voice.gain == victim->gain && voice.order < victim->order)))) {
+                victim = &voice;
+            }
+        }
+
+        // Only steal from something that ranks no higher than the new sound.
+        if (!victim || victim->priority > priority || (victim->priority == priority && victim->gain > gain)) {
+            return nullptr;
+        }
+        ++m_stolen;
+        releaseVoice(*victim);
+        return victim;
+    }
+
+    void Audio::startVoice(Voice& voice, SoundId sound, bool looping, float pitch, float pan)
+    {
+        voice.generation++;
+        voice.order = ++m_triggered;
+        voice.active = true;
+        voice.sentGain = voice.gain;
+        voice.sentPan = pan;
+
+        Command command;
+        command.type = Command::Type::Play;
+        command.looping = looping;
+        command.voice = static_cast<uint32_t>(&voice - m_voices.get());
+        command.generation = voice.generation;
+        command.sound = sound;
+        command.volume = voice.gain;
+        command.pan = pan;
+        command.pitch = pitch;
+        command.send = voice.reverbSend;
+        m_commands->ring.push(command);
+    }
+
+    void Audio::releaseVoice(Voice& voice)
+    {
+        if (voice.emitter != kNone) {
+            m_emitters->voice[voice.emitter] = kNone;
+            voice.emitter = kNone;
+        }
+        if (voice.active) {
+            // Always fits, see Commands.
+            Command command;
+            command.type = Command::Type::Stop;
+            command.voice = static_cast<uint32_t>(&voice - m_voices.get());
+            m_commands->ring.push(command);
+            voice.active = false;
+        }
+        voice.generation++;
+    }
+
+    float Audio::gainAt(const glm::vec3& position, float volume, float minDistance, float maxDistance) const
+    {
+        return volume * attenuation(glm::length(position - m_listenerPosition), minDistance, maxDistance);
+    }
+
+    float Audio::spatialize(Voice& voice)
+    {
+        const glm::vec3 offset = voice.position - m_listenerPosition;
+        const float distance = glm::length(offset);
+        voice.gain = voice.volume * attenuation(distance, voice.minDistance, voice.maxDistance);
+        return distance > 1e-4f ? glm::dot(offset, m_listenerRight) / distance : 0.0f;
+    }
+
+    VoiceHandle Audio::play_sound(SoundId sound, const SoundParams& params)
+    {
+        if (!m_engine || sound >= m_clips.size()) return {};
+
+        const float gain = params.positional
+            ? gainAt(params.position, params.volume, params.minDistance, params.maxDistance)
+            : params.volume;
+        if (params.positional && gain <= 0.0f) {
+            ++m_culled;
+            return {};
+        }
+        if (m_commands->ring.freeSlots() < m_commands->playReserve(m_voiceCount)) {
+            ++m_dropped;
+            return {};
+        }
+        Voice* voice = claimVoice(params.priority, gain);
+        if (!voice) {
+            ++m_dropped;
+            return {};
+        }
+
+        voice->priority = params.priority;
+        voice->positional = params.positional;
+        voice->position = params.position;
+        voice->volume = params.volume;
+        voice->minDistance = params.minDistance;
+        voice->maxDistance = params.maxDistance;
+        voice->reverbSend = params.reverbSend;
+        voice->gain = gain;
+        const float pan = params.positional ? spatialize(*voice) : 0.0f;
+        startVoice(*voice, sound, false, params.pitch, pan);
+        return { static_cast<uint32_t>(voice - m_voices.get()), voice->generation };
+    }
+
+    void Audio::stop_sound(VoiceHandle handle)
+    {
+        if (!handle || handle.voice >= m_voiceCount) return;
+        Voice& voice = m_voices[handle.voice];
+        if (voice.generation != handle.generation || !voice.active) return;
+        releaseVoice(voice);
+    }
+
+    bool Audio::is_playing(VoiceHandle handle) const
+    {
+        if (!handle || handle.voice >= m_voiceCount) return false;
+        const Voice& voice = m_voices[handle.voice];
+        return voice.generation == handle.generation && !isFree(voice);
+    }
+
+    uint32_t Audio::add_effect(BusId bus, std::unique_ptr<AudioEffect> effect)
+    {
+        if (!m_engine || bus >= kBusCount || !effect || m_effectCounts[bus] == AudioMixer::kMaxEffectsPerBus) return ~0u;
+        if (m_commands->ring.freeSlots() < m_commands->updateReserve(m_voiceCount)) return ~0u;
+        Command command;
+        command.type = Command::Type::AddEffect;
+        command.bus = bus;
+        command.plugin = effect.release();
+        m_commands->ring.push(command);
+        return m_effectCounts[bus]++;
+    }
+
+    bool Audio::set_effect_param(BusId bus, uint32_t effect, uint32_t param, float value)
+    {
+        if (!m_engine || bus >= kBusCount || effect >= m_effectCounts[bus]) return false;
+        if (m_commands->ring.freeSlots() < m_commands->updateReserve(m_voiceCount)) return false;
+        Command command;
+        command.type = Command::Type::SetEffectParam;
+        command.bus = bus;
+        command.effect = effect;
+        command.param = param;
+        command.value = value;
+        m_commands->ring.push(command);
+        return true;
+    }
+
+    uint32_t Audio::get_sample_rate() const
+    {
+        return m_device ? m_device->sampleRate : 0;
+    }
+
+    void Audio::set_listener(const glm::vec3& position, const glm::vec3& forward, const glm::vec3& up)
+    {
+        m_listenerPosition = position;
+        const glm::vec3 right = glm::cross(forward, up);
+        const float length = glm::length(right);
+        if (length > 1e-6f) {
+            m_listenerRight = right / length;
+        }
+    }
+
+    EmitterId Audio::create_emitter(SoundId sound, const EmitterParams& params)
+    {
+        if (sound >= m_clips.size()) return kInvalidEmitter;
+        EmitterSet& e = *m_emitters;
+        EmitterId id;
+        if (!e.freeIds.empty()) {
+            id = e.freeIds.back();
+            e.freeIds.pop_back();
+        } else {
+            id = static_cast<EmitterId>(e.sound.size());
+            for (auto* column : { &e.x, &e.y, &e.z, &e.volume, &e.minDistance, &e.maxDistance, &e.send, &e.gain }) {
+                column->push_back(0.0f);
+            }
+            e.sound.push_back(kInvalidSound);
+            e.priority.push_back(0);
+            e.voice.push_back(kNone);
+            e.candidates.reserve(e.sound.size());
+        }
+        e.x[id] = e.y[id] = e.z[id] = 0.0f;
+        e.volume[id] = params.volume;
+        e.minDistance[id] = std::max(params.minDistance, 1e-3f);
+        e.maxDistance[id] = std::max(params.maxDistance, e.minDistance[id]);
+        e.send[id] = params.reverbSend;
+        e.gain[id] = 0.0f;
+        e.sound[id] = sound;
+        e.priority[id] = params.priority;
+        e.voice[id] = kNone;
+        ++e.alive;
+        return id;
+    }
+
+    void Audio::destroy_emitter(EmitterId emitter)
+    {
+        EmitterSet& e = *m_emitters;
+        if (!e.isValid(emitter)) return;
+        if (e.voice[emitter] != kNone) {
+            releaseVoice(m_voices[e.voice[emitter]]);
+        }
+        // Silent and out of range until reused.
+        e.volume[emitter] = 0.0f;
+        e.sound[emitter] = kInvalidSound;
+        e.freeIds.push_back(emitter);
+        --e.alive;
+    }
+
+    void Audio::set_emitter_position(EmitterId emitter, const glm::vec3& position)
+    {
+        EmitterSet& e = *m_emitters;
+        if (!e.isValid(emitter)) return;
+        e.x[emitter] = position.x;
+        e.y[emitter] = position.y;
+        e.z[emitter] = position.z;
+    }
+
+    void Audio::attach(ECS& ecs)
+    {
+        flecs::world& world = ecs.getWorld();
+        world.component<AudioEmitter>("nyanchu::AudioEmitter")
+            .on_remove([this](AudioEmitter& emitter) { destroy_emitter(emitter.id); });
+
+        // Declared after the transform systems, so world matrices are current.
+        ecs.system<const AudioEmitter, const WorldMatrix>("nyanchu::SyncAudioEmitters", flecs::PostUpdate, SystemExecution::Parallel)
+            .each([this](const AudioEmitter& emitter, const WorldMatrix& world) {
+                set_emitter_position(emitter.id, glm::vec3(world.value[3]));
+            });
+    }
+
+    void Audio::update()
+    {
+        // Finished voices only output silence; stopping them takes them out
+        // of the mix.
+        for (uint32_t i = 0; i < m_voiceCount; ++i) {
+            Voice& voice = m_voices[i];
+            if (voice.active && isFree(voice)) {
+                releaseVoice(voice);
+            }
+        }
+
+        // Gain of every emitter at the listener, in one pass over the
+        // arrays. Free slots have zero volume.
+        EmitterSet& e = *m_emitters;
+        const size_t emitterCount = e.sound.size();
+        const glm::vec3 listener = m_listenerPosition;
+        for (size_t i = 0; i < emitterCount; ++i) {
+            const float dx = e.x[i] - listener.x;
+            const float dy = e.y[i] - listener.y;
+            const float dz = e.z[i] - listener.z;
+            const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+            e.gain[i] = e.volume[i] * attenuation(distance, e.minDistance[i], e.maxDistance[i]);
+        }
+
+        // Emitters that went out of range give their voice back; the rest
+        // of the voices rank by their new gain.
+        for (uint32_t i = 0; i < m_voiceCount; ++i) {
+            Voice& voice = m_voices[i];
+            if (voice.emitter == kNone) continue;
+            if (e.gain[voice.emitter] <= 0.0f) {
+                releaseVoice(voice);
+            } else {
+                voice.position = glm::vec3(e.x[voice.emitter], e.y[voice.emitter], e.z[voice.emitter]);
+            }
+        }
+
+        // Audible emitters without a voice compete for one, loudest first.
+        // Only as many as there are voices can win, so the rest are never
+        // sorted.
+        e.candidates.clear();
+        m_audibleEmitters = 0;
+        for (uint32_t i = 0; i < emitterCount; ++i) {
+            if (e.gain[i] <= 0.0f) continue;
+            ++m_audibleEmitters;
+            if (e.voice[i] == kNone) e.candidates.push_back(i);
+        }
+        auto louder = [&](uint32_t a, uint32_t b) {
+            return e.priority[a] != e.priority[b] ? e.priority[a] > e.priority[b] : e.gain[a] > e.gain[b];
+        };
+        const size_t contenders = std::min<size_t>(e.candidates.size(), m_voiceCount);
+        std::partial_sort(e.candidates.begin(), e.candidates.begin() + contenders, e.candidates.end(), louder);
+        for (size_t c = 0; c < contenders; ++c) {
+            if (m_commands->ring.freeSlots() < m_commands->playReserve(m_voiceCount)) break; // next frame
+            const uint32_t emitter = e.candidates[c];
+            Voice* voice = claimVoice(e.priority[emitter], e.gain[emitter]);
+            if (!voice) break; // later candidates rank lower still
+            voice->emitter = emitter;
+            voice->priority = e.priority[emitter];
+            voice->positional = true;
+            voice->position = glm::vec3(e.x[emitter], e.y[emitter], e.z[emitter]);
+            voice->volume = e.volume[emitter];
+            voice->minDistance = e.minDistance[emitter];
+            voice->maxDistance = e.maxDistance[emitter];
+            voice->reverbSend = e.send[emitter];
+            voice->gain = e.gain[emitter];
+            e.voice[emitter] = static_cast<uint32_t>(voice - m_voices.get());
+            startVoice(*voice, e.sound[emitter], true, 1.0f, spatialize(*voice));
+        }
+
+        // Volume and pan for every positional voice, emitters and one-shots
+        // alike, once per frame. Only changes are sent.
+        for (uint32_t i = 0; i < m_voiceCount; ++i) {
+            Voice& voice = m_voices[i];
+            if (!voice.active || !voice.positional) continue;
+            const float pan = spatialize(voice);
+            if (std::abs(voice.gain - voice.sentGain) < 1e-4f && std::abs(pan - voice.sentPan) < 1e-4f) continue;
+            if (m_commands->ring.freeSlots() < m_commands->updateReserve(m_voiceCount)) {
+                ++m_deferredUpdates;
+                continue;
+            }
+            Command command;
+            command.type = Command::Type::SetParams;
+            command.voice = i;
+            command.volume = voice.gain;
+            command.pan = pan;
+            command.send = voice.reverbSend;
+            m_commands->ring.push(command);
+            voice.sentGain = voice.gain;
+            voice.sentPan = pan;
+        }
+
+        // Uninitializing a stream waits for miniaudio's job thread to let
+        // go of it, which is quick once the track has stopped.
+        for (size_t i = 0; i < m_fadingBgm.size();) {
+            if (ma_sound_is_playing(m_fadingBgm[i])) {
+                ++i;
+                continue;
+            }
+            ma_sound_uninit(m_fadingBgm[i]);
+            delete m_fadingBgm[i];
+            m_fadingBgm[i] = m_fadingBgm.back();
+            m_fadingBgm.pop_back();
+        }
+    }
+
+    AudioStats Audio::get_stats() const
+    {
+        AudioStats stats;
+        stats.voices = m_voiceCount;
+        for (uint32_t i = 0; i < m_voiceCount; ++i) {
+            stats.playing += isFree(m_voices[i]) ? 0 : 1;
+        }
+        stats.triggered = m_triggered;
+        stats.stolen = m_stolen;
+        stats.dropped = m_dropped;
+        stats.allocations = m_heap->allocations.load(std::memory_order_relaxed);
+        stats.heapBytes = static_cast<uint64_t>(std::max<int64_t>(m_heap->bytes.load(std::memory_order_relaxed), 0));
+        stats.bgmStreams = (m_bgm ? 1 : 0) + static_cast<uint32_t>(m_fadingBgm.size());
+        stats.emitters = m_emitters->alive;
+        stats.audibleEmitters = m_audibleEmitters;
+        for (uint32_t i = 0; i < m_voiceCount; ++i) {
+            stats.emitterVoices += m_voices[i].emitter != kNone ? 1 : 0;
+        }
+        stats.culled = m_culled;
+        stats.queuedCommands = m_commands ? static_cast<uint32_t>(m_commands->ring.size()) : 0;
+        stats.deferredUpdates = m_deferredUpdates;
+        return stats;
     }
-} // namespace nyanchu
\ No newline at end of file
+} // namespace nyanchu
@@ -0,0 +1,445 @@
+#include "nyanchu/audio_mixer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define NYANCHU_MIX_AVX 1
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define NYANCHU_MIX_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define NYANCHU_MIX_NEON 1
+#endif
+
+namespace nyanchu {
+
+namespace {
+
+// 32.32 fixed point: one clip frame.
+constexpr uint64_t kUnitStep = uint64_t(1) << 32;
+constexpr float kFractionScale = 1.0f / 4294967296.0f;
+
+// As wide as the target allows, for the mixing kernels.
+#if NYANCHU_MIX_AVX
+using Lanes = __m256;
+constexpr uint32_t kLanes = 8;
+inline Lanes load(const float* p) { return _mm256_loadu_ps(p); }
+inline void store(float* p, Lanes a) { _mm256_storeu_ps(p, a); }
+inline Lanes splat(float x) { return _mm256_set1_ps(x); }
+inline Lanes add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+inline Lanes mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+inline Lanes ramp(float start, float step) {
+    return _mm256_add_ps(_mm256_set1_ps(start), _mm256_mul_ps(_mm256_set1_ps(step), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7)));
+}
+#elif NYANCHU_MIX_SSE
+using Lanes = __m128;
+constexpr uint32_t kLanes = 4;
+inline Lanes load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, Lanes a) { _mm_storeu_ps(p, a); }
+inline Lanes splat(float x) { return _mm_set1_ps(x); }
+inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+inline Lanes ramp(float start, float step) {
+    return _mm_add_ps(_mm_set1_ps(start), _mm_mul_ps(_mm_set1_ps(step), _mm_setr_ps(0, 1, 2, 3)));
+}
+#elif NYANCHU_MIX_NEON
+using Lanes = float32x4_t;
+constexpr uint32_t kLanes = 4;
+inline Lanes load(const float* p) { return vld1q_f32(p); }
+inline void store(float* p, Lanes a) { vst1q_f32(p, a); }
+inline Lanes splat(float x) { return vdupq_n_f32(x); }
+inline Lanes add(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+inline Lanes mul(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+inline Lanes ramp(float start, float step) {
+    static const float offsets[4] = { 0, 1, 2, 3 };
+    return vmlaq_n_f32(vdupq_n_f32(start), vld1q_f32(offsets), step);
+}
+#else
+using Lanes = float;
+constexpr uint32_t kLanes = 1;
+inline Lanes load(const float* p) { return *p; }
+inline void store(float* p, Lanes a) { *p = a; }
+inline Lanes splat(float x) { return x; }
+inline Lanes add(Lanes a, Lanes b) { return a + b; }
+inline Lanes mul(Lanes a, Lanes b) { return a * b; }
+inline Lanes ramp(float start, float) { return start; }
+#endif
+
+// dst += src * gain, with the gain moving by `step` per frame.
+void mixRamp(float* dst, const float* src, uint32_t frames, float gain, float step) {
+    uint32_t i = 0;
+    if (step == 0.0f) {
+        const Lanes g = splat(gain);
+        for (; i + kLanes <= frames; i += kLanes) {
+            store(dst + i, add(load(dst + i), mul(load(src + i), g)));
+        }
+    } else {
+        Lanes g = ramp(gain, step);
+        const Lanes advance = splat(step * kLanes);
+        for (; i + kLanes <= frames; i += kLanes) {
+            store(dst + i, add(load(dst + i), mul(load(src + i), g)));
+            g = add(g, advance);
+        }
+    }
+    for (; i < frames; ++i) {
+        dst[i] += src[i] * (gain + step * float(i));
+    }
+}
+
+// Balance law, like miniaudio's default: centered is unity on both sides,
+// panning only turns the far side down.
+void panGains(float volume, float pan, float& left, float& right) {
+    pan = std::clamp(pan, -1.0f, 1.0f);
+    left = volume * std::min(1.0f, 1.0f - pan);
+    right = volume * std::min(1.0f, 1.0f + pan);
+}
+
+// Recursive filters decay into denormals, which are very slow on x86.
+struct DenormalGuard {
+#if NYANCHU_MIX_AVX || NYANCHU_MIX_SSE
+    unsigned int saved = _mm_getcsr();
+    DenormalGuard() { _mm_setcsr(saved | 0x8040); } // flush to zero, denormals are zero
+    ~DenormalGuard() { _mm_setcsr(saved); }
+#endif
+};
+
+} // namespace
+
+LowPassEffect::LowPassEffect(uint32_t sampleRate, float cutoffHz) : m_sampleRate(float(sampleRate)) {
+    setParam(Cutoff, cutoffHz);
+}
+
+void LowPassEffect::setParam(uint32_t param, float value) {
+    if (param != Cutoff) return;
+    const bool bypass = value >= 0.45f * m_sampleRate;
+    if (bypass != m_bypass) {
+        std::fill(&m_state[0][0], &m_state[0][0] + 4, 0.0f);
+        m_bypass = bypass;
+    }
+    if (bypass) return;
+
+    // Audio EQ Cookbook low-pass with Q = 1/sqrt(2).
+    const float w0 = 6.2831853f * std::max(value, 10.0f) / m_sampleRate;
+    const float cosine = std::cos(w0);
+    const float alpha = std::sin(w0) * 0.70710678f;
+    const float a0 = 1.0f + alpha;
+    m_b0 = m_b2 = 0.5f * (1.0f - cosine) / a0;
+    m_b1 = (1.0f - cosine) / a0;
+    m_a1 = -2.0f * cosine / a0;
+    m_a2 = (1.0f - alpha) / a0;
+}
+
+void LowPassEffect::process(float* left, float* right, uint32_t frames) {
+    if (m_bypass) return;
+    float* channels[2] = { left, right };
+    for (int c = 0; c < 2; ++c) {
+        float* samples = channels[c];
+        float s1 = m_state[c][0], s2 = m_state[c][1];
+        for (uint32_t i = 0; i < frames; ++i) {
+            const float x = samples[i];
+            const float y = m_b0 * x + s1;
+            s1 = m_b1 * x - m_a1 * y + s2;
+            s2 = m_b2 * x - m_a2 * y;
+            samples[i] = y;
+        }
+        m_state[c][0] = s1;
+        m_state[c][1] = s2;
+    }
+}
+
+ReverbEffect::ReverbEffect(uint32_t sampleRate) {
+    // Freeverb's tunings at 44.1 kHz.
+    static const uint32_t kCombLengths[kCombs] = { 1116, 1188, 1277, 1356 };
+    static const uint32_t kAllpassLengths[kAllpasses] = { 556, 441 };
+    constexpr uint32_t kStereoSpread = 23;
+    const float scale = float(sampleRate) / 44100.0f;
+    for (uint32_t c = 0; c < 2; ++c) {
+        const uint32_t spread = c * kStereoSpread;
+        for (uint32_t i = 0; i < kCombs; ++i) {
+            m_combs[c][i].buffer.assign(std::max<uint32_t>(1, uint32_t((kCombLengths[i] + spread) * scale)), 0.0f);
+        }
+        for (uint32_t i = 0; i < kAllpasses; ++i) {
+            m_allpasses[c][i].buffer.assign(std::max<uint32_t>(1, uint32_t((kAllpassLengths[i] + spread) * scale)), 0.0f);
+        }
+    }
+}
+
+void ReverbEffect::setParam(uint32_t param, float value) {
+    value = std::clamp(value, 0.0f, 1.0f);
+    switch (param) {
+    case RoomSize: m_feedback = 0.7f + 0.28f * value; break;
+    case Damping: m_damping = 0.4f * value; break;
+    case Wet: m_wet = value; break;
+    default: break;
+    }
+}
+
+void ReverbEffect::process(float* left, float* right, uint32_t frames) {
+    constexpr float kInputGain = 0.03f;
+    constexpr float kAllpassFeedback = 0.5f;
+    for (uint32_t i = 0; i < frames; ++i) {
+        const float input = (left[i] + right[i]) * kInputGain;
+        float* outputs[2] = { &left[i], &right[i] };
+        for (uint32_t c = 0; c < 2; ++c) {
+            float sum = 0.0f;
+            for (Comb& comb : m_combs[c]) {
+                const float delayed = comb.buffer[comb.index];
+                comb.filtered = delayed * (1.0f - m_damping) + comb.filtered * m_damping;
+                comb.buffer[comb.index] = input + comb.filtered * m_feedback;
+                if (++comb.index == comb.buffer.size()) comb.index = 0;
+                sum += delayed;
+            }
+            for (Allpass& allpass : m_allpasses[c]) {
+                const float delayed = allpass.buffer[allpass.index];
+                allpass.buffer[allpass.index] = sum + delayed * kAllpassFeedback;
+                if (++allpass.index == allpass.buffer.size()) allpass.index = 0;
+                sum = delayed - sum;
+            }
+            *outputs[c] = sum * m_wet;
+        }
+    }
+}
+
+struct AudioMixer::Voice {
+    MixerClip clip;
+    uint64_t position = 0; // in clip frames, 32.32 fixed point
+    uint64_t step = kUnitStep;
+    bool looping = false;
+    bool playing = false;
+    BusId bus = kMasterBus;
+    BusId sendBus = kMasterBus;
+    // Gains now, and where the next block ramps them to.
+    float left = 0.0f, right = 0.0f, send = 0.0f;
+    float targetLeft = 0.0f, targetRight = 0.0f, targetSend = 0.0f;
+};
+
+struct AudioMixer::Bus {
+    std::unique_ptr<float[]> left;
+    std::unique_ptr<float[]> right;
+    std::vector<std::unique_ptr<AudioEffect>> effects;
+    BusId output = kMasterBus;
+    float gain = 1.0f;
+};
+
+AudioMixer::AudioMixer(uint32_t sampleRate, uint32_t voiceCount)
+    : m_sampleRate(sampleRate)
+    , m_voiceCount(voiceCount)
+    , m_voices(std::make_unique<Voice[]>(voiceCount))
+    , m_scratch(std::make_unique<float[]>(2 * kBlockFrames)) {
+    addBus(kMasterBus);
+}
+
+AudioMixer::~AudioMixer() = default;
+
+BusId AudioMixer::addBus(BusId output, float gain) {
+    Bus bus;
+    bus.left = std::make_unique<float[]>(kBlockFrames);
+    bus.right = std::make_unique<float[]>(kBlockFrames);
+    bus.effects.reserve(kMaxEffectsPerBus);
+    // The master comes first and is never mixed into its output; every
+    // other bus must feed an existing one, or it could feed itself.
+    bus.output = m_buses.empty() ? kMasterBus : std::min<BusId>(output, static_cast<BusId>(m_buses.size() - 1));
+    bus.gain = gain;
+    m_buses.push_back(std::move(bus));
+    return static_cast<BusId>(m_buses.size() - 1);
+}
+
+uint32_t AudioMixer::addEffect(BusId bus, std::unique_ptr<AudioEffect> effect) {
+    if (bus >= m_buses.size() || !effect) return ~0u;
+    auto& effects = m_buses[bus].effects;
+    if (effects.size() == kMaxEffectsPerBus) return ~0u;
+    effects.push_back(std::move(effect));
+    return static_cast<uint32_t>(effects.size() - 1);
+}
+
+void AudioMixer::setEffectParam(BusId bus, uint32_t effect, uint32_t param, float value) {
+    if (bus >= m_buses.size() || effect >= m_buses[bus].effects.size()) return;
+    m_buses[bus].effects[effect]->setParam(param, value);
+}
+
+void AudioMixer::play(uint32_t voice, const MixerClip& clip, bool looping, float pitch, float volume, float pan,
+                      float send) {
+    if (voice >= m_voiceCount) return;
+    Voice& v = m_voices[voice];
+    v.clip = clip;
+    v.position = 0;
+    const double rate = double(std::max(pitch, 0.0f)) * clip.sampleRate / m_sampleRate;
+    v.step = std::max<uint64_t>(1, static_cast<uint64_t>(rate * double(kUnitStep)));
+    v.looping = looping;
+    v.playing = clip.frames && clip.frameCount > 0 && (clip.channels == 1 || clip.channels == 2);
+    panGains(volume, pan, v.targetLeft, v.targetRight);
+    v.targetSend = send;
+    v.left = v.targetLeft;
+    v.right = v.targetRight;
+    v.send = send;
+}
+
+void AudioMixer::stop(uint32_t voice) {
+    if (voice < m_voiceCount) m_voices[voice].playing = false;
+}
+
+void AudioMixer::setVoice(uint32_t voice, float volume, float pan, float send) {
+    if (voice >= m_voiceCount) return;
+    Voice& v = m_voices[voice];
+    panGains(volume, pan, v.targetLeft, v.targetRight);
+    v.targetSend = send;
+}
+
+void AudioMixer::setRouting(uint32_t voice, BusId bus, BusId sendBus) {
+    if (voice >= m_voiceCount) return;
+    const BusId last = static_cast<BusId>(m_buses.size() - 1);
+    m_voices[voice].bus = std::min(bus, last);
+    m_voices[voice].sendBus = std::min(sendBus, last);
+}
+
+bool AudioMixer::isPlaying(uint32_t voice) const {
+    return voice < m_voiceCount && m_voices[voice].playing;
+}
+
+// Fills the scratch channels with up to `frames` frames at the output rate,
+// linearly interpolated unless the clip plays at its own rate. Returns how
+// many it wrote; fewer means the clip ended.
+uint32_t AudioMixer::resample(Voice& voice, uint32_t frames) {
+    float* left = m_scratch.get();
+    float* right = left + kBlockFrames;
+    const MixerClip& clip = voice.clip;
+    const float* samples = clip.frames;
+    const bool stereo = clip.channels == 2;
+    const uint64_t end = clip.frameCount << 32;
+    const uint64_t lastSafe = (clip.frameCount - 1) << 32; // interpolation can read one frame ahead
+
+    uint32_t produced = 0;
+    while (produced < frames) {
+        if (voice.position >= end) {
+            if (!voice.looping) {
+                voice.playing = false;
+                break;
+            }
+            voice.position %= end;
+        }
+
+        const uint32_t wanted = frames - produced;
+        if (voice.step == kUnitStep && (voice.position & 0xffffffffu) == 0) {
+            // Own rate: a straight copy.
+            const uint64_t index = voice.position >> 32;
+            const uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(wanted, clip.frameCount - index));
+            if (stereo) {
+                for (uint32_t i = 0; i < count; ++i) {
+                    left[produced + i] = samples[2 * (index + i)];
+                    right[produced + i] = samples[2 * (index + i) + 1];
+                }
+            } else {
+                std::copy_n(samples + index, count, left + produced);
+            }
+            produced += count;
+            voice.position += uint64_t(count) << 32;
+            continue;
+        }
+
+        uint32_t count = 0;
+        if (voice.position < lastSafe) {
+            count = static_cast<uint32_t>(std::min<uint64_t>(wanted, (lastSafe - voice.position + voice.step - 1) / voice.step));
+        }
+        uint64_t position = voice.position;
+        if (stereo) {
+            for (uint32_t i = 0; i < count; ++i, position += voice.step) {
+                const float* frame = samples + 2 * (position >> 32);
+                const float t = float(uint32_t(position)) * kFractionScale;
+                left[produced + i] = frame[0] + (frame[2] - frame[0]) * t;
+                right[produced + i] = frame[1] + (frame[3] - frame[1]) * t;
+            }
+        } else {
+            for (uint32_t i = 0; i < count; ++i, position += voice.step) {
+                const float* frame = samples + (position >> 32);
+                const float t = float(uint32_t(position)) * kFractionScale;
+                left[produced + i] = frame[0] + (frame[1] - frame[0]) * t;
+            }
+        }
+        produced += count;
+        voice.position = position;
+
+        if (count == 0) {
+            // The last frame blends into the loop start, or into silence.
+            const uint64_t index = voice.position >> 32;
+            const float t = float(uint32_t(voice.position)) * kFractionScale;
+            for (uint32_t c = 0; c < clip.channels; ++c) {
+                const float a = samples[index * clip.channels + c];
+                const float b = voice.looping ? samples[c] : 0.0f;
+                (c == 0 ? left : right)[produced] = a + (b - a) * t;
+            }
+            ++produced;
+            voice.position += voice.step;
+        }
+    }
+    return produced;
+}
+
+void AudioMixer::renderBlock(float* out, uint32_t frames, uint32_t channels) {
+    for (Bus& bus : m_buses) {
+        std::fill_n(bus.left.get(), frames, 0.0f);
+        std::fill_n(bus.right.get(), frames, 0.0f);
+    }
+
+    const float perFrame = 1.0f / float(frames);
+    for (uint32_t i = 0; i < m_voiceCount; ++i) {
+        Voice& voice = m_voices[i];
+        if (!voice.playing) continue;
+        const uint32_t produced = resample(voice, frames);
+        const float* left = m_scratch.get();
+        const float* right = voice.clip.channels == 2 ? left + kBlockFrames : left;
+
+        Bus& bus = m_buses[voice.bus];
+        mixRamp(bus.left.get(), left, produced, voice.left, (voice.targetLeft - voice.left) * perFrame);
+        mixRamp(bus.right.get(), right, produced, voice.right, (voice.targetRight - voice.right) * perFrame);
+        if (voice.send > 0.0f || voice.targetSend > 0.0f) {
+            Bus& send = m_buses[voice.sendBus];
+            const float fromLeft = voice.left * voice.send, toLeft = voice.targetLeft * voice.targetSend;
+            const float fromRight = voice.right * voice.send, toRight = voice.targetRight * voice.targetSend;
+            mixRamp(send.left.get(), left, produced, fromLeft, (toLeft - fromLeft) * perFrame);
+            mixRamp(send.right.get(), right, produced, fromRight, (toRight - fromRight) * perFrame);
+        }
+        voice.left = voice.targetLeft;
+        voice.right = voice.targetRight;
+        voice.send = voice.targetSend;
+        ++m_voiceBlocksMixed;
+    }
+
+    // Children have higher ids than their outputs, so walking down
+    // finishes every bus before it is read.
+    for (size_t b = m_buses.size(); b-- > 1;) {
+        Bus& bus = m_buses[b];
+        for (auto& effect : bus.effects) effect->process(bus.left.get(), bus.right.get(), frames);
+        Bus& output = m_buses[bus.output];
+        mixRamp(output.left.get(), bus.left.get(), frames, bus.gain, 0.0f);
+        mixRamp(output.right.get(), bus.right.get(), frames, bus.gain, 0.0f);
+    }
+
+    Bus& master = m_buses[kMasterBus];
+    for (auto& effect : master.effects) effect->process(master.left.get(), master.right.get(), frames);
+    const float* left = master.left.get();
+    const float* right = master.right.get();
+    const float gain = master.gain;
+    if (channels == 1) {
+        for (uint32_t i = 0; i < frames; ++i) out[i] += 0.5f * gain * (left[i] + right[i]);
+    } else {
+        for (uint32_t i = 0; i < frames; ++i) {
+            out[i * channels] += gain * left[i];
+            out[i * channels + 1] += gain * right[i];
+        }
+    }
+}
+
+void AudioMixer::render(float* out, uint32_t frames, uint32_t channels) {
+    if (channels == 0) return;
+    [[maybe_unused]] DenormalGuard guard;
+    for (uint32_t done = 0; done < frames;) {
+        const uint32_t count = std::min(kBlockFrames, frames - done);
+        renderBlock(out + size_t(done) * channels, count, channels);
+        done += count;
+    }
+}
+
+} // namespace nyanchu
@@ -54,10 +54,28 @@ void Camera::ZoomCamera(float delta) {
     m_position += m_front * delta;
 }
 
+void Camera::SetPerspective(float fovDegrees, float nearPlane, float farPlane) {
+    m_fov = fovDegrees;
+    m_near = nearPlane;
+    m_far = farPlane;
+}
+
+void Camera::SetAspectRatio(float aspect) {
+    if (aspect > 0.0f) {
+        m_aspect = aspect;
+    }
+}
+
 glm::mat4 Camera::getViewMatrix() const {
     return glm::lookAt(m_position, m_position + m_front, m_up);
 }
 
+glm::mat4 Camera::getProjectionMatrix(bool homogeneousDepth) const {
+    return homogeneousDepth
+        ? glm::perspectiveRH_NO(glm::radians(m_fov), m_aspect, m_near, m_far)
+        : glm::perspectiveRH_ZO(glm::radians(m_fov), m_aspect, m_near, m_far);
+}
+
 void Camera::updateVectors() {
     // Calculate the new Front vector
     glm::vec3 front;
@@ -0,0 +1,248 @@
+#include "nyanchu/dynamic_tree.h"
+
+#include <algorithm>
+
+namespace nyanchu {
+
+namespace {
+
+// How far ahead of the current motion fat boxes reach.
+constexpr float kDisplacementMultiplier = 2.0f;
+
+} // namespace
+
+DynamicTree::DynamicTree(float margin)
+    : m_margin(margin)
+{
+}
+
+int32_t DynamicTree::allocateNode() {
+    if (m_freeList == kNullNode) {
+        const int32_t first = static_cast<int32_t>(m_nodes.size());
+        m_nodes.resize(std::max<size_t>(16, m_nodes.size() * 2));
+        for (int32_t i = first; i < static_cast<int32_t>(m_nodes.size()); ++i) {
+            m_nodes[i].parent = i + 1 < static_cast<int32_t>(m_nodes.size()) ? i + 1 : kNullNode;
+            m_nodes[i].height = -1;
+        }
+        m_freeList = first;
+    }
+    const int32_t node = m_freeList;
+    m_freeList = m_nodes[node].parent;
+    m_nodes[node] = Node{};
+    m_nodes[node].height = 0;
+    return node;
+}
+
+void DynamicTree::freeNode(int32_t node) {
+    m_nodes[node].parent = m_freeList;
+    m_nodes[node].height = -1;
+    m_freeList = node;
+}
+
+int32_t DynamicTree::insert(const AABB& bounds, uint32_t userData) {
+    const int32_t proxy = allocateNode();
+    m_nodes[proxy].bounds = { bounds.min - glm::vec3(m_margin), bounds.max + glm::vec3(m_margin) };
+    m_nodes[proxy].userData = userData;
+    insertLeaf(proxy);
+    ++m_proxyCount;
+    return proxy;
+}
+
+void DynamicTree::remove(int32_t proxy) {
+    removeLeaf(proxy);
+    freeNode(proxy);
+    --m_proxyCount;
+}
+
+bool DynamicTree::update(int32_t proxy, const AABB& bounds, const glm::vec3& displacement) {
+    Node& node = m_nodes[proxy];
+    const glm::vec3 ahead = displacement * kDisplacementMultiplier;
+    // A fat box much larger than needed (left over from fast motion) costs
+    // queries, so it is refreshed too. The predicted motion counts as
+    // needed, on both sides: a box fattened last step still trails a fast
+    // body by about one displacement.
+    const glm::vec3 slack = glm::vec3(4.0f * m_margin) + glm::abs(ahead);
+    const AABB loose = { bounds.min - slack, bounds.max + slack };
+    if (node.bounds.contains(bounds) && loose.contains(node.bounds)) {
+        return false;
+    }
+
+    AABB fat = { bounds.min - glm::vec3(m_margin), bounds.max + glm::vec3(m_margin) };
+    fat.min += glm::min(ahead, glm::vec3(0.0f));
+    fat.max += glm::max(ahead, glm::vec3(0.0f));
+
+    removeLeaf(proxy);
+    node.bounds = fat;
+    insertLeaf(proxy);
+    return true;
+}
+
+void DynamicTree::insertLeaf(int32_t leaf) {
+    if (m_root == kNullNode) {
+        m_root = leaf;
+        m_nodes[leaf].parent = kNullNode;
+        return;
+    }
+
+    // Walk down towards the sibling that grows the total surface area least.
+    const AABB leafBounds = m_nodes[leaf].bounds;
+    int32_t index = m_root;
+    while (!m_nodes[index].isLeaf()) {
+        const Node& node = m_nodes[index];
+        const float area = node.bounds.surfaceArea();
+        const float combinedArea = AABB::merge(node.bounds, leafBounds).surfaceArea();
+
+        // Cost of pairing the leaf with this node, and of pushing it further
+        // down (every ancestor grows by the same amount either way).
+        const float cost = 2.0f * combinedArea;
+        const float inheritance = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](int32_t child) {
+            const Node& c = m_nodes[child];
+            const float merged = AABB::merge(c.bounds, leafBounds).surfaceArea();
+            return (c.isLeaf() ? merged : merged - c.bounds.surfaceArea()) + inheritance;
+        };
+        const float cost1 = descendCost(node.child1);
+        const float cost2 = descendCost(node.child2);
+
+        if (cost < cost1 && cost < cost2) {
+            break;
+        }
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    const int32_t sibling = index;
+    const int32_t oldParent = m_nodes[sibling].parent;
+    const int32_t newParent = allocateNode();
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].bounds = AABB::merge(leafBounds, m_nodes[sibling].bounds);
+    m_nodes[newParent].height = m_nodes[sibling].height + 1;
+    m_nodes[newParent].child1 = sibling;
+    m_nodes[newParent].child2 = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if (oldParent == kNullNode) {
+        m_root = newParent;
+    } else if (m_nodes[oldParent].child1 == sibling) {
+        m_nodes[oldParent].child1 = newParent;
+    } else {
+        m_nodes[oldParent].child2 = newParent;
+    }
+
+    refit(m_nodes[leaf].parent);
+}
+
+void DynamicTree::removeLeaf(int32_t leaf) {
+    if (leaf == m_root) {
+        m_root = kNullNode;
+        return;
+    }
+
+    const int32_t parent = m_nodes[leaf].parent;
+    const int32_t grandParent = m_nodes[parent].parent;
+    const int32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    // The sibling takes the parent's place.
+    m_nodes[sibling].parent = grandParent;
+    freeNode(parent);
+    if (grandParent == kNullNode) {
+        m_root = sibling;
+        return;
+    }
+    if (m_nodes[grandParent].child1 == parent) {
+        m_nodes[grandParent].child1 = sibling;
+    } else {
+        m_nodes[grandParent].child2 = sibling;
+    }
+    refit(grandParent);
+}
+
+// Recomputes bounds and heights from `node` up to the root, rotating each
+// node on the way where that shrinks the tree's surface area.
+void DynamicTree::refit(int32_t node) {
+    while (node != kNullNode) {
+        Node& n = m_nodes[node];
+        const Node& child1 = m_nodes[n.child1];
+        const Node& child2 = m_nodes[n.child2];
+        n.height = 1 + std::max(child1.height, child2.height);
+        n.bounds = AABB::merge(child1.bounds, child2.bounds);
+        rotate(node);
+        node = n.parent;
+    }
+}
+
+// Tries swapping a child of `a` with a grandchild under its other child (or
+// two grandchildren), the tree rotations of Kopta et al., "Fast, Effective
+// BVH Updates for Animated Scenes". Keeps the swap that saves the most
+// surface area, if any. a's own bounds do not change.
+void DynamicTree::rotate(int32_t a) {
+    Node& A = m_nodes[a];
+    if (A.height < 2) {
+        return;
+    }
+    const int32_t b = A.child1;
+    const int32_t c = A.child2;
+    const Node& B = m_nodes[b];
+    const Node& C = m_nodes[c];
+
+    enum class Swap { None, BF, BG, CD, CE, DF, DG };
+    Swap best = Swap::None;
+    float bestSaving = 0.0f;
+    auto consider = [&](Swap swap, float saving) {
+        if (saving > bestSaving) {
+            bestSaving = saving;
+            best = swap;
+        }
+    };
+
+    const float areaB = B.bounds.surfaceArea();
+    const float areaC = C.bounds.surfaceArea();
+    if (!C.isLeaf()) {
+        const AABB& F = m_nodes[C.child1].bounds;
+        const AABB& G = m_nodes[C.child2].bounds;
+        consider(Swap::BF, areaC - AABB::merge(B.bounds, G).surfaceArea());
+        consider(Swap::BG, areaC - AABB::merge(B.bounds, F).surfaceArea());
+    }
+    if (!B.isLeaf()) {
+        const AABB& D = m_nodes[B.child1].bounds;
+        const AABB& E = m_nodes[B.child2].bounds;
+        consider(Swap::CD, areaB - AABB::merge(C.bounds, E).surfaceArea());
+        consider(Swap::CE, areaB - AABB::merge(C.bounds, D).surfaceArea());
+        if (!C.isLeaf()) {
+            const AABB& F = m_nodes[C.child1].bounds;
+            const AABB& G = m_nodes[C.child2].bounds;
+            consider(Swap::DF, areaB + areaC - AABB::merge(F, E).surfaceArea() - AABB::merge(D, G).surfaceArea());
+            consider(Swap::DG, areaB + areaC - AABB::merge(D, F).surfaceArea() - AABB::merge(G, E).surfaceArea());
+        }
+    }
+
+    // Exchanges the subtree `x` (child of `xParent`) with `y` (child of
+    // `yParent`) and refreshes both parents.
+    auto exchange = [&](int32_t xParent, int32_t x, int32_t yParent, int32_t y) {
+        Node& P = m_nodes[xParent];
+        Node& Q = m_nodes[yParent];
+        (P.child1 == x ? P.child1 : P.child2) = y;
+        (Q.child1 == y ? Q.child1 : Q.child2) = x;
+        m_nodes[x].parent = yParent;
+        m_nodes[y].parent = xParent;
+        for (int32_t parent : { yParent, xParent }) {
+            Node& n = m_nodes[parent];
+            n.bounds = AABB::merge(m_nodes[n.child1].bounds, m_nodes[n.child2].bounds);
+            n.height = 1 + std::max(m_nodes[n.child1].height, m_nodes[n.child2].height);
+        }
+    };
+
+    switch (best) {
+    case Swap::None: return;
+    case Swap::BF: exchange(a, b, c, C.child1); break;
+    case Swap::BG: exchange(a, b, c, C.child2); break;
+    case Swap::CD: exchange(a, c, b, B.child1); break;
+    case Swap::CE: exchange(a, c, b, B.child2); break;
+    case Swap::DF: exchange(b, B.child1, c, C.child1); break;
+    case Swap::DG: exchange(b, B.child1, c, C.child2); break;
+    }
+    A.height = 1 + std::max(m_nodes[A.child1].height, m_nodes[A.child2].height);
+}
+
+} // namespace nyanchu
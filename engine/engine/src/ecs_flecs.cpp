@@ -1,9 +1,30 @@
 #include <nyanchu/ecs.h>
+#include <nyanchu/camera.h>
+#include <nyanchu/profiler.h>
+#include <nyanchu/renderer.h>
+#include <algorithm>
 #include <iostream> // For debugging
+#include <thread>
 
 namespace nyanchu {
 
-ECS::ECS() : m_world() {
+namespace {
+
+// Large enough that one submit amortizes its overhead, small enough that a
+// scene of one mesh still spreads over every thread.
+constexpr size_t kInstancesPerDraw = 1024;
+
+} // namespace
+
+ECS::ECS(IRenderer* renderer, const Camera* camera, JobSystem* jobs)
+    : m_world()
+    , m_renderer(renderer)
+    , m_camera(camera)
+    , m_jobs(jobs)
+{
+    registerComponents();
+    registerSystems();
+    m_pickQuery = m_world.query<const WorldMatrix, const MeshRef, const Bounds>();
     std::cout << "ECS initialized" << std::endl;
 }
 
@@ -15,4 +36,161 @@ flecs::world& ECS::getWorld() {
     return m_world;
 }
 
-} // namespace nyanchu
\ No newline at end of file
+void ECS::setThreadCount(uint32_t count) {
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (count == m_threadCount) {
+        return;
+    }
+    m_threadCount = count;
+    m_world.set_threads(static_cast<int32_t>(count));
+}
+
+void ECS::progress(float deltaTime) {
+    NYANCHU_PROFILE_SCOPE("ECS::progress");
+    m_world.progress(deltaTime);
+}
+
+flecs::entity ECS::spawn(const Transform& transform, MeshHandle mesh, flecs::entity parent) {
+    flecs::entity entity = m_world.entity().set<Transform>(transform);
+    if (mesh) {
+        entity.set<MeshRef>({ std::move(mesh) });
+    }
+    if (parent) {
+        entity.child_of(parent);
+    }
+    return entity;
+}
+
+bool ECS::raycast(const Ray& ray, float maxDistance, PickHit& hit) {
+    NYANCHU_PROFILE_SCOPE("ECS::raycast");
+    const glm::vec3 inverseDirection = 1.0f / ray.direction;
+    bool found = false;
+    m_pickQuery.each([&](flecs::entity entity, const WorldMatrix& world, const MeshRef& ref, const Bounds& bounds) {
+        const Mesh* mesh = ref.mesh ? ref.mesh->get() : nullptr;
+        float entry;
+        if (mesh == nullptr || !intersectRay(ray.origin, inverseDirection, bounds.world, maxDistance, entry)) {
+            return;
+        }
+        // An affine transform keeps the ray parameter, so distances found in
+        // object space are still world distances along the unit ray.
+        const glm::mat4 toLocal = glm::inverse(world.value);
+        const Ray local{ glm::vec3(toLocal * glm::vec4(ray.origin, 1.0f)), glm::vec3(toLocal * glm::vec4(ray.direction, 0.0f)) };
+        MeshHit meshHit;
+        if (!mesh->raycast(local, maxDistance, meshHit)) {
+            return;
+        }
+        maxDistance = meshHit.distance;
+        const glm::vec3 normal = glm::normalize(glm::transpose(glm::mat3(toLocal)) * meshHit.normal);
+        hit.entity = entity;
+        hit.distance = meshHit.distance;
+        hit.point = ray.origin + ray.direction * meshHit.distance;
+        hit.normal = glm::dot(normal, ray.direction) > 0.0f ? -normal : normal;
+        hit.triangle = meshHit.triangle;
+        found = true;
+    });
+    return found;
+}
+
+void ECS::registerComponents() {
+    // Whoever adds a Transform or MeshRef gets the derived data for free.
+    m_world.component<WorldMatrix>("nyanchu::WorldMatrix");
+    m_world.component<Bounds>("nyanchu::Bounds");
+    m_world.component<Transform>("nyanchu::Transform")
+        .add(flecs::With, m_world.component<WorldMatrix>());
+    m_world.component<MeshRef>("nyanchu::MeshRef")
+        .add(flecs::With, m_world.component<Bounds>());
+}
+
+void ECS::registerSystems() {
+    // Systems in the same phase run in the order they are declared.
+
+    // Roots have no parent to wait for, so they can be split across workers.
+    system<const Transform, WorldMatrix>("nyanchu::TransformRoots", flecs::PostUpdate, SystemExecution::Parallel)
+        .term(flecs::ChildOf, flecs::Wildcard).not_()
+        .each([](const Transform& transform, WorldMatrix& world) {
+            world.value = transform.toMatrix();
+        });
+
+    // cascade() visits entities in breadth-first order of the hierarchy, so
+    // every parent's WorldMatrix is final before its children read it. That
+    // order only holds on a single thread.
+    system<const Transform, const WorldMatrix, WorldMatrix>("nyanchu::TransformChildren", flecs::PostUpdate)
+        .term_at(2).parent().cascade()
+        .each([](const Transform& transform, const WorldMatrix& parent, WorldMatrix& world) {
+            world.value = parent.value * transform.toMatrix();
+        });
+
+    system<const WorldMatrix, const MeshRef, Bounds>("nyanchu::UpdateBounds", flecs::PostUpdate, SystemExecution::Parallel)
+        .each([](const WorldMatrix& world, const MeshRef& ref, Bounds& bounds) {
+            if (const Mesh* mesh = ref.mesh ? ref.mesh->get() : nullptr) {
+                bounds.world = mesh->getBounds().transformed(world.value);
+            }
+        });
+
+    system<>("nyanchu::BeginExtract", flecs::OnStore)
+        .iter([this](flecs::iter&) {
+            for (auto& [meshId, batch] : m_batches) {
+                batch.matrices.clear();
+            }
+            if (m_camera != nullptr) {
+                // The culling volume is the same for either depth convention,
+                // so this does not need to match the renderer's.
+                m_frustum = Frustum(m_camera->getProjectionMatrix(true) * m_camera->getViewMatrix(), true);
+            }
+        });
+
+    system<const WorldMatrix, const MeshRef, const Bounds>("nyanchu::ExtractMeshes", flecs::OnStore)
+        .each([this](const WorldMatrix& world, const MeshRef& ref, const Bounds& bounds) {
+            if (m_renderer == nullptr || m_camera == nullptr) {
+                return;
+            }
+            const Mesh* mesh = ref.mesh ? ref.mesh->get() : nullptr;
+            if (mesh != nullptr && m_frustum.intersects(bounds.world)) {
+                MeshBatch& batch = m_batches[mesh->getId()];
+                batch.mesh = mesh;
+                batch.matrices.push_back(world.value);
+            }
+        });
+
+    system<>("nyanchu::SubmitMeshes", flecs::OnStore)
+        .iter([this](flecs::iter&) {
+            NYANCHU_PROFILE_SCOPE("ECS::submitMeshes");
+            m_draws.clear();
+            for (auto it = m_batches.begin(); it != m_batches.end();) {
+                const std::span<const glm::mat4> matrices = it->second.matrices;
+                if (matrices.empty()) {
+                    // No visible instances this frame; dropping the entry keeps
+                    // released meshes from lingering in the map.
+                    it = m_batches.erase(it);
+                    continue;
+                }
+                for (size_t first = 0; first < matrices.size(); first += kInstancesPerDraw) {
+                    const size_t count = std::min(kInstancesPerDraw, matrices.size() - first);
+                    m_draws.push_back({ it->second.mesh, matrices.subspan(first, count) });
+                }
+                ++it;
+            }
+
+            if (m_renderer == nullptr || m_draws.empty()) {
+                return;
+            }
+            if (m_jobs == nullptr) {
+                for (const InstancedDraw& draw : m_draws) {
+                    m_renderer->drawMeshInstanced(*draw.mesh, draw.matrices);
+                }
+                return;
+            }
+            // MeshRef only yields meshes whose assets are ready, which the
+            // AssetManager has already uploaded, as parallel recording needs.
+            const auto record = [this](RenderEncoder& encoder, uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i) {
+                    encoder.drawMeshInstanced(*m_draws[i].mesh, m_draws[i].matrices);
+                }
+            };
+            m_renderer->recordParallel(*m_jobs, static_cast<uint32_t>(m_draws.size()), record);
+        });
+}
+
+} // namespace nyanchu
@@ -1,12 +1,16 @@
 #include "nyanchu/engine.h"
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
+#include <thread>
 #include "platform/platform_utils.h"
+#include "nyanchu/profiler.h"
 
+#include "nyanchu/renderer_opengl.h"
+#include "nyanchu/threaded_renderer.h"
 #ifdef __APPLE__
 #include "nyanchu/renderer_metal.h"
-#else
-#include "nyanchu/renderer_opengl.h"
 #endif
 
 #define CREDIT(text) "\033[34m" text "\033[0m"
@@ -34,17 +38,49 @@ static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     }
 }
 
+// Input callbacks forward into Engine's Input; they only fire inside glfwPollEvents.
+static void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action, int mods)
+{
+    auto engine = static_cast<Engine*>(glfwGetWindowUserPointer(window));
+    if (engine && !engine->isReplaying()) {
+        engine->getInput().onKey(key, action, mods);
+    }
+}
+
+static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
+{
+    auto engine = static_cast<Engine*>(glfwGetWindowUserPointer(window));
+    if (engine && !engine->isReplaying()) {
+        engine->getInput().onMouseButton(button, action, mods);
+    }
+}
+
+static void cursor_pos_callback(GLFWwindow* window, double x, double y)
+{
+    auto engine = static_cast<Engine*>(glfwGetWindowUserPointer(window));
+    if (engine && !engine->isReplaying()) {
+        engine->getInput().onCursorPos(x, y);
+    }
+}
+
 Engine::Engine() : m_window(nullptr) {}
 
 Engine::~Engine() {
+    if (m_recorder) m_recorder->close();
+    // Entities hold mesh handles, so the scene goes before the assets.
+    // RigidBody removal calls into physics, so physics outlives the scene;
+    // the same goes for AudioEmitter and audio.
+    m_ecs.reset();
+    m_physics.reset();
+    m_assets.reset();
     if (m_audio) m_audio->shutdown();
     if (m_renderer) m_renderer->shutdown();
     if (m_window) glfwDestroyWindow(m_window);
-    glfwTerminate();
+    if (m_glfwInitialized) glfwTerminate();
     std::cout << SUCCESS("Engine shutdown") << std::endl;
 }
 
-void Engine::init() {
+void Engine::init(const EngineConfig& config) {
     std::cout << CREDIT( R"(
     _  _               _   _          ___           _
     | \| |_  _ __ _ _ _| |_| |_ _  _  | __|_ _  __ _(_)_ _  ___
@@ -64,74 +100,191 @@ void Engine::init() {
      *
     )") << std::endl;
 
-    if (!glfwInit()) {
-        std::cerr << ERROR("Failed to initialize GLFW") << std::endl;
-        return;
-    }
+    Profiler::setThreadName("Main");
+    m_headless = config.headless;
 
-    // For now, let's create a window here. This might be configurable later.
-    m_window = glfwCreateWindow(800, 600, "Nyanthu Engine", NULL, NULL);
-    if (!m_window) {
-        std::cerr << ERROR("Failed to create GLFW window") << std::endl;
-        glfwTerminate();
-        return;
-    }
-    glfwMakeContextCurrent(m_window);
+    if (!m_headless) {
+        if (!glfwInit()) {
+            std::cerr << ERROR("Failed to initialize GLFW") << std::endl;
+            return;
+        }
+        m_glfwInitialized = true;
 
-    // Set up resize callback
-    glfwSetWindowUserPointer(m_window, this);
-    glfwSetFramebufferSizeCallback(m_window, framebuffer_size_callback);
+        // bgfx and Metal present on their own; GLFW must not create a GL context.
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        m_window = glfwCreateWindow(static_cast<int>(config.width), static_cast<int>(config.height), "Nyanthu Engine", NULL, NULL);
+        if (!m_window) {
+            std::cerr << ERROR("Failed to create GLFW window") << std::endl;
+            glfwTerminate();
+            m_glfwInitialized = false;
+            return;
+        }
 
+        // Set up resize callback
+        glfwSetWindowUserPointer(m_window, this);
+        glfwSetFramebufferSizeCallback(m_window, framebuffer_size_callback);
+    }
+
+    // Headless always goes through bgfx, whose Noop backend needs no window.
+    // bgfx runs on its own render thread one frame behind the game thread;
+    // Metal sets up its layer through AppKit and stays on the main thread.
 #ifdef __APPLE__
-    m_renderer = std::make_unique<RendererMetal>();
+    if (!m_headless) {
+        m_renderer = std::make_unique<RendererMetal>();
+    } else {
+        m_renderer = std::make_unique<ThreadedRenderer>(std::make_unique<RendererBGFX>());
+    }
 #else
-    m_renderer = std::make_unique<RendererBGFX>();
+    m_renderer = std::make_unique<ThreadedRenderer>(std::make_unique<RendererBGFX>());
 #endif
-    if (!m_renderer->initialize(m_window, 800, 600)) {
+    if (!m_renderer->initialize(m_window, config.width, config.height)) {
         std::cerr << ERROR("Failed to initialize Renderer") << std::endl;
         return;
     }
 
     m_audio = std::make_unique<Audio>();
-    m_audio->init();
+    m_audio->init(m_headless);
 
     m_camera = std::make_unique<Camera>();
+    m_camera->SetAspectRatio(static_cast<float>(config.width) / static_cast<float>(config.height));
     m_input = std::make_unique<Input>(m_window);
+    if (m_window) {
+        glfwSetKeyCallback(m_window, key_callback);
+        glfwSetMouseButtonCallback(m_window, mouse_button_callback);
+        glfwSetCursorPosCallback(m_window, cursor_pos_callback);
+    }
+    m_jobs = std::make_unique<JobSystem>();
+    m_assets = std::make_unique<AssetManager>(*m_renderer, *m_jobs);
+    m_ecs = std::make_unique<ECS>(m_renderer.get(), m_camera.get(), m_jobs.get());
+    m_ecs->setThreadCount(config.ecsThreads);
+    m_physics = std::make_unique<Physics>(m_jobs.get());
+    m_physics->attach(*m_ecs, m_timestep);
+    m_audio->attach(*m_ecs);
 
 
     m_resourceDir = getExecutableDir();
+    m_lastFrameTime = std::chrono::steady_clock::now();
+    m_timestep = FixedTimestep(config.simulationHz, config.maxSubsteps);
 
     m_isRunning = true;
     std::cout << SUCCESS("Engine initialized") << std::endl;
 }
 
 bool Engine::isRunning() {
-    return m_isRunning && !glfwWindowShouldClose(m_window);
+    return m_isRunning && (!m_window || !glfwWindowShouldClose(m_window));
 }
 
 void Engine::pollEvents() {
-    glfwPollEvents();
-    m_input->update();
+    NYANCHU_PROFILE_SCOPE("Engine::pollEvents");
+    const auto now = std::chrono::steady_clock::now();
+    const float wallDeltaTime = std::chrono::duration<float>(now - m_lastFrameTime).count();
+    m_lastFrameTime = now;
+
+    // Still pumped while replaying so the window stays responsive; the input
+    // callbacks ignore live events then.
+    if (m_window) {
+        glfwPollEvents();
+    }
+
+    if (m_replay) {
+        // Same workload every run: assets requested at startup are in place
+        // before the first replayed frame.
+        if (m_replay->getFrameIndex() == 0) {
+            while (m_assets->getPendingCount() > 0) {
+                m_assets->update(1e9);
+                std::this_thread::yield();
+            }
+            m_lastFrameTime = std::chrono::steady_clock::now();
+        } else {
+            m_replayFrameMs.push_back(wallDeltaTime * 1000.0f);
+        }
+        if (!m_replay->nextFrame(*m_input, m_deltaTime)) {
+            reportReplay();
+            m_replay.reset();
+            m_deltaTime = 0.0f;
+            m_isRunning = false;
+        }
+    } else {
+        m_input->update();
+        m_deltaTime = wallDeltaTime;
+        if (m_recorder) {
+            m_recorder->recordFrame(m_deltaTime, *m_input);
+        }
+    }
+
+    // Replays feed the recorded delta times through here as well, so they
+    // reproduce the same step sequence.
+    m_simulationSteps = m_timestep.advance(m_deltaTime);
+}
+
+bool Engine::startRecording(const std::string& path) {
+    auto recorder = std::make_unique<InputRecorder>();
+    if (!recorder->open(path, m_input->GetMousePosition())) {
+        return false;
+    }
+    m_recorder = std::move(recorder);
+    std::cout << SUCCESS("Recording input to ") << path << std::endl;
+    return true;
+}
+
+bool Engine::startReplay(const std::string& path) {
+    auto replay = std::make_unique<InputReplay>();
+    if (!replay->open(path)) {
+        return false;
+    }
+    replay->prime(*m_input);
+    m_replay = std::move(replay);
+    m_replayFrameMs.clear();
+    std::cout << SUCCESS("Replaying input from ") << path << std::endl;
+    return true;
+}
+
+void Engine::reportReplay() const {
+    if (m_replayFrameMs.empty()) {
+        return;
+    }
+    std::vector<float> sorted = m_replayFrameMs;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&](float p) { return sorted[static_cast<size_t>(p * (sorted.size() - 1))]; };
+    double total = 0.0;
+    for (float ms : sorted) total += ms;
+
+    std::printf("Replay: %zu frames, avg %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+                sorted.size(), total / sorted.size(), percentile(0.5f), percentile(0.95f), percentile(0.99f), sorted.back());
 }
 
 void Engine::beginFrame() {
+    NYANCHU_PROFILE_SCOPE("Engine::beginFrame");
+    m_assets->update();
     m_renderer->beginFrame(*m_camera);
+    for (uint32_t i = 0; i < m_simulationSteps; ++i) {
+        m_physics->step(m_timestep.getStepSeconds());
+    }
+    m_ecs->progress(m_deltaTime);
+    // Emitters have their world positions now.
+    m_audio->set_listener(m_camera->getPosition(), m_camera->getFront(), m_camera->getUp());
+    m_audio->update();
 }
 
 void Engine::endFrame() {
+    NYANCHU_PROFILE_SCOPE("Engine::endFrame");
     m_renderer->endFrame();
-    glfwSwapBuffers(m_window);
 }
 
 void Engine::resize(int width, int height) {
     m_renderer->resize(width, height);
+    if (m_camera && height > 0) {
+        m_camera->SetAspectRatio(static_cast<float>(width) / static_cast<float>(height));
+    }
 }
 
 void Engine::cursor_disable(){
+    if (!m_window) return;
     glfwSetInputMode(m_window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 }
 
 void Engine::cursor_able(){
+    if (!m_window) return;
     glfwSetInputMode(m_window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 }
 
@@ -147,12 +300,40 @@ Input& Engine::getInput() {
     return *m_input;
 }
 
-void Engine::playBgm(const std::string& soundName) {
-    std::string fullPath = getResourceDir() + "/" + soundName;
-    m_audio->play_bgm(fullPath.c_str());
+JobSystem& Engine::getJobSystem() {
+    return *m_jobs;
+}
+
+AssetManager& Engine::getAssets() {
+    return *m_assets;
+}
+
+ECS& Engine::getECS() {
+    return *m_ecs;
+}
+
+Physics& Engine::getPhysics() {
+    return *m_physics;
+}
+
+Audio& Engine::getAudio() {
+    return *m_audio;
+}
+
+SoundId Engine::loadSound(std::string_view soundName) {
+    return m_audio->load_sound(resourcePath(soundName));
+}
+
+void Engine::playBgm(std::string_view soundName, float crossfadeSeconds) {
+    m_audio->play_bgm(resourcePath(soundName), crossfadeSeconds);
 }
 
 const std::string& Engine::getResourceDir() const {
     return m_resourceDir;
 }
+
+const char* Engine::resourcePath(std::string_view name) {
+    m_pathScratch.assign(m_resourceDir).append("/").append(name);
+    return m_pathScratch.c_str();
+}
 } // namespace nyanchu
@@ -0,0 +1,46 @@
+#include "nyanchu/fixed_timestep.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nyanchu {
+
+FixedTimestep::FixedTimestep(double hz, uint32_t maxSubsteps)
+    : m_step(1.0 / hz), m_maxSubsteps(std::max(maxSubsteps, 1u)) {}
+
+void FixedTimestep::setRate(double hz) {
+    // Keep the same fraction of a step pending so alpha stays continuous.
+    const double alpha = m_accumulator / m_step;
+    m_step = 1.0 / hz;
+    m_accumulator = alpha * m_step;
+}
+
+uint32_t FixedTimestep::advance(double frameSeconds) {
+    if (!(frameSeconds > 0.0) || !std::isfinite(frameSeconds)) {
+        return 0;
+    }
+    m_accumulator += frameSeconds;
+
+    uint32_t steps = static_cast<uint32_t>(std::min(m_accumulator / m_step, static_cast<double>(m_maxSubsteps)));
+    m_accumulator -= steps * m_step;
+    if (steps == m_maxSubsteps && m_accumulator >= m_step) {
+        // Too far behind: give up on the backlog but keep the sub-step
+        // fraction so interpolation does not jump.
+        const double keep = std::fmod(m_accumulator, m_step);
+        m_droppedTime += m_accumulator - keep;
+        m_accumulator = keep;
+    }
+    // Rounding can leave a tiny negative remainder.
+    m_accumulator = std::max(m_accumulator, 0.0);
+
+    m_stepCount += steps;
+    return steps;
+}
+
+void FixedTimestep::reset() {
+    m_accumulator = 0.0;
+    m_droppedTime = 0.0;
+    m_stepCount = 0;
+}
+
+} // namespace nyanchu
@@ -0,0 +1,141 @@
+#include "nyanchu/frustum.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define NYANCHU_FRUSTUM_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define NYANCHU_FRUSTUM_NEON 1
+#endif
+
+namespace nyanchu {
+
+void AABBBatch8::set(uint32_t lane, const AABB& box) {
+    const glm::vec3 c = box.center();
+    const glm::vec3 e = box.extents();
+    centerX[lane] = c.x;
+    centerY[lane] = c.y;
+    centerZ[lane] = c.z;
+    extentX[lane] = e.x;
+    extentY[lane] = e.y;
+    extentZ[lane] = e.z;
+}
+
+Frustum::Frustum(const glm::mat4& viewProj, bool homogeneousDepth) {
+    // Gribb/Hartmann: planes are sums/differences of the matrix rows.
+    auto row = [&](int i) { return glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]); };
+    const glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+    const glm::vec4 planes[6] = {
+        r3 + r0, // left
+        r3 - r0, // right
+        r3 + r1, // bottom
+        r3 - r1, // top
+        homogeneousDepth ? r3 + r2 : r2, // near
+        r3 - r2, // far
+    };
+    for (int i = 0; i < 6; ++i) {
+        const float length = std::sqrt(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+        const float inv = length > 0.0f ? 1.0f / length : 0.0f;
+        m_nx[i] = planes[i].x * inv;
+        m_ny[i] = planes[i].y * inv;
+        m_nz[i] = planes[i].z * inv;
+        m_d[i] = planes[i].w * inv;
+    }
+}
+
+bool Frustum::intersects(const AABB& box) const {
+    const glm::vec3 c = box.center();
+    const glm::vec3 e = box.extents();
+    for (int i = 0; i < 6; ++i) {
+        const float distance = m_nx[i] * c.x + m_ny[i] * c.y + m_nz[i] * c.z + m_d[i];
+        const float radius = std::fabs(m_nx[i]) * e.x + std::fabs(m_ny[i]) * e.y + std::fabs(m_nz[i]) * e.z;
+        if (distance + radius < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint8_t Frustum::intersects8(const AABBBatch8& b, uint32_t count) const {
+    uint32_t mask = 0xff;
+#if defined(NYANCHU_FRUSTUM_SSE)
+    // Two halves of four lanes; each plane is broadcast across the lanes.
+    for (int half = 0; half < 2; ++half) {
+        const int o = half * 4;
+        const __m128 cx = _mm_load_ps(b.centerX + o), cy = _mm_load_ps(b.centerY + o), cz = _mm_load_ps(b.centerZ + o);
+        const __m128 ex = _mm_load_ps(b.extentX + o), ey = _mm_load_ps(b.extentY + o), ez = _mm_load_ps(b.extentZ + o);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int i = 0; i < 6; ++i) {
+            const __m128 nx = _mm_set1_ps(m_nx[i]), ny = _mm_set1_ps(m_ny[i]), nz = _mm_set1_ps(m_nz[i]);
+            const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)),
+                                               _mm_add_ps(_mm_mul_ps(nz, cz), _mm_set1_ps(m_d[i])));
+            const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(m_nx[i])), ex),
+                                                        _mm_mul_ps(_mm_set1_ps(std::fabs(m_ny[i])), ey)),
+                                             _mm_mul_ps(_mm_set1_ps(std::fabs(m_nz[i])), ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+        const uint32_t halfMask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+        mask &= ~(0xfu << o) | (halfMask << o);
+    }
+#elif defined(NYANCHU_FRUSTUM_NEON)
+    for (int half = 0; half < 2; ++half) {
+        const int o = half * 4;
+        const float32x4_t cx = vld1q_f32(b.centerX + o), cy = vld1q_f32(b.centerY + o), cz = vld1q_f32(b.centerZ + o);
+        const float32x4_t ex = vld1q_f32(b.extentX + o), ey = vld1q_f32(b.extentY + o), ez = vld1q_f32(b.extentZ + o);
+        uint32x4_t inside = vdupq_n_u32(0xffffffffu);
+        for (int i = 0; i < 6; ++i) {
+            float32x4_t distance = vmlaq_n_f32(vdupq_n_f32(m_d[i]), cx, m_nx[i]);
+            distance = vmlaq_n_f32(distance, cy, m_ny[i]);
+            distance = vmlaq_n_f32(distance, cz, m_nz[i]);
+            float32x4_t radius = vmulq_n_f32(ex, std::fabs(m_nx[i]));
+            radius = vmlaq_n_f32(radius, ey, std::fabs(m_ny[i]));
+            radius = vmlaq_n_f32(radius, ez, std::fabs(m_nz[i]));
+            inside = vandq_u32(inside, vcgeq_f32(vaddq_f32(distance, radius), vdupq_n_f32(0.0f)));
+        }
+        uint32_t lanes[4];
+        vst1q_u32(lanes, inside);
+        for (int lane = 0; lane < 4; ++lane) {
+            if (lanes[lane] == 0) mask &= ~(1u << (o + lane));
+        }
+    }
+#else
+    for (int lane = 0; lane < 8; ++lane) {
+        for (int i = 0; i < 6; ++i) {
+            const float distance = m_nx[i] * b.centerX[lane] + m_ny[i] * b.centerY[lane] + m_nz[i] * b.centerZ[lane] + m_d[i];
+            const float radius = std::fabs(m_nx[i]) * b.extentX[lane] + std::fabs(m_ny[i]) * b.extentY[lane] + std::fabs(m_nz[i]) * b.extentZ[lane];
+            if (distance + radius < 0.0f) {
+                mask &= ~(1u << lane);
+                break;
+            }
+        }
+    }
+#endif
+    if (count < 8) {
+        mask &= (1u << count) - 1u;
+    }
+    return static_cast<uint8_t>(mask);
+}
+
+uint32_t Frustum::cull(std::span<const AABB> boxes, std::span<uint8_t> visible) const {
+    uint32_t visibleCount = 0;
+    AABBBatch8 batch;
+    for (size_t base = 0; base < boxes.size(); base += 8) {
+        const uint32_t count = static_cast<uint32_t>(std::min<size_t>(8, boxes.size() - base));
+        for (uint32_t lane = 0; lane < 8; ++lane) {
+            // Unused lanes repeat the last box so they never hold garbage.
+            batch.set(lane, boxes[base + std::min(lane, count - 1)]);
+        }
+        const uint8_t mask = intersects8(batch, count);
+        for (uint32_t lane = 0; lane < count; ++lane) {
+            const uint8_t inside = (mask >> lane) & 1u;
+            visible[base + lane] = inside;
+            visibleCount += inside;
+        }
+    }
+    return visibleCount;
+}
+
+} // namespace nyanchu
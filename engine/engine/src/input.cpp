@@ -3,44 +3,92 @@
 
 namespace nyanchu {
 
-Input::Input(GLFWwindow* window) : m_window(window) {
-    m_currentKeys.fill(false);
-    m_previousKeys.fill(false);
-    m_currentMouseButtons.fill(false);
-    m_previousMouseButtons.fill(false);
-    
-    double x, y;
-    glfwGetCursorPos(m_window, &x, &y);
-    m_currentMousePos = glm::vec2(static_cast<float>(x), static_cast<float>(y));
-    m_previousMousePos = m_currentMousePos;
+Input::Input(GLFWwindow* window) {
+    double x = 0.0, y = 0.0;
+    if (window) {
+        glfwGetCursorPos(window, &x, &y);
+    }
+    m_liveMousePos = glm::vec2(static_cast<float>(x), static_cast<float>(y));
+    m_currentMousePos = m_liveMousePos;
+    m_previousMousePos = m_liveMousePos;
 }
 
 void Input::update() {
-    m_previousKeys = m_currentKeys;
-    m_previousMouseButtons = m_currentMouseButtons;
+    m_keys = m_liveKeys;
+    m_keysPressed = m_pendingKeysPressed;
+    m_keysReleased = m_pendingKeysReleased;
+    m_pendingKeysPressed.reset();
+    m_pendingKeysReleased.reset();
+
+    m_buttons = m_liveButtons;
+    m_buttonsPressed = m_pendingButtonsPressed;
+    m_buttonsReleased = m_pendingButtonsReleased;
+    m_pendingButtonsPressed.reset();
+    m_pendingButtonsReleased.reset();
+
+    // Swap so both vectors keep their capacity.
+    m_frameEvents.swap(m_pendingEvents);
+    m_pendingEvents.clear();
+
     m_previousMousePos = m_currentMousePos;
-    
-    for (int key = 0; key <= GLFW_KEY_LAST; ++key) {
-        m_currentKeys[key] = (glfwGetKey(m_window, key) == GLFW_PRESS);
+    m_currentMousePos = m_liveMousePos;
+}
+
+void Input::reset(glm::vec2 mousePos) {
+    m_liveKeys.reset();
+    m_pendingKeysPressed.reset();
+    m_pendingKeysReleased.reset();
+    m_liveButtons.reset();
+    m_pendingButtonsPressed.reset();
+    m_pendingButtonsReleased.reset();
+    m_pendingEvents.clear();
+    m_keys.reset();
+    m_keysPressed.reset();
+    m_keysReleased.reset();
+    m_buttons.reset();
+    m_buttonsPressed.reset();
+    m_buttonsReleased.reset();
+    m_frameEvents.clear();
+    m_liveMousePos = mousePos;
+    m_currentMousePos = mousePos;
+    m_previousMousePos = mousePos;
+}
+
+void Input::onKey(int key, int action, int mods) {
+    // GLFW_KEY_UNKNOWN and key repeats carry no state change.
+    if (key < 0 || key > GLFW_KEY_LAST || action == GLFW_REPEAT) {
+        return;
     }
-    for (int button = 0; button <= GLFW_MOUSE_BUTTON_LAST; ++button) {
-        m_currentMouseButtons[button] = (glfwGetMouseButton(m_window, button) == GLFW_PRESS);
+    const bool pressed = action == GLFW_PRESS;
+    m_liveKeys[key] = pressed;
+    (pressed ? m_pendingKeysPressed : m_pendingKeysReleased)[key] = true;
+    m_pendingEvents.push_back({ InputEvent::Type::Key, pressed, key, mods });
+}
+
+void Input::onMouseButton(int button, int action, int mods) {
+    if (button < 0 || button > GLFW_MOUSE_BUTTON_LAST) {
+        return;
     }
-    double x, y;
-    glfwGetCursorPos(m_window, &x, &y);
-    m_currentMousePos = glm::vec2(static_cast<float>(x), static_cast<float>(y));
+    const bool pressed = action == GLFW_PRESS;
+    m_liveButtons[button] = pressed;
+    (pressed ? m_pendingButtonsPressed : m_pendingButtonsReleased)[button] = true;
+    m_pendingEvents.push_back({ InputEvent::Type::MouseButton, pressed, button, mods });
+}
+
+void Input::onCursorPos(double x, double y) {
+    m_liveMousePos = glm::vec2(static_cast<float>(x), static_cast<float>(y));
 }
 
 bool Input::IsKeyDown(Key key) {
-    return m_currentKeys[key];
+    return key >= 0 && key <= GLFW_KEY_LAST && m_keys[key];
 }
 
 bool Input::IsKeyPressed(Key key) {
-    return m_currentKeys[key] && !m_previousKeys[key];
+    return key >= 0 && key <= GLFW_KEY_LAST && m_keysPressed[key];
 }
 
 bool Input::IsKeyReleased(Key key) {
-    return !m_currentKeys[key] && m_previousKeys[key];
+    return key >= 0 && key <= GLFW_KEY_LAST && m_keysReleased[key];
 }
 
 glm::vec2 Input::GetMousePosition() {
@@ -52,15 +100,15 @@ glm::vec2 Input::GetMouseDelta() {
 }
 
 bool Input::IsMouseButtonDown(MouseButton button) {
-    return m_currentMouseButtons[button];
+    return button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST && m_buttons[button];
 }
 
 bool Input::IsMouseButtonPressed(MouseButton button) {
-    return m_currentMouseButtons[button] && !m_previousMouseButtons[button];
+    return button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST && m_buttonsPressed[button];
 }
 
 bool Input::isMouseButtonReleased(MouseButton button) {
-    return !m_currentMouseButtons[button] && m_previousMouseButtons[button];
+    return button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST && m_buttonsReleased[button];
 }
 
 } // namespace nyanchu
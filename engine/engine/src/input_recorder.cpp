@@ -0,0 +1,143 @@
+#include "nyanchu/input_recorder.h"
+#include "nyanchu/input.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+namespace nyanchu {
+
+namespace {
+
+// Layout (little endian, unpadded):
+//   header: magic "NYIR", u32 version, f32 initial mouse x, f32 initial mouse y
+//   frame:  f32 delta time, f32 mouse x, f32 mouse y, u16 event count,
+//           then per event: u8 type, u8 pressed, i16 code, u8 mods
+constexpr char kRecordingMagic[4] = { 'N', 'Y', 'I', 'R' };
+constexpr uint32_t kRecordingVersion = 1;
+constexpr size_t kHeaderSize = 16;
+constexpr size_t kFrameSize = 14;
+constexpr size_t kEventSize = 5;
+
+template <typename T>
+void put(std::vector<uint8_t>& out, T value) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T get(const uint8_t*& in) {
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+}
+
+} // namespace
+
+bool InputRecorder::open(const std::string& path, glm::vec2 initialMousePos) {
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        std::cerr << "Failed to open input recording: " << path << std::endl;
+        return false;
+    }
+    m_buffer.clear();
+    m_buffer.insert(m_buffer.end(), kRecordingMagic, kRecordingMagic + 4);
+    put<uint32_t>(m_buffer, kRecordingVersion);
+    put<float>(m_buffer, initialMousePos.x);
+    put<float>(m_buffer, initialMousePos.y);
+    m_file.write(reinterpret_cast<const char*>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size()));
+    m_frameCount = 0;
+    return static_cast<bool>(m_file);
+}
+
+void InputRecorder::recordFrame(float deltaTime, Input& input) {
+    if (!m_file.is_open()) {
+        return;
+    }
+    const auto events = input.getEvents();
+    const glm::vec2 mouse = input.GetMousePosition();
+    const size_t count = std::min<size_t>(events.size(), UINT16_MAX);
+
+    m_buffer.clear();
+    put<float>(m_buffer, deltaTime);
+    put<float>(m_buffer, mouse.x);
+    put<float>(m_buffer, mouse.y);
+    put<uint16_t>(m_buffer, static_cast<uint16_t>(count));
+    for (size_t i = 0; i < count; ++i) {
+        put<uint8_t>(m_buffer, static_cast<uint8_t>(events[i].type));
+        put<uint8_t>(m_buffer, events[i].pressed ? 1 : 0);
+        put<int16_t>(m_buffer, static_cast<int16_t>(events[i].code));
+        put<uint8_t>(m_buffer, static_cast<uint8_t>(events[i].mods));
+    }
+    m_file.write(reinterpret_cast<const char*>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size()));
+    ++m_frameCount;
+}
+
+void InputRecorder::close() {
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+}
+
+bool InputReplay::open(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open input recording: " << path << std::endl;
+        return false;
+    }
+    m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (m_data.size() < kHeaderSize || std::memcmp(m_data.data(), kRecordingMagic, 4) != 0) {
+        std::cerr << "Not an input recording: " << path << std::endl;
+        return false;
+    }
+    const uint8_t* in = m_data.data() + 4;
+    if (get<uint32_t>(in) != kRecordingVersion) {
+        std::cerr << "Unsupported input recording version: " << path << std::endl;
+        return false;
+    }
+    m_initialMousePos.x = get<float>(in);
+    m_initialMousePos.y = get<float>(in);
+    m_offset = kHeaderSize;
+    m_frameIndex = 0;
+    return true;
+}
+
+void InputReplay::prime(Input& input) const {
+    input.reset(m_initialMousePos);
+}
+
+bool InputReplay::nextFrame(Input& input, float& deltaTime) {
+    if (m_data.size() - m_offset < kFrameSize) {
+        return false;
+    }
+    const uint8_t* in = m_data.data() + m_offset;
+    deltaTime = get<float>(in);
+    const float mouseX = get<float>(in);
+    const float mouseY = get<float>(in);
+    const uint16_t count = get<uint16_t>(in);
+    if (m_data.size() - m_offset - kFrameSize < size_t(count) * kEventSize) {
+        return false; // truncated recording
+    }
+
+    for (uint16_t i = 0; i < count; ++i) {
+        const auto type = static_cast<InputEvent::Type>(get<uint8_t>(in));
+        const int action = get<uint8_t>(in) ? GLFW_PRESS : GLFW_RELEASE;
+        const int code = get<int16_t>(in);
+        const int mods = get<uint8_t>(in);
+        if (type == InputEvent::Type::Key) {
+            input.onKey(code, action, mods);
+        } else {
+            input.onMouseButton(code, action, mods);
+        }
+    }
+    input.onCursorPos(mouseX, mouseY);
+    input.update();
+
+    m_offset += kFrameSize + size_t(count) * kEventSize;
+    ++m_frameIndex;
+    return true;
+}
+
+} // namespace nyanchu
@@ -0,0 +1,125 @@
+#include "nyanchu/job_system.h"
+#include "nyanchu/profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace nyanchu {
+
+namespace {
+
+// Shared between the caller and the helper jobs of one parallelFor. Helpers
+// can start after the loop is over, so it is reference counted.
+struct ParallelForState {
+    const JobSystem::RangeFn* fn = nullptr;
+    uint32_t count = 0;
+    uint32_t batchSize = 0;
+    uint32_t batchCount = 0;
+    std::atomic<uint32_t> nextBatch{0};
+    std::atomic<uint32_t> doneBatches{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    void drain() {
+        uint32_t batch;
+        while ((batch = nextBatch.fetch_add(1, std::memory_order_relaxed)) < batchCount) {
+            const uint32_t begin = batch * batchSize;
+            const uint32_t end = std::min(count, begin + batchSize);
+            (*fn)(begin, end);
+            if (doneBatches.fetch_add(1, std::memory_order_acq_rel) + 1 == batchCount) {
+                std::lock_guard<std::mutex> lock(mutex);
+                cv.notify_all();
+            }
+        }
+    }
+};
+
+} // namespace
+
+JobSystem::JobSystem(uint32_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_workers.reserve(threadCount - 1);
+    for (uint32_t i = 1; i < threadCount; ++i) {
+        m_workers.emplace_back([this, i] {
+            Profiler::setThreadName("Worker " + std::to_string(i));
+            workerLoop();
+        });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void JobSystem::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+            task = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        task();
+    }
+}
+
+void JobSystem::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t batchSize, const RangeFn& fn) {
+    if (count == 0) {
+        return;
+    }
+    batchSize = std::max(1u, batchSize);
+    const uint32_t batchCount = (count + batchSize - 1) / batchSize;
+    if (m_workers.empty() || batchCount == 1) {
+        fn(0, count);
+        return;
+    }
+
+    auto state = std::make_shared<ParallelForState>();
+    state->fn = &fn;
+    state->count = count;
+    state->batchSize = batchSize;
+    state->batchCount = batchCount;
+
+    const uint32_t helpers = std::min<uint32_t>(batchCount - 1, static_cast<uint32_t>(m_workers.size()));
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (uint32_t i = 0; i < helpers; ++i) {
+            m_queue.push_back([state] { state->drain(); });
+        }
+    }
+    if (helpers == 1) {
+        m_cv.notify_one();
+    } else {
+        m_cv.notify_all();
+    }
+
+    state->drain();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&] { return state->doneBatches.load(std::memory_order_acquire) == batchCount; });
+}
+
+} // namespace nyanchu
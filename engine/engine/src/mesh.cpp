@@ -1,19 +1,378 @@
 
 #include "nyanchu/mesh.h"
+#include "nyanchu/job_system.h"
+#include "nyanchu/vertex_welder.h"
+#include "platform/platform_utils.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
-#include <unordered_map>
+#include <streambuf>
+#include <utility>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define NYANCHU_MESH_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define NYANCHU_MESH_NEON 1
+#endif
 
 namespace nyanchu {
 
-Mesh::Mesh(const std::string& filepath) {
-    loadFromFile(filepath);
+namespace {
+
+// Cooked mesh layout: header, then the deduplicated vertex and index blobs
+// and the triangle BVH's nodes and blocks, each starting on a
+// kCookedAlignment boundary so they can be used in place.
+constexpr char kCookedMagic[4] = { 'N', 'Y', 'M', 'S' };
+constexpr uint32_t kCookedVersion = 3;
+constexpr uint64_t kCookedAlignment = 16;
+
+struct CookedMeshHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;     // size of the OBJ it was cooked from
+    int64_t sourceWriteTime; // last write time of that OBJ, in file clock ticks
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    float boundsMin[3];
+    float boundsMax[3];
+    float sphereCenter[3];
+    float sphereRadius;
+    uint32_t bvhNodeCount;
+    uint32_t bvhBlockCount;
+    uint64_t bvhNodeOffset;
+    uint64_t bvhBlockOffset;
+};
+static_assert(sizeof(Vertex) == 32, "cooked mesh format assumes a tightly packed 32-byte Vertex");
+static_assert(sizeof(TriangleBVH::Node) == 32 && sizeof(TriangleBVH::Block) == 160,
+              "cooked mesh format assumes the packed TriangleBVH layout");
+
+uint64_t alignUp(uint64_t value) {
+    return (value + kCookedAlignment - 1) & ~(kCookedAlignment - 1);
+}
+
+bool sourceStamp(const std::string& path, uint64_t& size, int64_t& writeTime) {
+    std::error_code ec;
+    size = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+    auto time = std::filesystem::last_write_time(path, ec);
+    if (ec) return false;
+    writeTime = static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+// The position sits in the first 12 bytes of each 32-byte vertex, so an
+// unaligned 16-byte load picks it up (plus normal.x, which the lane masks
+// and the final reduction ignore).
+AABB positionBounds(std::span<const Vertex> vertices) {
+    if (vertices.empty()) {
+        return { glm::vec3(0.0f), glm::vec3(0.0f) };
+    }
+    const float* base = &vertices[0].position.x;
+    constexpr size_t kStride = sizeof(Vertex) / sizeof(float);
+    const size_t count = vertices.size();
+    float lo[4], hi[4];
+#if NYANCHU_MESH_SSE
+    __m128 min0 = _mm_loadu_ps(base), max0 = min0, min1 = min0, max1 = min0;
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128 a = _mm_loadu_ps(base + i * kStride);
+        const __m128 b = _mm_loadu_ps(base + (i + 1) * kStride);
+        min0 = _mm_min_ps(min0, a);
+        max0 = _mm_max_ps(max0, a);
+        min1 = _mm_min_ps(min1, b);
+        max1 = _mm_max_ps(max1, b);
+    }
+    if (i < count) {
+        const __m128 a = _mm_loadu_ps(base + i * kStride);
+        min0 = _mm_min_ps(min0, a);
+        max0 = _mm_max_ps(max0, a);
+    }
+    _mm_storeu_ps(lo, _mm_min_ps(min0, min1));
+    _mm_storeu_ps(hi, _mm_max_ps(max0, max1));
+#elif NYANCHU_MESH_NEON
+    float32x4_t min0 = vld1q_f32(base), max0 = min0, min1 = min0, max1 = min0;
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const float32x4_t a = vld1q_f32(base + i * kStride);
+        const float32x4_t b = vld1q_f32(base + (i + 1) * kStride);
+        min0 = vminq_f32(min0, a);
+        max0 = vmaxq_f32(max0, a);
+        min1 = vminq_f32(min1, b);
+        max1 = vmaxq_f32(max1, b);
+    }
+    if (i < count) {
+        const float32x4_t a = vld1q_f32(base + i * kStride);
+        min0 = vminq_f32(min0, a);
+        max0 = vmaxq_f32(max0, a);
+    }
+    vst1q_f32(lo, vminq_f32(min0, min1));
+    vst1q_f32(hi, vmaxq_f32(max0, max1));
+#else
+    for (int c = 0; c < 3; ++c) {
+        lo[c] = hi[c] = base[c];
+    }
+    for (size_t i = 1; i < count; ++i) {
+        const float* p = base + i * kStride;
+        for (int c = 0; c < 3; ++c) {
+            lo[c] = std::min(lo[c], p[c]);
+            hi[c] = std::max(hi[c], p[c]);
+        }
+    }
+#endif
+    return { glm::vec3(lo[0], lo[1], lo[2]), glm::vec3(hi[0], hi[1], hi[2]) };
+}
+
+// Largest squared distance from `center` to any position.
+float maxDistanceSquared(std::span<const Vertex> vertices, const glm::vec3& center) {
+    float best = 0.0f;
+    for (const Vertex& vertex : vertices) {
+        const glm::vec3 d = vertex.position - center;
+        best = std::max(best, d.x * d.x + d.y * d.y + d.z * d.z);
+    }
+    return best;
+}
+
+} // namespace
+
+Mesh::Mesh(const std::string& filepath, JobSystem* jobs) {
+    loadFromFile(filepath, jobs);
+}
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices)
+    : m_vertices(std::move(vertices))
+    , m_indices(std::move(indices))
+    , m_vertexView(m_vertices)
+    , m_indexView(m_indices)
+{
+    computeBounds();
+    buildBVH();
+}
+
+Mesh::Mesh(Mesh&& other) noexcept {
+    *this = std::move(other);
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    m_id = std::exchange(other.m_id, newId());
+    m_vertices = std::move(other.m_vertices);
+    m_indices = std::move(other.m_indices);
+    m_mapping = std::move(other.m_mapping);
+    // Moving a vector keeps its buffer, so the views stay valid here.
+    m_vertexView = std::exchange(other.m_vertexView, {});
+    m_indexView = std::exchange(other.m_indexView, {});
+    m_bounds = other.m_bounds;
+    m_sphere = other.m_sphere;
+    m_bvh = std::exchange(other.m_bvh, {});
+    return *this;
+}
+
+uint64_t Mesh::newId() {
+    static std::atomic<uint64_t> next{ 1 };
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string Mesh::cookedPathFor(const std::string& objPath) {
+    return std::filesystem::path(objPath).replace_extension(".nymesh").string();
+}
+
+Mesh Mesh::parseObj(const std::string& objPath, JobSystem* jobs) {
+    Mesh mesh;
+    mesh.loadObj(objPath, jobs);
+    return mesh;
+}
+
+bool Mesh::cook(const std::string& objPath, const std::string& cookedPath, JobSystem* jobs) {
+    Mesh mesh(objPath, jobs);
+    // A fresh cooked file may already have been produced by the constructor.
+    if (mesh.isMapped() && cookedPath == cookedPathFor(objPath)) {
+        return true;
+    }
+    return mesh.writeCooked(cookedPath, objPath);
+}
+
+void Mesh::loadFromFile(const std::string& filepath, JobSystem* jobs) {
+    const std::string cookedPath = cookedPathFor(filepath);
+    if (loadCooked(cookedPath, filepath)) {
+        return;
+    }
+
+    loadObj(filepath, jobs);
+
+    if (!writeCooked(cookedPath, filepath)) {
+        std::cerr << "Failed to write cooked mesh: " << cookedPath << std::endl;
+    }
+}
+
+void Mesh::computeBounds() {
+    m_bounds = positionBounds(m_vertexView);
+    // AABB-centred sphere: not minimal, but cheap and stable across re-cooks.
+    m_sphere.center = m_bounds.center();
+    m_sphere.radius = std::sqrt(maxDistanceSquared(m_vertexView, m_sphere.center));
+}
+
+void Mesh::buildBVH() {
+    std::vector<glm::vec3> positions(m_vertexView.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        positions[i] = m_vertexView[i].position;
+    }
+    m_bvh = TriangleBVH::build(positions, m_indexView);
+}
+
+bool Mesh::loadCooked(const std::string& cookedPath, const std::string& sourcePath) {
+    std::error_code ec;
+    if (!std::filesystem::exists(cookedPath, ec)) {
+        return false;
+    }
+
+    size_t size = 0;
+    void* handle = nullptr;
+    const void* data = mapFileReadOnly(cookedPath, &size, &handle);
+    if (!data) {
+        return false;
+    }
+    std::shared_ptr<const void> mapping(data, [size, handle](const void* p) { unmapFile(p, size, handle); });
+
+    if (size < sizeof(CookedMeshHeader)) {
+        return false;
+    }
+    CookedMeshHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kCookedMagic, sizeof(kCookedMagic)) != 0 || header.version != kCookedVersion) {
+        return false;
+    }
+
+    // Shipping builds may carry only the cooked file; otherwise it has to match the OBJ.
+    uint64_t sourceSize = 0;
+    int64_t sourceWriteTime = 0;
+    if (sourceStamp(sourcePath, sourceSize, sourceWriteTime) &&
+        (sourceSize != header.sourceSize || sourceWriteTime != header.sourceWriteTime)) {
+        return false;
+    }
+
+    const uint64_t vertexBytes = uint64_t(header.vertexCount) * sizeof(Vertex);
+    const uint64_t indexBytes = uint64_t(header.indexCount) * sizeof(uint32_t);
+    const uint64_t nodeBytes = uint64_t(header.bvhNodeCount) * sizeof(TriangleBVH::Node);
+    const uint64_t blockBytes = uint64_t(header.bvhBlockCount) * sizeof(TriangleBVH::Block);
+    if (header.vertexOffset % kCookedAlignment != 0 || header.indexOffset % kCookedAlignment != 0 ||
+        header.bvhNodeOffset % kCookedAlignment != 0 || header.bvhBlockOffset % kCookedAlignment != 0 ||
+        header.vertexOffset > size || vertexBytes > size - header.vertexOffset ||
+        header.indexOffset > size || indexBytes > size - header.indexOffset ||
+        header.bvhNodeOffset > size || nodeBytes > size - header.bvhNodeOffset ||
+        header.bvhBlockOffset > size || blockBytes > size - header.bvhBlockOffset) {
+        return false;
+    }
+
+    // Rendering and raycasts index memory by these values unchecked, so a
+    // damaged file has to be rejected here.
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    const std::span<const uint32_t> indices(reinterpret_cast<const uint32_t*>(bytes + header.indexOffset), header.indexCount);
+    if (indices.size() % 3 != 0 ||
+        std::any_of(indices.begin(), indices.end(), [&](uint32_t index) { return index >= header.vertexCount; })) {
+        return false;
+    }
+    const std::span<const TriangleBVH::Node> nodes(
+        reinterpret_cast<const TriangleBVH::Node*>(bytes + header.bvhNodeOffset), header.bvhNodeCount);
+    const std::span<const TriangleBVH::Block> blocks(
+        reinterpret_cast<const TriangleBVH::Block*>(bytes + header.bvhBlockOffset), header.bvhBlockCount);
+    if (!TriangleBVH::validate(nodes, blocks, static_cast<uint32_t>(indices.size() / 3))) {
+        return false;
+    }
+
+    m_vertices.clear();
+    m_indices.clear();
+    m_vertexView = { reinterpret_cast<const Vertex*>(bytes + header.vertexOffset), header.vertexCount };
+    m_indexView = indices;
+    m_mapping = std::move(mapping);
+    m_bounds.min = { header.boundsMin[0], header.boundsMin[1], header.boundsMin[2] };
+    m_bounds.max = { header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] };
+    m_sphere.center = { header.sphereCenter[0], header.sphereCenter[1], header.sphereCenter[2] };
+    m_sphere.radius = header.sphereRadius;
+    m_bvh = TriangleBVH::view(nodes, blocks);
+    return true;
+}
+
+bool Mesh::writeCooked(const std::string& cookedPath, const std::string& sourcePath) const {
+    CookedMeshHeader header{};
+    std::memcpy(header.magic, kCookedMagic, sizeof(kCookedMagic));
+    header.version = kCookedVersion;
+    if (!sourceStamp(sourcePath, header.sourceSize, header.sourceWriteTime)) {
+        return false;
+    }
+    header.vertexCount = static_cast<uint32_t>(m_vertexView.size());
+    header.indexCount = static_cast<uint32_t>(m_indexView.size());
+    header.vertexOffset = alignUp(sizeof(CookedMeshHeader));
+    header.indexOffset = alignUp(header.vertexOffset + m_vertexView.size_bytes());
+    for (int c = 0; c < 3; ++c) {
+        header.boundsMin[c] = m_bounds.min[c];
+        header.boundsMax[c] = m_bounds.max[c];
+        header.sphereCenter[c] = m_sphere.center[c];
+    }
+    header.sphereRadius = m_sphere.radius;
+    const auto nodes = m_bvh.getNodes();
+    const auto blocks = m_bvh.getBlocks();
+    header.bvhNodeCount = static_cast<uint32_t>(nodes.size());
+    header.bvhBlockCount = static_cast<uint32_t>(blocks.size());
+    header.bvhNodeOffset = alignUp(header.indexOffset + m_indexView.size_bytes());
+    header.bvhBlockOffset = alignUp(header.bvhNodeOffset + nodes.size_bytes());
+
+    // Write next to the destination and rename so readers never see a partial file.
+    const std::string tempPath = cookedPath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        static const char padding[kCookedAlignment] = {};
+        auto writeAt = [&](uint64_t offset, const void* data, size_t bytes) {
+            const uint64_t position = static_cast<uint64_t>(file.tellp());
+            file.write(padding, static_cast<std::streamsize>(offset - position));
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeAt(header.vertexOffset, m_vertexView.data(), m_vertexView.size_bytes());
+        writeAt(header.indexOffset, m_indexView.data(), m_indexView.size_bytes());
+        writeAt(header.bvhNodeOffset, nodes.data(), nodes.size_bytes());
+        writeAt(header.bvhBlockOffset, blocks.data(), blocks.size_bytes());
+        if (!file) {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, cookedPath, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
 }
 
-void Mesh::loadFromFile(const std::string& filepath) {
+void Mesh::loadObj(const std::string& filepath, JobSystem* jobs) {
+    if (!jobs || !loadObjParallel(filepath, *jobs)) {
+        loadObjSerial(filepath);
+    }
+    computeBounds();
+    buildBVH();
+}
+
+void Mesh::loadObjSerial(const std::string& filepath) {
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
@@ -23,7 +382,14 @@ void Mesh::loadFromFile(const std::string& filepath) {
         throw std::runtime_error(warn + err);
     }
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+    size_t indexCount = 0;
+    for (const auto& shape : shapes) {
+        indexCount += shape.mesh.indices.size();
+    }
+
+    VertexWelder welder(indexCount);
+    m_indices.clear();
+    m_indices.reserve(indexCount);
 
     for (const auto& shape : shapes) {
         for (const auto& index : shape.mesh.indices) {
@@ -50,13 +416,305 @@ void Mesh::loadFromFile(const std::string& filepath) {
                 };
             }
 
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(m_vertices.size());
-                m_vertices.push_back(vertex);
+            m_indices.push_back(welder.weld(vertex));
+        }
+    }
+    m_vertices = welder.takeVertices();
+
+    m_mapping.reset();
+    m_vertexView = m_vertices;
+    m_indexView = m_indices;
+}
+
+namespace {
+
+// OBJ files smaller than this parse faster serially than they split.
+constexpr size_t kParallelObjMinBytes = 1 << 20;
+constexpr size_t kObjChunkMinBytes = 256 << 10;
+
+// Lets tinyobj read a slice of the mapped file without copying it.
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(const char* begin, const char* end) {
+        setg(const_cast<char*>(begin), const_cast<char*>(begin), const_cast<char*>(end));
+    }
+};
+
+// One line-aligned slice of an OBJ file. Element arrays are local to the
+// slice; faces keep their raw indices plus the element counts at their line
+// so relative indices can be resolved once the slice's offsets are known.
+struct ObjChunk {
+    struct Face {
+        uint32_t firstCorner;
+        uint32_t cornerCount;
+        uint32_t positionCount;
+        uint32_t normalCount;
+        uint32_t texcoordCount;
+    };
+
+    const char* begin = nullptr;
+    const char* end = nullptr;
+
+    std::vector<tinyobj::real_t> positions; // xyz
+    std::vector<tinyobj::real_t> normals;   // xyz
+    std::vector<tinyobj::real_t> texcoords; // uv
+    std::vector<tinyobj::index_t> corners;
+    std::vector<Face> faces;
+    uint32_t triangleCornerCount = 0;
+
+    uint32_t positionBase = 0;
+    uint32_t normalBase = 0;
+    uint32_t texcoordBase = 0;
+
+    // Chunk-local welding results; merged in file order afterwards.
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    uint32_t indexBase = 0;
+
+    // Set when the chunk uses something only the serial loader reproduces.
+    bool needsSerial = false;
+};
+
+void onObjVertex(void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z, tinyobj::real_t) {
+    auto& chunk = *static_cast<ObjChunk*>(user);
+    chunk.positions.insert(chunk.positions.end(), { x, y, z });
+}
+
+void onObjNormal(void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z) {
+    auto& chunk = *static_cast<ObjChunk*>(user);
+    chunk.normals.insert(chunk.normals.end(), { x, y, z });
+}
+
+void onObjTexcoord(void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t) {
+    auto& chunk = *static_cast<ObjChunk*>(user);
+    chunk.texcoords.insert(chunk.texcoords.end(), { x, y });
+}
+
+void onObjFace(void* user, tinyobj::index_t* indices, int count) {
+    auto& chunk = *static_cast<ObjChunk*>(user);
+    // Polygons beyond quads go through tinyobj's ear clipping.
+    if (count > 4) {
+        chunk.needsSerial = true;
+        return;
+    }
+    chunk.faces.push_back({ static_cast<uint32_t>(chunk.corners.size()), static_cast<uint32_t>(count),
+                            static_cast<uint32_t>(chunk.positions.size() / 3),
+                            static_cast<uint32_t>(chunk.normals.size() / 3),
+                            static_cast<uint32_t>(chunk.texcoords.size() / 2) });
+    chunk.corners.insert(chunk.corners.end(), indices, indices + count);
+    if (count == 3) chunk.triangleCornerCount += 3;
+    if (count == 4) chunk.triangleCornerCount += 6;
+}
+
+// Mirrors tinyobj's fixIndex, but also rejects references to elements that
+// appear later in the file, which the serial loader resolves differently.
+bool resolveObjIndex(int raw, uint32_t countAtLine, bool allowZero, int& out) {
+    if (raw > 0) {
+        out = raw - 1;
+    } else if (raw == 0) {
+        out = -1;
+        return allowZero;
+    } else {
+        out = static_cast<int>(countAtLine) + raw;
+        if (out < 0) return false;
+    }
+    return static_cast<uint32_t>(out) < countAtLine;
+}
+
+} // namespace
+
+bool Mesh::loadObjParallel(const std::string& filepath, JobSystem& jobs) {
+    size_t size = 0;
+    void* handle = nullptr;
+    const void* data = mapFileReadOnly(filepath, &size, &handle);
+    if (!data) {
+        return false;
+    }
+    std::shared_ptr<const void> mapping(data, [size, handle](const void* p) { unmapFile(p, size, handle); });
+    if (size < kParallelObjMinBytes) {
+        return false;
+    }
+
+    const char* fileBegin = static_cast<const char*>(data);
+    const char* fileEnd = fileBegin + size;
+    // tinyobj strips a UTF-8 BOM from the first line.
+    if (size >= 3 && std::memcmp(fileBegin, "\xEF\xBB\xBF", 3) == 0) {
+        fileBegin += 3;
+    }
+
+    // Split on line boundaries, a few chunks per thread for load balancing.
+    const size_t chunkTarget = std::max(kObjChunkMinBytes, size / (size_t(jobs.getThreadCount()) * 4));
+    std::vector<ObjChunk> chunks;
+    for (const char* begin = fileBegin; begin < fileEnd;) {
+        const char* end = begin + std::min(chunkTarget, size_t(fileEnd - begin));
+        end = std::find(end, fileEnd, '\n');
+        if (end != fileEnd) ++end;
+        chunks.emplace_back();
+        chunks.back().begin = begin;
+        chunks.back().end = end;
+        begin = end;
+    }
+    const uint32_t chunkCount = static_cast<uint32_t>(chunks.size());
+
+    // Parse every chunk with tinyobj's own number and index parsing.
+    std::vector<uint8_t> parsed(chunkCount, 0);
+    jobs.parallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end) {
+        tinyobj::callback_t callbacks;
+        callbacks.vertex_cb = onObjVertex;
+        callbacks.normal_cb = onObjNormal;
+        callbacks.texcoord_cb = onObjTexcoord;
+        callbacks.index_cb = onObjFace;
+        for (uint32_t i = begin; i < end; ++i) {
+            MemoryStreamBuf buffer(chunks[i].begin, chunks[i].end);
+            std::istream stream(&buffer);
+            std::string warn, err;
+            parsed[i] = tinyobj::LoadObjWithCallback(stream, callbacks, &chunks[i], nullptr, &warn, &err);
+        }
+    });
+
+    // Element offsets of each chunk, and the merged element arrays.
+    uint32_t positionCount = 0, normalCount = 0, texcoordCount = 0;
+    for (uint32_t i = 0; i < chunkCount; ++i) {
+        ObjChunk& chunk = chunks[i];
+        if (!parsed[i] || chunk.needsSerial) {
+            return false;
+        }
+        chunk.positionBase = positionCount;
+        chunk.normalBase = normalCount;
+        chunk.texcoordBase = texcoordCount;
+        positionCount += static_cast<uint32_t>(chunk.positions.size() / 3);
+        normalCount += static_cast<uint32_t>(chunk.normals.size() / 3);
+        texcoordCount += static_cast<uint32_t>(chunk.texcoords.size() / 2);
+    }
+    std::vector<tinyobj::real_t> positions(size_t(positionCount) * 3);
+    std::vector<tinyobj::real_t> normals(size_t(normalCount) * 3);
+    std::vector<tinyobj::real_t> texcoords(size_t(texcoordCount) * 2);
+    jobs.parallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            ObjChunk& chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + size_t(chunk.positionBase) * 3);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + size_t(chunk.normalBase) * 3);
+            std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + size_t(chunk.texcoordBase) * 2);
+            chunk.positions = {};
+            chunk.normals = {};
+            chunk.texcoords = {};
+        }
+    });
+
+    // Triangulate exactly like tinyobj and weld inside each chunk.
+    jobs.parallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            ObjChunk& chunk = chunks[i];
+            VertexWelder welder(chunk.triangleCornerCount);
+            chunk.indices.reserve(chunk.triangleCornerCount);
+
+            for (const ObjChunk::Face& face : chunk.faces) {
+                struct Corner { int v, vn, vt; } corner[4];
+                bool valid = true;
+                for (uint32_t k = 0; k < face.cornerCount; ++k) {
+                    const tinyobj::index_t& raw = chunk.corners[face.firstCorner + k];
+                    valid = valid &&
+                        resolveObjIndex(raw.vertex_index, chunk.positionBase + face.positionCount, false, corner[k].v) &&
+                        resolveObjIndex(raw.normal_index, chunk.normalBase + face.normalCount, true, corner[k].vn) &&
+                        resolveObjIndex(raw.texcoord_index, chunk.texcoordBase + face.texcoordCount, true, corner[k].vt);
+                }
+                if (!valid) {
+                    chunk.needsSerial = true;
+                    break;
+                }
+                if (face.cornerCount < 3) {
+                    continue; // tinyobj drops degenerate faces
+                }
+
+                int order[6] = { 0, 1, 2, 0, 0, 0 };
+                uint32_t orderCount = 3;
+                if (face.cornerCount == 4) {
+                    // Split along the shorter diagonal, as tinyobj does.
+                    const tinyobj::real_t* v0 = &positions[size_t(corner[0].v) * 3];
+                    const tinyobj::real_t* v1 = &positions[size_t(corner[1].v) * 3];
+                    const tinyobj::real_t* v2 = &positions[size_t(corner[2].v) * 3];
+                    const tinyobj::real_t* v3 = &positions[size_t(corner[3].v) * 3];
+                    tinyobj::real_t e02x = v2[0] - v0[0];
+                    tinyobj::real_t e02y = v2[1] - v0[1];
+                    tinyobj::real_t e02z = v2[2] - v0[2];
+                    tinyobj::real_t e13x = v3[0] - v1[0];
+                    tinyobj::real_t e13y = v3[1] - v1[1];
+                    tinyobj::real_t e13z = v3[2] - v1[2];
+                    tinyobj::real_t sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+                    tinyobj::real_t sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+                    const int split02[6] = { 0, 1, 2, 0, 2, 3 };
+                    const int split13[6] = { 0, 1, 3, 1, 2, 3 };
+                    std::copy_n(sqr02 < sqr13 ? split02 : split13, 6, order);
+                    orderCount = 6;
+                }
+
+                for (uint32_t k = 0; k < orderCount; ++k) {
+                    const Corner& c = corner[order[k]];
+                    Vertex vertex{};
+                    vertex.position = {
+                        positions[3 * size_t(c.v) + 0],
+                        positions[3 * size_t(c.v) + 1],
+                        positions[3 * size_t(c.v) + 2]
+                    };
+                    if (c.vn >= 0) {
+                        vertex.normal = {
+                            normals[3 * size_t(c.vn) + 0],
+                            normals[3 * size_t(c.vn) + 1],
+                            normals[3 * size_t(c.vn) + 2]
+                        };
+                    }
+                    if (c.vt >= 0) {
+                        vertex.texcoord = {
+                            texcoords[2 * size_t(c.vt) + 0],
+                            texcoords[2 * size_t(c.vt) + 1]
+                        };
+                    }
+                    chunk.indices.push_back(welder.weld(vertex));
+                }
             }
-            m_indices.push_back(uniqueVertices[vertex]);
+            chunk.vertices = welder.takeVertices();
+            chunk.corners = {};
+            chunk.faces = {};
+        }
+    });
+
+    // Merging chunk-local vertices in file order keeps first-occurrence order,
+    // so the indices match a single serial weld.
+    size_t localVertexCount = 0;
+    uint32_t indexCount = 0;
+    for (ObjChunk& chunk : chunks) {
+        if (chunk.needsSerial) {
+            return false;
+        }
+        localVertexCount += chunk.vertices.size();
+        chunk.indexBase = indexCount;
+        indexCount += static_cast<uint32_t>(chunk.indices.size());
+    }
+
+    VertexWelder welder(localVertexCount);
+    std::vector<std::vector<uint32_t>> remap(chunkCount);
+    for (uint32_t i = 0; i < chunkCount; ++i) {
+        remap[i].reserve(chunks[i].vertices.size());
+        for (const Vertex& vertex : chunks[i].vertices) {
+            remap[i].push_back(welder.weld(vertex));
         }
     }
+
+    m_indices.resize(indexCount);
+    jobs.parallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            uint32_t* out = m_indices.data() + chunks[i].indexBase;
+            for (uint32_t index : chunks[i].indices) {
+                *out++ = remap[i][index];
+            }
+        }
+    });
+    m_vertices = welder.takeVertices();
+
+    m_mapping.reset();
+    m_vertexView = m_vertices;
+    m_indexView = m_indices;
+    return true;
 }
 
 } // namespace nyanchu
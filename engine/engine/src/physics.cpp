@@ -0,0 +1,918 @@
+#include "nyanchu/physics.h"
+#include "nyanchu/ecs.h"
+#include "nyanchu/fixed_timestep.h"
+#include "nyanchu/job_system.h"
+#include "nyanchu/mesh.h"
+#include "nyanchu/profiler.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iostream>
+
+namespace nyanchu {
+
+namespace {
+
+// Penetration allowed before position correction kicks in, and the fraction
+// of the remaining penetration removed per step.
+constexpr float kLinearSlop = 0.01f;
+constexpr float kBaumgarte = 0.2f;
+// Approach speed below which contacts do not bounce.
+constexpr float kRestitutionThreshold = 1.0f;
+// Contacts closer than this to one of the previous step's contacts on the
+// same pair start from its impulses.
+constexpr float kWarmStartDistance = 0.05f;
+// Contact points closer than this are merged into one.
+constexpr float kContactMergeDistance = 0.02f;
+// Colors 0..63 are solved in parallel; contacts that find no free color go
+// to one extra batch solved serially.
+constexpr uint32_t kMaxColors = 64;
+
+glm::mat3 rotationMatrix(const glm::quat& q) {
+    return glm::mat3_cast(q);
+}
+
+AABB boxBounds(const glm::vec3& center, const glm::mat3& axes, const glm::vec3& halfExtents) {
+    const glm::vec3 r(
+        std::abs(axes[0].x) * halfExtents.x + std::abs(axes[1].x) * halfExtents.y + std::abs(axes[2].x) * halfExtents.z,
+        std::abs(axes[0].y) * halfExtents.x + std::abs(axes[1].y) * halfExtents.y + std::abs(axes[2].y) * halfExtents.z,
+        std::abs(axes[0].z) * halfExtents.x + std::abs(axes[1].z) * halfExtents.y + std::abs(axes[2].z) * halfExtents.z);
+    return { center - r, center + r };
+}
+
+void boxCorners(const glm::vec3& center, const glm::mat3& axes, const glm::vec3& halfExtents, glm::vec3 (&corners)[8]) {
+    const glm::vec3 x = axes[0] * halfExtents.x;
+    const glm::vec3 y = axes[1] * halfExtents.y;
+    const glm::vec3 z = axes[2] * halfExtents.z;
+    for (int i = 0; i < 8; ++i) {
+        corners[i] = center + ((i & 1) ? x : -x) + ((i & 2) ? y : -y) + ((i & 4) ? z : -z);
+    }
+}
+
+// Radius of the box projected onto `axis`.
+float projectedRadius(const glm::mat3& axes, const glm::vec3& halfExtents, const glm::vec3& axis) {
+    return std::abs(glm::dot(axis, axes[0])) * halfExtents.x +
+           std::abs(glm::dot(axis, axes[1])) * halfExtents.y +
+           std::abs(glm::dot(axis, axes[2])) * halfExtents.z;
+}
+
+glm::vec3 supportPoint(const glm::vec3& center, const glm::mat3& axes, const glm::vec3& halfExtents, const glm::vec3& direction) {
+    glm::vec3 p = center;
+    for (int i = 0; i < 3; ++i) {
+        p += axes[i] * (glm::dot(direction, axes[i]) >= 0.0f ? halfExtents[i] : -halfExtents[i]);
+    }
+    return p;
+}
+
+// Real-Time Collision Detection, 5.1.5.
+glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+    const glm::vec3 ab = b - a;
+    const glm::vec3 ac = c - a;
+    const glm::vec3 ap = p - a;
+    const float d1 = glm::dot(ab, ap);
+    const float d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+    const glm::vec3 bp = p - b;
+    const float d3 = glm::dot(ab, bp);
+    const float d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) return b;
+
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+
+    const glm::vec3 cp = p - c;
+    const float d5 = glm::dot(ab, cp);
+    const float d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) return c;
+
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    const float denom = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+bool insideTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& normal) {
+    return glm::dot(glm::cross(b - a, p - a), normal) >= 0.0f &&
+           glm::dot(glm::cross(c - b, p - b), normal) >= 0.0f &&
+           glm::dot(glm::cross(a - c, p - c), normal) >= 0.0f;
+}
+
+// Two unit vectors completing `n` to an orthonormal basis.
+void tangentBasis(const glm::vec3& n, glm::vec3& t1, glm::vec3& t2) {
+    t1 = std::abs(n.x) > 0.57735f ? glm::vec3(n.y, -n.x, 0.0f) : glm::vec3(0.0f, n.z, -n.y);
+    t1 = glm::normalize(t1);
+    t2 = glm::cross(n, t1);
+}
+
+uint64_t pairKey(uint32_t a, uint32_t b) {
+    return (uint64_t(a) << 32) | b;
+}
+
+} // namespace
+
+void Physics::Manifold::add(const ContactPoint& point) {
+    // Both boxes of a face-to-face contact report the same corners; keeping
+    // duplicates would leave the manifold lopsided.
+    for (uint32_t i = 0; i < count; ++i) {
+        const glm::vec3 offset = points[i].position - point.position;
+        if (glm::dot(offset, offset) < kContactMergeDistance * kContactMergeDistance) {
+            if (point.depth > points[i].depth) points[i] = point;
+            return;
+        }
+    }
+    if (count < kMaxManifoldPoints) {
+        points[count++] = point;
+        return;
+    }
+    // Full: keep the deepest points.
+    uint32_t shallowest = 0;
+    for (uint32_t i = 1; i < count; ++i) {
+        if (points[i].depth < points[shallowest].depth) shallowest = i;
+    }
+    if (point.depth > points[shallowest].depth) {
+        points[shallowest] = point;
+    }
+}
+
+Physics::Physics(JobSystem* jobs)
+    : m_jobs(jobs)
+{
+}
+
+Physics::~Physics() = default;
+
+void Physics::forEach(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t, uint32_t)>& fn) {
+    if (m_jobs != nullptr && count > batchSize) {
+        m_jobs->parallelFor(count, batchSize, fn);
+    } else if (count > 0) {
+        fn(0, count);
+    }
+}
+
+BodyId Physics::createBody(const BodyDesc& desc) {
+    BodyId id;
+    if (!m_freeIds.empty()) {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    } else {
+        id = static_cast<BodyId>(m_bodies.size());
+        m_bodies.emplace_back();
+    }
+
+    Body& body = m_bodies[id];
+    body = Body{};
+    body.alive = true;
+    body.collider = desc.collider;
+    body.position = body.previousPosition = desc.position;
+    body.rotation = body.previousRotation = glm::normalize(desc.rotation);
+    body.friction = desc.friction;
+    body.restitution = desc.restitution;
+
+    bool dynamic = desc.type == BodyType::Dynamic && desc.mass > 0.0f;
+    if (dynamic && desc.collider.type == ShapeType::Mesh) {
+        std::cerr << "Physics: triangle mesh colliders are static only" << std::endl;
+        dynamic = false;
+    }
+    if (dynamic) {
+        const float m = desc.mass;
+        glm::vec3 inertia;
+        if (desc.collider.type == ShapeType::Sphere) {
+            inertia = glm::vec3(0.4f * m * desc.collider.radius * desc.collider.radius);
+        } else {
+            const glm::vec3 size = desc.collider.halfExtents * 2.0f;
+            inertia = glm::vec3(size.y * size.y + size.z * size.z,
+                                size.x * size.x + size.z * size.z,
+                                size.x * size.x + size.y * size.y) * (m / 12.0f);
+        }
+        body.inverseMass = 1.0f / m;
+        body.inverseInertiaLocal = 1.0f / inertia;
+        body.linearVelocity = desc.linearVelocity;
+        body.angularVelocity = desc.angularVelocity;
+    }
+
+    updateBody(body);
+    body.proxy = m_tree.insert(body.bounds, id);
+    ++m_bodyCount;
+    return id;
+}
+
+void Physics::destroyBody(BodyId id) {
+    if (!isValid(id)) {
+        return;
+    }
+    m_tree.remove(m_bodies[id].proxy);
+    m_bodies[id] = Body{};
+    m_freeIds.push_back(id);
+    --m_bodyCount;
+}
+
+glm::vec3 Physics::getInterpolatedPosition(BodyId id, float alpha) const {
+    const Body& body = m_bodies[id];
+    return glm::mix(body.previousPosition, body.position, alpha);
+}
+
+glm::quat Physics::getInterpolatedRotation(BodyId id, float alpha) const {
+    const Body& body = m_bodies[id];
+    return glm::slerp(body.previousRotation, body.rotation, alpha);
+}
+
+void Physics::setTransform(BodyId id, const glm::vec3& position, const glm::quat& rotation) {
+    Body& body = m_bodies[id];
+    body.position = body.previousPosition = position;
+    body.rotation = body.previousRotation = glm::normalize(rotation);
+    updateBody(body);
+    m_tree.update(body.proxy, body.bounds);
+}
+
+void Physics::setLinearVelocity(BodyId id, const glm::vec3& velocity) {
+    if (m_bodies[id].isDynamic()) m_bodies[id].linearVelocity = velocity;
+}
+
+void Physics::setAngularVelocity(BodyId id, const glm::vec3& velocity) {
+    if (m_bodies[id].isDynamic()) m_bodies[id].angularVelocity = velocity;
+}
+
+void Physics::applyImpulse(BodyId id, const glm::vec3& impulse, const glm::vec3& worldPoint) {
+    Body& body = m_bodies[id];
+    if (!body.isDynamic()) {
+        return;
+    }
+    body.linearVelocity += impulse * body.inverseMass;
+    body.angularVelocity += body.inverseInertiaWorld * glm::cross(worldPoint - body.position, impulse);
+}
+
+// Refreshes everything derived from the pose: world inertia and bounds.
+void Physics::updateBody(Body& body) {
+    const glm::mat3 r = rotationMatrix(body.rotation);
+    if (body.isDynamic()) {
+        const glm::mat3 scaled(r[0] * body.inverseInertiaLocal.x, r[1] * body.inverseInertiaLocal.y, r[2] * body.inverseInertiaLocal.z);
+        body.inverseInertiaWorld = scaled * glm::transpose(r);
+    }
+
+    switch (body.collider.type) {
+    case ShapeType::Sphere:
+        body.bounds = { body.position - glm::vec3(body.collider.radius), body.position + glm::vec3(body.collider.radius) };
+        break;
+    case ShapeType::Box:
+        body.bounds = boxBounds(body.position, r, body.collider.halfExtents);
+        break;
+    case ShapeType::Mesh: {
+        const Mesh* mesh = body.collider.mesh;
+        if (mesh == nullptr || mesh->getIndices().empty()) {
+            body.bounds = { body.position, body.position };
+            break;
+        }
+        const AABB& local = mesh->getBounds();
+        body.bounds = boxBounds(body.position + r * local.center(), r, local.extents());
+        break;
+    }
+    }
+}
+
+void Physics::step(float dt) {
+    NYANCHU_PROFILE_SCOPE("Physics::step");
+    if (dt <= 0.0f) {
+        return;
+    }
+
+    integrateVelocities(dt);
+
+    // Stage times come from the profiler's clock, which runs even while
+    // trace recording is off.
+    int64_t start = Profiler::now();
+    findPairs();
+    m_stats.broadphaseMs = 1e-6 * double(Profiler::now() - start);
+
+    start = Profiler::now();
+    {
+        NYANCHU_PROFILE_SCOPE("Physics::narrowphase");
+        m_manifolds.resize(m_pairs.size());
+        forEach(static_cast<uint32_t>(m_pairs.size()), 64, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                m_manifolds[i].count = 0;
+                collide(m_pairs[i], m_manifolds[i]);
+            }
+        });
+        buildConstraints(dt);
+    }
+    m_stats.narrowphaseMs = 1e-6 * double(Profiler::now() - start);
+
+    start = Profiler::now();
+    colorConstraints();
+    warmStart();
+    solve();
+    m_stats.solverMs = 1e-6 * double(Profiler::now() - start);
+
+    integratePositions(dt);
+
+    m_stats.bodies = m_bodyCount;
+    m_stats.pairs = static_cast<uint32_t>(m_pairs.size());
+}
+
+void Physics::integrateVelocities(float dt) {
+    NYANCHU_PROFILE_SCOPE("Physics::integrateVelocities");
+    forEach(static_cast<uint32_t>(m_bodies.size()), 1024, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            Body& body = m_bodies[i];
+            body.previousPosition = body.position;
+            body.previousRotation = body.rotation;
+            if (body.alive && body.isDynamic()) {
+                body.linearVelocity += m_gravity * dt;
+            }
+        }
+    });
+}
+
+// Every dynamic body queries the tree with its bounds. A dynamic pair is
+// reported by its lower id only, so each pair comes out once; static
+// bodies never query, since static-static pairs need no contacts.
+void Physics::findPairs() {
+    NYANCHU_PROFILE_SCOPE("Physics::broadphase");
+    constexpr uint32_t batchSize = 256;
+    const uint32_t count = static_cast<uint32_t>(m_bodies.size());
+    m_batchPairs.resize((count + batchSize - 1) / batchSize);
+    forEach(count, batchSize, [&](uint32_t begin, uint32_t end) {
+        std::vector<BodyPair>& pairs = m_batchPairs[begin / batchSize];
+        pairs.clear();
+        for (uint32_t i = begin; i < end; ++i) {
+            const Body& body = m_bodies[i];
+            if (!body.alive || !body.isDynamic()) continue;
+            m_tree.query(body.bounds, [&](int32_t proxy) {
+                const uint32_t j = m_tree.getUserData(proxy);
+                const Body& other = m_bodies[j];
+                if (j == i || (other.isDynamic() && j < i)) return true;
+                // The tree holds fat boxes; only real overlaps become pairs.
+                if (body.bounds.overlaps(other.bounds)) {
+                    pairs.push_back({ std::min(i, j), std::max(i, j) });
+                }
+                return true;
+            });
+        }
+    });
+
+    m_pairs.clear();
+    for (const auto& pairs : m_batchPairs) {
+        m_pairs.insert(m_pairs.end(), pairs.begin(), pairs.end());
+    }
+}
+
+void Physics::collide(const BodyPair& pair, Manifold& manifold) const {
+    const Body* a = &m_bodies[pair.a];
+    const Body* b = &m_bodies[pair.b];
+    // Shape functions expect the lower ShapeType first; flip normals back after.
+    const bool swapped = a->collider.type > b->collider.type;
+    if (swapped) std::swap(a, b);
+
+    auto add = [&](const glm::vec3& position, const glm::vec3& normal, float depth) {
+        manifold.add({ position, swapped ? -normal : normal, depth });
+    };
+
+    const ShapeType typeA = a->collider.type;
+    const ShapeType typeB = b->collider.type;
+
+    if (typeA == ShapeType::Sphere && typeB == ShapeType::Sphere) {
+        const glm::vec3 d = b->position - a->position;
+        const float radii = a->collider.radius + b->collider.radius;
+        const float dist2 = glm::dot(d, d);
+        if (dist2 >= radii * radii) return;
+        const float dist = std::sqrt(dist2);
+        const glm::vec3 n = dist > 1e-6f ? d / dist : glm::vec3(0.0f, 1.0f, 0.0f);
+        const float depth = radii - dist;
+        add(a->position + n * (a->collider.radius - depth * 0.5f), n, depth);
+    } else if (typeA == ShapeType::Sphere && typeB == ShapeType::Box) {
+        const glm::mat3 axes = rotationMatrix(b->rotation);
+        const glm::vec3& h = b->collider.halfExtents;
+        const float r = a->collider.radius;
+        const glm::vec3 local = glm::transpose(axes) * (a->position - b->position);
+        const glm::vec3 closest = glm::clamp(local, -h, h);
+        if (closest == local) {
+            // Center inside the box: push out through the nearest face.
+            int axis = 0;
+            float best = h.x - std::abs(local.x);
+            for (int i = 1; i < 3; ++i) {
+                const float distance = h[i] - std::abs(local[i]);
+                if (distance < best) { best = distance; axis = i; }
+            }
+            const glm::vec3 outward = axes[axis] * (local[axis] >= 0.0f ? 1.0f : -1.0f);
+            add(a->position, -outward, r + best);
+        } else {
+            const glm::vec3 delta = local - closest;
+            const float dist2 = glm::dot(delta, delta);
+            if (dist2 >= r * r) return;
+            const float dist = std::sqrt(dist2);
+            const glm::vec3 outward = axes * (delta / dist);
+            const float depth = r - dist;
+            add(b->position + axes * closest - outward * (depth * 0.5f), -outward, depth);
+        }
+    } else if (typeA == ShapeType::Box && typeB == ShapeType::Box) {
+        const glm::mat3 axesA = rotationMatrix(a->rotation);
+        const glm::mat3 axesB = rotationMatrix(b->rotation);
+        const glm::vec3& hA = a->collider.halfExtents;
+        const glm::vec3& hB = b->collider.halfExtents;
+        const glm::vec3 d = b->position - a->position;
+
+        auto overlapOn = [&](const glm::vec3& axis) {
+            return projectedRadius(axesA, hA, axis) + projectedRadius(axesB, hB, axis) - std::abs(glm::dot(d, axis));
+        };
+
+        // Face normals pick the contact normal; edge-edge axes only reject.
+        float bestOverlap = std::numeric_limits<float>::max();
+        glm::vec3 bestAxis(0.0f, 1.0f, 0.0f);
+        for (int i = 0; i < 6; ++i) {
+            const glm::vec3 axis = i < 3 ? axesA[i] : axesB[i - 3];
+            const float overlap = overlapOn(axis);
+            if (overlap < 0.0f) return;
+            if (overlap < bestOverlap) { bestOverlap = overlap; bestAxis = axis; }
+        }
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                glm::vec3 axis = glm::cross(axesA[i], axesB[j]);
+                const float len2 = glm::dot(axis, axis);
+                if (len2 < 1e-6f) continue;
+                if (overlapOn(axis / std::sqrt(len2)) < 0.0f) return;
+            }
+        }
+        const glm::vec3 n = glm::dot(d, bestAxis) < 0.0f ? -bestAxis : bestAxis;
+
+        // Corners of one box that lie under the facing face of the other and
+        // within it laterally. Together they approximate the clipped contact
+        // polygon for resting and stacked boxes.
+        auto gather = [&](const glm::vec3& center, const glm::mat3& axes, const glm::vec3& h,
+                          const glm::vec3& otherCenter, const glm::mat3& otherAxes, const glm::vec3& otherH, bool cornersOfB) {
+            int faceAxis = 0;
+            for (int i = 1; i < 3; ++i) {
+                if (std::abs(glm::dot(n, otherAxes[i])) > std::abs(glm::dot(n, otherAxes[faceAxis]))) faceAxis = i;
+            }
+            // Outward normal of the face looking at the corners' box.
+            const glm::vec3 towards = cornersOfB ? n : -n;
+            const glm::vec3 face = otherAxes[faceAxis] * (glm::dot(otherAxes[faceAxis], towards) >= 0.0f ? 1.0f : -1.0f);
+
+            glm::vec3 corners[8];
+            boxCorners(center, axes, h, corners);
+            for (const glm::vec3& corner : corners) {
+                const glm::vec3 local = glm::transpose(otherAxes) * (corner - otherCenter);
+                const float depth = otherH[faceAxis] - glm::dot(corner - otherCenter, face);
+                if (depth <= 0.0f || depth > 2.0f * otherH[faceAxis]) continue;
+                bool inside = true;
+                for (int k = 0; k < 3 && inside; ++k) {
+                    inside = k == faceAxis || std::abs(local[k]) <= otherH[k] * 1.01f + 0.005f;
+                }
+                if (inside) {
+                    add(corner + face * (depth * 0.5f), n, depth);
+                }
+            }
+        };
+        gather(b->position, axesB, hB, a->position, axesA, hA, true);
+        gather(a->position, axesA, hA, b->position, axesB, hB, false);
+
+        if (manifold.count == 0) {
+            // Edge-on-edge: one point between the two deepest features.
+            const glm::vec3 pa = supportPoint(a->position, axesA, hA, n);
+            const glm::vec3 pb = supportPoint(b->position, axesB, hB, -n);
+            add((pa + pb) * 0.5f, n, bestOverlap);
+        }
+    } else if (typeB == ShapeType::Mesh && typeA != ShapeType::Mesh) {
+        // Tested in the mesh's space so its BVH can cull the triangles.
+        if (b->collider.mesh == nullptr) return;
+        const TriangleBVH& bvh = b->collider.mesh->getBVH();
+        const glm::mat3 meshAxes = rotationMatrix(b->rotation);
+        const glm::mat3 toLocal = glm::transpose(meshAxes);
+        const glm::vec3 center = toLocal * (a->position - b->position);
+        auto addWorld = [&](const glm::vec3& point, const glm::vec3& normal, float depth) {
+            add(b->position + meshAxes * point, meshAxes * normal, depth);
+        };
+        if (typeA == ShapeType::Sphere) {
+            const float r = a->collider.radius;
+            const AABB bounds{ center - glm::vec3(r), center + glm::vec3(r) };
+            bvh.query(bounds, [&](uint32_t, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) {
+                const glm::vec3 q = closestPointOnTriangle(center, v0, v1, v2);
+                const glm::vec3 delta = center - q;
+                const float dist2 = glm::dot(delta, delta);
+                if (dist2 >= r * r) return true;
+                const float dist = std::sqrt(dist2);
+                glm::vec3 outward;
+                if (dist > 1e-6f) {
+                    outward = delta / dist;
+                } else {
+                    outward = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+                }
+                const float depth = r - dist;
+                addWorld(q - outward * (depth * 0.5f), -outward, depth);
+                return true;
+            });
+        } else {
+            const glm::mat3 axes = toLocal * rotationMatrix(a->rotation);
+            const glm::vec3& h = a->collider.halfExtents;
+            glm::vec3 corners[8];
+            boxCorners(center, axes, h, corners);
+            const float maxDepth = glm::length(h) * 2.0f;
+            bvh.query(boxBounds(center, axes, h), [&](uint32_t, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) {
+                const glm::vec3 cross = glm::cross(v1 - v0, v2 - v0);
+                const float len2 = glm::dot(cross, cross);
+                if (len2 < 1e-12f) return true;
+                const glm::vec3 normal = cross / std::sqrt(len2);
+                for (const glm::vec3& corner : corners) {
+                    const float distance = glm::dot(corner - v0, normal);
+                    if (distance >= 0.0f || distance <= -maxDepth) continue;
+                    const glm::vec3 onPlane = corner - normal * distance;
+                    if (!insideTriangle(onPlane, v0, v1, v2, normal)) continue;
+                    addWorld(corner - normal * (distance * 0.5f), -normal, -distance);
+                }
+                return true;
+            });
+        }
+    }
+}
+
+void Physics::buildConstraints(float dt) {
+    std::vector<uint32_t>& sources = m_contactPairs;
+    sources.clear();
+    uint32_t contacts = 0;
+    for (uint32_t i = 0; i < m_manifolds.size(); ++i) {
+        if (m_manifolds[i].count > 0) {
+            sources.push_back(i);
+            contacts += m_manifolds[i].count;
+        }
+    }
+    m_stats.contacts = contacts;
+
+    std::swap(m_previousConstraints, m_constraints);
+    m_previousLookup.resize(m_previousConstraints.size());
+    for (uint32_t i = 0; i < m_previousConstraints.size(); ++i) {
+        m_previousLookup[i] = { pairKey(m_previousConstraints[i].a, m_previousConstraints[i].b), i };
+    }
+    std::sort(m_previousLookup.begin(), m_previousLookup.end());
+    m_constraints.resize(sources.size());
+
+    const float inverseDt = 1.0f / dt;
+    forEach(static_cast<uint32_t>(sources.size()), 128, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t c = begin; c < end; ++c) {
+            const BodyPair& pair = m_pairs[sources[c]];
+            const Manifold& manifold = m_manifolds[sources[c]];
+            const Body& a = m_bodies[pair.a];
+            const Body& b = m_bodies[pair.b];
+
+            Constraint& constraint = m_constraints[c];
+            constraint.a = pair.a;
+            constraint.b = pair.b;
+            constraint.friction = std::sqrt(a.friction * b.friction);
+            constraint.count = manifold.count;
+            const float restitution = std::max(a.restitution, b.restitution);
+
+            const Constraint* previous = nullptr;
+            const uint64_t key = pairKey(pair.a, pair.b);
+            auto found = std::lower_bound(m_previousLookup.begin(), m_previousLookup.end(), std::make_pair(key, 0u));
+            if (found != m_previousLookup.end() && found->first == key) {
+                previous = &m_previousConstraints[found->second];
+            }
+
+            for (uint32_t p = 0; p < manifold.count; ++p) {
+                const ContactPoint& contact = manifold.points[p];
+                ConstraintPoint& point = constraint.points[p];
+                point.position = contact.position;
+                point.rA = contact.position - a.position;
+                point.rB = contact.position - b.position;
+                point.normal = contact.normal;
+                tangentBasis(point.normal, point.tangent1, point.tangent2);
+
+                auto effectiveMass = [&](const glm::vec3& axis) {
+                    float k = a.inverseMass + b.inverseMass;
+                    if (a.isDynamic()) k += glm::dot(axis, glm::cross(a.inverseInertiaWorld * glm::cross(point.rA, axis), point.rA));
+                    if (b.isDynamic()) k += glm::dot(axis, glm::cross(b.inverseInertiaWorld * glm::cross(point.rB, axis), point.rB));
+                    return k > 0.0f ? 1.0f / k : 0.0f;
+                };
+                point.normalMass = effectiveMass(point.normal);
+                point.tangentMass[0] = effectiveMass(point.tangent1);
+                point.tangentMass[1] = effectiveMass(point.tangent2);
+
+                const glm::vec3 relative = b.linearVelocity + glm::cross(b.angularVelocity, point.rB)
+                                         - a.linearVelocity - glm::cross(a.angularVelocity, point.rA);
+                const float approach = glm::dot(relative, point.normal);
+                point.bias = kBaumgarte * inverseDt * std::max(contact.depth - kLinearSlop, 0.0f);
+                if (approach < -kRestitutionThreshold) {
+                    point.bias = std::max(point.bias, -restitution * approach);
+                }
+                point.normalImpulse = 0.0f;
+                point.tangentImpulse[0] = 0.0f;
+                point.tangentImpulse[1] = 0.0f;
+                if (previous != nullptr) {
+                    float bestDistance2 = kWarmStartDistance * kWarmStartDistance;
+                    for (uint32_t q = 0; q < previous->count; ++q) {
+                        const ConstraintPoint& old = previous->points[q];
+                        const glm::vec3 offset = old.position - point.position;
+                        const float distance2 = glm::dot(offset, offset);
+                        if (distance2 < bestDistance2 && glm::dot(old.normal, point.normal) > 0.95f) {
+                            bestDistance2 = distance2;
+                            point.normalImpulse = old.normalImpulse;
+                            point.tangentImpulse[0] = old.tangentImpulse[0];
+                            point.tangentImpulse[1] = old.tangentImpulse[1];
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+// Greedy coloring: each constraint takes the lowest color not yet used by
+// either of its dynamic bodies. Static bodies are never written by the
+// solver, so they do not constrain the coloring.
+void Physics::colorConstraints() {
+    NYANCHU_PROFILE_SCOPE("Physics::color");
+    for (auto& color : m_colors) color.clear();
+    m_bodyColors.assign(m_bodies.size(), 0);
+
+    for (uint32_t c = 0; c < m_constraints.size(); ++c) {
+        const Constraint& constraint = m_constraints[c];
+        const bool dynamicA = m_bodies[constraint.a].isDynamic();
+        const bool dynamicB = m_bodies[constraint.b].isDynamic();
+        uint64_t used = 0;
+        if (dynamicA) used |= m_bodyColors[constraint.a];
+        if (dynamicB) used |= m_bodyColors[constraint.b];
+
+        const uint32_t color = used == ~uint64_t(0) ? kMaxColors : static_cast<uint32_t>(std::countr_one(used));
+        if (color < kMaxColors) {
+            const uint64_t bit = uint64_t(1) << color;
+            if (dynamicA) m_bodyColors[constraint.a] |= bit;
+            if (dynamicB) m_bodyColors[constraint.b] |= bit;
+        }
+        if (m_colors.size() <= color) m_colors.resize(color + 1);
+        m_colors[color].push_back(c);
+    }
+    while (!m_colors.empty() && m_colors.back().empty()) m_colors.pop_back();
+    m_stats.colors = static_cast<uint32_t>(m_colors.size());
+}
+
+// Applies the impulses carried over from the last step, color by color like
+// the solver itself.
+void Physics::warmStart() {
+    NYANCHU_PROFILE_SCOPE("Physics::warmStart");
+    for (uint32_t color = 0; color < m_colors.size(); ++color) {
+        const std::vector<uint32_t>& batch = m_colors[color];
+        if (color >= kMaxColors) {
+            for (uint32_t c : batch) applyImpulses(m_constraints[c]);
+            continue;
+        }
+        forEach(static_cast<uint32_t>(batch.size()), 64, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) applyImpulses(m_constraints[batch[i]]);
+        });
+    }
+}
+
+void Physics::applyImpulses(Constraint& constraint) {
+    Body& a = m_bodies[constraint.a];
+    Body& b = m_bodies[constraint.b];
+    for (uint32_t p = 0; p < constraint.count; ++p) {
+        const ConstraintPoint& point = constraint.points[p];
+        const glm::vec3 impulse = point.normal * point.normalImpulse
+                                + point.tangent1 * point.tangentImpulse[0]
+                                + point.tangent2 * point.tangentImpulse[1];
+        if (a.isDynamic()) {
+            a.linearVelocity -= impulse * a.inverseMass;
+            a.angularVelocity -= a.inverseInertiaWorld * glm::cross(point.rA, impulse);
+        }
+        if (b.isDynamic()) {
+            b.linearVelocity += impulse * b.inverseMass;
+            b.angularVelocity += b.inverseInertiaWorld * glm::cross(point.rB, impulse);
+        }
+    }
+}
+
+void Physics::solve() {
+    NYANCHU_PROFILE_SCOPE("Physics::solve");
+    for (uint32_t iteration = 0; iteration < m_solverIterations; ++iteration) {
+        for (uint32_t color = 0; color < m_colors.size(); ++color) {
+            const std::vector<uint32_t>& batch = m_colors[color];
+            if (color >= kMaxColors) {
+                // Overflow batch: its constraints may share bodies.
+                for (uint32_t c : batch) solveConstraint(m_constraints[c]);
+                continue;
+            }
+            forEach(static_cast<uint32_t>(batch.size()), 64, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i) solveConstraint(m_constraints[batch[i]]);
+            });
+        }
+    }
+}
+
+void Physics::solveConstraint(Constraint& constraint) {
+    Body& a = m_bodies[constraint.a];
+    Body& b = m_bodies[constraint.b];
+    glm::vec3 vA = a.linearVelocity, wA = a.angularVelocity;
+    glm::vec3 vB = b.linearVelocity, wB = b.angularVelocity;
+
+    auto apply = [&](const ConstraintPoint& point, const glm::vec3& impulse) {
+        vA -= impulse * a.inverseMass;
+        vB += impulse * b.inverseMass;
+        if (a.isDynamic()) wA -= a.inverseInertiaWorld * glm::cross(point.rA, impulse);
+        if (b.isDynamic()) wB += b.inverseInertiaWorld * glm::cross(point.rB, impulse);
+    };
+    auto relativeVelocity = [&](const ConstraintPoint& point) {
+        return vB + glm::cross(wB, point.rB) - vA - glm::cross(wA, point.rA);
+    };
+
+    for (uint32_t p = 0; p < constraint.count; ++p) {
+        ConstraintPoint& point = constraint.points[p];
+
+        // Friction first, bounded by last iteration's normal impulse.
+        const float maxFriction = constraint.friction * point.normalImpulse;
+        const glm::vec3 tangents[2] = { point.tangent1, point.tangent2 };
+        for (int t = 0; t < 2; ++t) {
+            const float vt = glm::dot(relativeVelocity(point), tangents[t]);
+            const float old = point.tangentImpulse[t];
+            point.tangentImpulse[t] = std::clamp(old - point.tangentMass[t] * vt, -maxFriction, maxFriction);
+            apply(point, tangents[t] * (point.tangentImpulse[t] - old));
+        }
+
+        const float vn = glm::dot(relativeVelocity(point), point.normal);
+        const float old = point.normalImpulse;
+        point.normalImpulse = std::max(old + point.normalMass * (point.bias - vn), 0.0f);
+        apply(point, point.normal * (point.normalImpulse - old));
+    }
+
+    // Static bodies are shared by constraints of the same color; never write them.
+    if (a.isDynamic()) { a.linearVelocity = vA; a.angularVelocity = wA; }
+    if (b.isDynamic()) { b.linearVelocity = vB; b.angularVelocity = wB; }
+}
+
+void Physics::integratePositions(float dt) {
+    NYANCHU_PROFILE_SCOPE("Physics::integratePositions");
+    forEach(static_cast<uint32_t>(m_bodies.size()), 1024, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            Body& body = m_bodies[i];
+            if (!body.alive || !body.isDynamic()) continue;
+            body.position += body.linearVelocity * dt;
+            const glm::vec3& w = body.angularVelocity;
+            const glm::quat spin(0.0f, w.x, w.y, w.z);
+            body.rotation = glm::normalize(body.rotation + (spin * body.rotation) * (0.5f * dt));
+            updateBody(body);
+        }
+    });
+
+    // Tree updates are serial, but most bodies stay inside their fat box and
+    // return right away.
+    uint32_t reinserted = 0;
+    for (Body& body : m_bodies) {
+        if (body.alive && body.isDynamic() &&
+            m_tree.update(body.proxy, body.bounds, body.position - body.previousPosition)) {
+            ++reinserted;
+        }
+    }
+    m_stats.reinserted = reinserted;
+    m_stats.treeHeight = static_cast<uint32_t>(m_tree.getHeight());
+}
+
+bool Physics::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) const {
+    const float length = glm::length(direction);
+    if (length <= 0.0f || maxDistance <= 0.0f) {
+        return false;
+    }
+    const Ray ray{ origin, direction / length };
+    bool found = false;
+    m_tree.raycast(ray, maxDistance, [&](int32_t proxy, float distance) {
+        const BodyId id = m_tree.getUserData(proxy);
+        RayHit candidate;
+        if (!raycastBody(m_bodies[id], ray, distance, candidate)) {
+            return distance;
+        }
+        candidate.body = id;
+        hit = candidate;
+        found = true;
+        return candidate.distance;
+    });
+    return found;
+}
+
+bool Physics::raycastBody(const Body& body, const Ray& ray, float maxDistance, RayHit& hit) const {
+    switch (body.collider.type) {
+    case ShapeType::Sphere: {
+        const glm::vec3 m = ray.origin - body.position;
+        const float r = body.collider.radius;
+        const float b = glm::dot(m, ray.direction);
+        const float c = glm::dot(m, m) - r * r;
+        if (c > 0.0f && b > 0.0f) return false;
+        const float discriminant = b * b - c;
+        if (discriminant < 0.0f) return false;
+        hit.distance = std::max(-b - std::sqrt(discriminant), 0.0f);
+        if (hit.distance > maxDistance) return false;
+        hit.point = ray.origin + ray.direction * hit.distance;
+        hit.normal = c > 0.0f ? (hit.point - body.position) / r : -ray.direction;
+        return true;
+    }
+    case ShapeType::Box: {
+        // Slab test in the box's frame, remembering which face was entered.
+        const glm::mat3 axes = rotationMatrix(body.rotation);
+        const glm::mat3 toLocal = glm::transpose(axes);
+        const glm::vec3 origin = toLocal * (ray.origin - body.position);
+        const glm::vec3 direction = toLocal * ray.direction;
+        const glm::vec3& h = body.collider.halfExtents;
+        float enter = 0.0f;
+        float exit = maxDistance;
+        int face = -1;
+        for (int i = 0; i < 3; ++i) {
+            if (std::abs(direction[i]) < 1e-8f) {
+                if (std::abs(origin[i]) > h[i]) return false;
+                continue;
+            }
+            const float inverse = 1.0f / direction[i];
+            float t0 = (-h[i] - origin[i]) * inverse;
+            float t1 = (h[i] - origin[i]) * inverse;
+            if (t0 > t1) std::swap(t0, t1);
+            if (t0 > enter) { enter = t0; face = i; }
+            exit = std::min(exit, t1);
+            if (enter > exit) return false;
+        }
+        hit.distance = enter;
+        hit.point = ray.origin + ray.direction * enter;
+        hit.normal = face < 0 ? -ray.direction : axes[face] * (direction[face] > 0.0f ? -1.0f : 1.0f);
+        return true;
+    }
+    case ShapeType::Mesh: {
+        if (body.collider.mesh == nullptr) return false;
+        const glm::quat toLocal = glm::conjugate(body.rotation);
+        const Ray local{ toLocal * (ray.origin - body.position), toLocal * ray.direction };
+        MeshHit meshHit;
+        if (!body.collider.mesh->raycast(local, maxDistance, meshHit)) return false;
+        hit.distance = meshHit.distance;
+        hit.point = ray.origin + ray.direction * meshHit.distance;
+        hit.normal = body.rotation * meshHit.normal;
+        return true;
+    }
+    }
+    return false;
+}
+
+void Physics::queryAABB(const AABB& bounds, std::vector<BodyId>& results) const {
+    m_tree.query(bounds, [&](int32_t proxy) {
+        const BodyId id = m_tree.getUserData(proxy);
+        if (m_bodies[id].bounds.overlaps(bounds)) {
+            results.push_back(id);
+        }
+        return true;
+    });
+}
+
+void Physics::querySphere(const glm::vec3& center, float radius, std::vector<BodyId>& results) const {
+    const AABB bounds{ center - glm::vec3(radius), center + glm::vec3(radius) };
+    const float radius2 = radius * radius;
+    m_tree.query(bounds, [&](int32_t proxy) {
+        const BodyId id = m_tree.getUserData(proxy);
+        const Body& body = m_bodies[id];
+        if (!body.bounds.overlaps(bounds)) return true;
+
+        bool touches = false;
+        switch (body.collider.type) {
+        case ShapeType::Sphere: {
+            const float reach = radius + body.collider.radius;
+            const glm::vec3 d = body.position - center;
+            touches = glm::dot(d, d) <= reach * reach;
+            break;
+        }
+        case ShapeType::Box: {
+            const glm::mat3 axes = rotationMatrix(body.rotation);
+            const glm::vec3 local = glm::transpose(axes) * (center - body.position);
+            const glm::vec3 d = local - glm::clamp(local, -body.collider.halfExtents, body.collider.halfExtents);
+            touches = glm::dot(d, d) <= radius2;
+            break;
+        }
+        case ShapeType::Mesh: {
+            if (body.collider.mesh == nullptr) break;
+            const glm::vec3 local = glm::conjugate(body.rotation) * (center - body.position);
+            const AABB localBounds{ local - glm::vec3(radius), local + glm::vec3(radius) };
+            body.collider.mesh->getBVH().query(localBounds, [&](uint32_t, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) {
+                const glm::vec3 d = local - closestPointOnTriangle(local, v0, v1, v2);
+                touches = glm::dot(d, d) <= radius2;
+                return !touches;
+            });
+            break;
+        }
+        }
+        if (touches) {
+            results.push_back(id);
+        }
+        return true;
+    });
+}
+
+void Physics::attach(ECS& ecs, const FixedTimestep& timestep) {
+    flecs::world& world = ecs.getWorld();
+    world.component<RigidBody>("nyanchu::RigidBody")
+        .on_remove([this](RigidBody& body) { destroyBody(body.id); });
+
+    const FixedTimestep* clock = &timestep;
+    ecs.system<const RigidBody, Transform>("nyanchu::SyncRigidBodies", flecs::PreUpdate, SystemExecution::Parallel)
+        .each([this, clock](const RigidBody& body, Transform& transform) {
+            if (!isValid(body.id)) return;
+            const float alpha = clock->getAlpha();
+            transform.position = getInterpolatedPosition(body.id, alpha);
+            transform.rotation = getInterpolatedRotation(body.id, alpha);
+        });
+}
+
+} // namespace nyanchu
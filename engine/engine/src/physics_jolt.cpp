@@ -1 +0,0 @@
-// Placeholder for Jolt physics implementation
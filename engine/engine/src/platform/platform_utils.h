@@ -1,7 +1,13 @@
 #pragma once
 
 #include <GLFW/glfw3.h>
+#include <cstddef>
 #include <string>
 
 void* getNativeWindowHandle(GLFWwindow* window);
 std::string getExecutableDir();
+
+// Maps a whole file read-only. Returns nullptr on failure; otherwise the
+// mapping stays valid until unmapFile is called with the same size/handle.
+const void* mapFileReadOnly(const std::string& path, size_t* outSize, void** outHandle);
+void unmapFile(const void* data, size_t size, void* handle);
@@ -3,6 +3,50 @@
 #define GLFW_EXPOSE_NATIVE_X11
 #include <GLFW/glfw3native.h>
 
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 void* getNativeWindowHandle(GLFWwindow* window) {
     return (void*)glfwGetX11Window(window);
 }
+
+std::string getExecutableDir() {
+    char path[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length <= 0) {
+        return "";
+    }
+    std::string path_str(path, static_cast<size_t>(length));
+    return path_str.substr(0, path_str.find_last_of("/"));
+}
+
+const void* mapFileReadOnly(const std::string& path, size_t* outSize, void** outHandle) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    *outSize = static_cast<size_t>(st.st_size);
+    *outHandle = nullptr;
+    return data;
+}
+
+void unmapFile(const void* data, size_t size, void* handle) {
+    (void)handle;
+    if (data) {
+        munmap(const_cast<void*>(data), size);
+    }
+}
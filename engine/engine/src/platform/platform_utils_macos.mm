@@ -11,6 +11,10 @@ extern "C" {
 
 #include <mach-o/dyld.h>
 #include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // Function to get the Metal layer from a GLFW window
 void* getNativeWindowHandle(GLFWwindow* window) {
@@ -33,3 +37,31 @@ std::string getExecutableDir() {
         return ""; // Should not happen
     }
 }
+
+const void* mapFileReadOnly(const std::string& path, size_t* outSize, void** outHandle) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    *outSize = static_cast<size_t>(st.st_size);
+    *outHandle = nullptr;
+    return data;
+}
+
+void unmapFile(const void* data, size_t size, void* handle) {
+    (void)handle;
+    if (data) {
+        munmap(const_cast<void*>(data), size);
+    }
+}
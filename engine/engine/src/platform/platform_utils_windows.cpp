@@ -3,6 +3,54 @@
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
 
+#include <windows.h>
+
 void* getNativeWindowHandle(GLFWwindow* window) {
     return (void*)glfwGetWin32Window(window);
 }
+
+std::string getExecutableDir() {
+    char path[MAX_PATH];
+    DWORD length = GetModuleFileNameA(NULL, path, MAX_PATH);
+    if (length == 0) {
+        return "";
+    }
+    std::string path_str(path, length);
+    return path_str.substr(0, path_str.find_last_of("\\/"));
+}
+
+const void* mapFileReadOnly(const std::string& path, size_t* outSize, void** outHandle) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return nullptr;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    // The mapping object keeps its own reference to the file.
+    CloseHandle(file);
+    if (!mapping) {
+        return nullptr;
+    }
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        return nullptr;
+    }
+    *outSize = static_cast<size_t>(size.QuadPart);
+    *outHandle = mapping;
+    return data;
+}
+
+void unmapFile(const void* data, size_t size, void* handle) {
+    (void)size;
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (handle) {
+        CloseHandle(static_cast<HANDLE>(handle));
+    }
+}
@@ -0,0 +1,135 @@
+#include "nyanchu/profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nyanchu {
+
+namespace {
+
+struct ProfileEvent {
+    const char* name;
+    int64_t startNs;
+    int64_t endNs;
+};
+
+// Written only by its owning thread. Buffers are kept after the thread exits
+// so its events still show up in the trace.
+struct ThreadBuffer {
+    uint32_t tid = 0;
+    std::string name;
+    std::unique_ptr<ProfileEvent[]> events{ new ProfileEvent[Profiler::kEventsPerThread] };
+    std::atomic<uint64_t> head{ 0 };
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+std::atomic<bool> g_enabled{ true };
+thread_local ThreadBuffer* t_buffer = nullptr;
+thread_local std::string t_name; // applied when the buffer is created
+
+// Buffers are created on first record, so naming idle threads costs nothing.
+ThreadBuffer& threadBuffer() {
+    if (!t_buffer) {
+        auto buffer = std::make_shared<ThreadBuffer>();
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        buffer->tid = static_cast<uint32_t>(reg.buffers.size());
+        buffer->name = t_name.empty() ? "Thread " + std::to_string(buffer->tid) : t_name;
+        reg.buffers.push_back(buffer);
+        t_buffer = buffer.get();
+    }
+    return *t_buffer;
+}
+
+void writeJsonString(std::FILE* file, const char* text) {
+    std::fputc('"', file);
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            std::fputc('\\', file);
+            std::fputc(*c, file);
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            std::fprintf(file, "\\u%04x", *c);
+        } else {
+            std::fputc(*c, file);
+        }
+    }
+    std::fputc('"', file);
+}
+
+} // namespace
+
+void Profiler::setEnabled(bool enabled) {
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::isEnabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(const std::string& name) {
+    t_name = name;
+    if (t_buffer) {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        t_buffer->name = name;
+    }
+}
+
+int64_t Profiler::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry().epoch).count();
+}
+
+void Profiler::record(const char* name, int64_t startNs, int64_t endNs) {
+    ThreadBuffer& buffer = threadBuffer();
+    const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head & (kEventsPerThread - 1)] = { name, startNs, endNs };
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    bool first = true;
+    for (const auto& buffer : reg.buffers) {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":",
+                     first ? "" : ",\n", buffer->tid);
+        writeJsonString(file, buffer->name.c_str());
+        std::fputs("}}", file);
+        first = false;
+
+        const uint64_t head = buffer->head.load(std::memory_order_acquire);
+        const uint64_t count = std::min<uint64_t>(head, kEventsPerThread);
+        for (uint64_t i = head - count; i < head; ++i) {
+            const ProfileEvent& event = buffer->events[i & (kEventsPerThread - 1)];
+            std::fputs(",\n{\"name\":", file);
+            writeJsonString(file, event.name);
+            std::fprintf(file, ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                         buffer->tid, event.startNs / 1000.0, (event.endNs - event.startNs) / 1000.0);
+        }
+    }
+    std::fputs("\n]}\n", file);
+    return std::fclose(file) == 0;
+}
+
+} // namespace nyanchu
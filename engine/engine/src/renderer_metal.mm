@@ -1,5 +1,6 @@
 #include "nyanchu/renderer_metal.h"
 #include "nyanchu/camera.h"
+#include "nyanchu/frustum.h"
 #include "platform/platform_utils.h"
 #include <iostream>
 #include <unordered_map>
@@ -27,6 +28,7 @@ struct Uniforms {
 struct MeshBuffers {
     id<MTLBuffer> vertexBuffer;
     id<MTLBuffer> indexBuffer;
+    AABB bounds; // object space
 };
 
 class RendererMetalImpl {
@@ -46,11 +48,11 @@ public:
 
     // Pipeline states
     id<MTLRenderPipelineState> _meshPipelineState;
+    id<MTLRenderPipelineState> _meshInstancedPipelineState;
     id<MTLDepthStencilState> _depthState;
 
     // Buffers
-    id<MTLBuffer> _uniformBuffer;
-    std::unordered_map<const Mesh*, MeshBuffers> _meshBuffers;
+    std::unordered_map<uint64_t, MeshBuffers> _meshBuffers; // by Mesh::getId()
     
     // Cube-specific buffers
     id<MTLBuffer> _cubeVertexBuffer;
@@ -59,6 +61,14 @@ public:
     
     // Per-frame camera state
     glm::mat4 _viewMatrix;
+    glm::mat4 _projMatrix;
+    Frustum _frustum;
+    RenderStats _stats;
+
+    // Scratch for culling instanced draws
+    std::vector<AABB> _instanceBounds;
+    std::vector<uint8_t> _instanceVisible;
+    std::vector<glm::mat4> _visibleInstances;
 
 
     RendererMetalImpl(GLFWwindow* window, uint32_t width, uint32_t height) : _width(width), _height(height) {
@@ -83,8 +93,6 @@ public:
         setupMeshPipeline();
         setupDepthBuffer();
         setupCubeBuffers();
-
-        _uniformBuffer = [_device newBufferWithLength:sizeof(Uniforms) options:MTLResourceStorageModeShared];
     }
     
     void setupCubeBuffers() {
@@ -133,6 +141,14 @@ public:
                 out.position = uniforms.mvp * float4(in.position, 1.0);
                 return out;
             }
+            vertex VertexOut vertex_instanced(const VertexIn in [[stage_in]],
+                                              constant Uniforms &uniforms [[buffer(1)]],
+                                              const device float4x4 *models [[buffer(2)]],
+                                              uint iid [[instance_id]]) {
+                VertexOut out;
+                out.position = uniforms.mvp * (models[iid] * float4(in.position, 1.0));
+                return out;
+            }
             fragment float4 fragment_main() { return float4(0.8, 0.8, 0.8, 1.0); }
         )";
 
@@ -155,6 +171,9 @@ public:
         pipelineDescriptor.vertexDescriptor = vertexDescriptor;
 
         _meshPipelineState = [_device newRenderPipelineStateWithDescriptor:pipelineDescriptor error:&error];
+
+        pipelineDescriptor.vertexFunction = [library newFunctionWithName:@"vertex_instanced"];
+        _meshInstancedPipelineState = [_device newRenderPipelineStateWithDescriptor:pipelineDescriptor error:&error];
     }
 
     void setupDepthBuffer() {
@@ -176,7 +195,11 @@ public:
     ~RendererMetalImpl() {}
 
     void beginFrame(const Camera& camera) {
+        // Metal clip space depth is [0, 1].
         _viewMatrix = camera.getViewMatrix();
+        _projMatrix = camera.getProjectionMatrix(false);
+        _frustum = Frustum(_projMatrix * _viewMatrix, false);
+        _stats = {};
         
         _pool = [[NSAutoreleasePool alloc] init];
         _drawable = [_metalLayer nextDrawable];
@@ -215,36 +238,57 @@ public:
         setupDepthBuffer();
     }
 
-    void updateUniforms(const glm::mat4& model) {
-        if (_width == 0 || _height == 0) return;
-        float aspect = (float)_width / (float)_height;
-        glm::mat4 proj = glm::perspective(glm::radians(60.0f), aspect, 0.1f, 100.0f);
+    bool cull(const AABB& bounds, const glm::mat4& modelMatrix) {
+        if (_frustum.intersects(bounds.transformed(modelMatrix))) {
+            ++_stats.visible;
+            return false;
+        }
+        ++_stats.culled;
+        return true;
+    }
 
+    // Uniforms go through setVertexBytes so every draw keeps its own copy;
+    // writing into one shared MTLBuffer would leave all draws of the frame
+    // with the last matrix.
+    void setUniforms(const glm::mat4& model) {
         Uniforms uniforms;
-        uniforms.mvp = proj * _viewMatrix * model;
-        memcpy([_uniformBuffer contents], &uniforms, sizeof(uniforms));
+        uniforms.mvp = _projMatrix * _viewMatrix * model;
+        [_commandEncoder setVertexBytes:&uniforms length:sizeof(uniforms) atIndex:1];
     }
 
-    void drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix) {
-        if (!_commandEncoder) return;
+    const MeshBuffers& getMeshBuffers(const Mesh& mesh) {
+        auto it = _meshBuffers.find(mesh.getId());
+        if (it != _meshBuffers.end()) {
+            return it->second;
+        }
 
-        if (_meshBuffers.find(&mesh) == _meshBuffers.end()) {
-            const auto& vertices = mesh.getVertices();
-            const auto& indices = mesh.getIndices();
+        const auto vertices = mesh.getVertices();
+        const auto indices = mesh.getIndices();
 
-            MeshBuffers buffers;
-            buffers.vertexBuffer = [_device newBufferWithBytes:vertices.data() length:vertices.size() * sizeof(Vertex) options:MTLResourceStorageModeShared];
-            buffers.indexBuffer = [_device newBufferWithBytes:indices.data() length:indices.size() * sizeof(uint32_t) options:MTLResourceStorageModeShared];
-            _meshBuffers[&mesh] = buffers;
-        }
+        MeshBuffers buffers;
+        buffers.bounds = mesh.getBounds();
+        buffers.vertexBuffer = [_device newBufferWithBytes:vertices.data() length:vertices.size_bytes() options:MTLResourceStorageModeShared];
+        buffers.indexBuffer = [_device newBufferWithBytes:indices.data() length:indices.size_bytes() options:MTLResourceStorageModeShared];
+        return _meshBuffers.emplace(mesh.getId(), buffers).first->second;
+    }
+
+    void releaseMesh(const Mesh& mesh) {
+        auto it = _meshBuffers.find(mesh.getId());
+        if (it == _meshBuffers.end()) return;
+        [it->second.vertexBuffer release];
+        [it->second.indexBuffer release];
+        _meshBuffers.erase(it);
+    }
 
-        const auto& buffers = _meshBuffers.at(&mesh);
+    void drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix) {
+        if (!_commandEncoder || _width == 0 || _height == 0) return;
 
-        updateUniforms(modelMatrix);
+        const auto& buffers = getMeshBuffers(mesh);
+        if (cull(buffers.bounds, modelMatrix)) return;
 
         [_commandEncoder setRenderPipelineState:_meshPipelineState];
         [_commandEncoder setVertexBuffer:buffers.vertexBuffer offset:0 atIndex:0];
-        [_commandEncoder setVertexBuffer:_uniformBuffer offset:0 atIndex:1];
+        setUniforms(modelMatrix);
         [_commandEncoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle
                                       indexCount:mesh.getIndices().size()
                                        indexType:MTLIndexTypeUInt32
@@ -252,14 +296,58 @@ public:
                                indexBufferOffset:0];
     }
 
-    void drawCube(const glm::mat4& modelMatrix) {
-        if (!_commandEncoder) return;
+    void drawMeshInstanced(const Mesh& mesh, std::span<const glm::mat4> modelMatrices) {
+        if (!_commandEncoder || _width == 0 || _height == 0 || modelMatrices.empty()) return;
+
+        const auto& buffers = getMeshBuffers(mesh);
 
-        updateUniforms(modelMatrix);
+        const size_t count = modelMatrices.size();
+        _instanceBounds.resize(count);
+        _instanceVisible.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            _instanceBounds[i] = buffers.bounds.transformed(modelMatrices[i]);
+        }
+        const uint32_t visibleCount = _frustum.cull(_instanceBounds, _instanceVisible);
+        _stats.visible += visibleCount;
+        _stats.culled += static_cast<uint32_t>(count) - visibleCount;
+        if (visibleCount == 0) return;
+
+        _visibleInstances.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (_instanceVisible[i]) _visibleInstances.push_back(modelMatrices[i]);
+        }
+        const std::span<const glm::mat4> visible = _visibleInstances;
+
+        [_commandEncoder setRenderPipelineState:_meshInstancedPipelineState];
+        [_commandEncoder setVertexBuffer:buffers.vertexBuffer offset:0 atIndex:0];
+        setUniforms(glm::mat4(1.0f));
+
+        // setVertexBytes is limited to 4KB; larger batches get a buffer for this frame.
+        if (visible.size_bytes() <= 4096) {
+            [_commandEncoder setVertexBytes:visible.data() length:visible.size_bytes() atIndex:2];
+        } else {
+            id<MTLBuffer> instanceBuffer = [_device newBufferWithBytes:visible.data()
+                                                                length:visible.size_bytes()
+                                                               options:MTLResourceStorageModeShared];
+            [_commandEncoder setVertexBuffer:instanceBuffer offset:0 atIndex:2];
+            [instanceBuffer release]; // the encoder keeps it alive for the frame
+        }
+
+        [_commandEncoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle
+                                      indexCount:mesh.getIndices().size()
+                                       indexType:MTLIndexTypeUInt32
+                                     indexBuffer:buffers.indexBuffer
+                               indexBufferOffset:0
+                                   instanceCount:visible.size()];
+    }
+
+    void drawCube(const glm::mat4& modelMatrix) {
+        if (!_commandEncoder || _width == 0 || _height == 0) return;
+        if (cull({ glm::vec3(-0.5f), glm::vec3(0.5f) }, modelMatrix)) return;
 
         [_commandEncoder setRenderPipelineState:_meshPipelineState];
         [_commandEncoder setVertexBuffer:_cubeVertexBuffer offset:0 atIndex:0];
-        [_commandEncoder setVertexBuffer:_uniformBuffer offset:0 atIndex:1];
+        setUniforms(modelMatrix);
         [_commandEncoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle
                                       indexCount:_cubeIndexCount
                                        indexType:MTLIndexTypeUInt32
@@ -283,7 +371,14 @@ void RendererMetal::shutdown() {
 void RendererMetal::beginFrame(const Camera& camera) { if (_impl) _impl->beginFrame(camera); }
 void RendererMetal::endFrame() { if (_impl) _impl->endFrame(); }
 void RendererMetal::resize(uint32_t width, uint32_t height) { if (_impl) _impl->resize(width, height); }
+void RendererMetal::uploadMesh(const Mesh& mesh) { if (_impl) _impl->getMeshBuffers(mesh); }
+void RendererMetal::releaseMesh(const Mesh& mesh) { if (_impl) _impl->releaseMesh(mesh); }
 void RendererMetal::drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix) { if (_impl) _impl->drawMesh(mesh, modelMatrix); }
+void RendererMetal::drawMeshInstanced(const Mesh& mesh, std::span<const glm::mat4> modelMatrices) { if (_impl) _impl->drawMeshInstanced(mesh, modelMatrices); }
+const RenderStats& RendererMetal::getStats() const {
+    static const RenderStats empty;
+    return _impl ? _impl->_stats : empty;
+}
 void RendererMetal::drawTriangle() { /* Not implemented */ }
 void RendererMetal::drawCube(const glm::mat4& modelMatrix) { if (_impl) _impl->drawCube(modelMatrix); }
 
@@ -1,10 +1,18 @@
 #include "nyanchu/renderer_opengl.h"
+#include "nyanchu/camera.h"
+#include "nyanchu/job_system.h"
+#include "nyanchu/profiler.h"
 #include "platform/platform_utils.h"
 #include <bx/math.h>
 
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <cstdio>
+#include <cstring>
 
 namespace nyanchu {
 
@@ -23,6 +31,14 @@ static PosColorVertex s_triangleVertices[] =
 
 static bgfx::VertexLayout s_vertexLayout;
 
+// Meshes are drawn in a perspective scene view; the pixel-space triangle
+// demo gets its own orthographic view on top.
+static constexpr bgfx::ViewId kSceneView = 0;
+static constexpr bgfx::ViewId kOverlayView = 1;
+
+// Encoders bgfx keeps for threaded recording; one is reserved for the API thread.
+static constexpr uint16_t kMaxEncoders = 16;
+
 // Helper function to load shader binaries
 const bgfx::Memory* RendererBGFX::loadShader(const char* _name)
 {
@@ -59,9 +75,29 @@ const bgfx::Memory* RendererBGFX::loadShader(const char* _name)
     return mem;
 }
 
+bgfx::ProgramHandle RendererBGFX::loadProgram(const char* vsName, const char* fsName)
+{
+    const bgfx::Memory* vsMem = loadShader(vsName);
+    const bgfx::Memory* fsMem = loadShader(fsName);
+
+    // createShader takes ownership of the memory, so consume whatever loaded.
+    bgfx::ShaderHandle vsh = BGFX_INVALID_HANDLE;
+    bgfx::ShaderHandle fsh = BGFX_INVALID_HANDLE;
+    if (vsMem != NULL) vsh = bgfx::createShader(vsMem);
+    if (fsMem != NULL) fsh = bgfx::createShader(fsMem);
+    if (!bgfx::isValid(vsh) || !bgfx::isValid(fsh)) {
+        if (bgfx::isValid(vsh)) bgfx::destroy(vsh);
+        if (bgfx::isValid(fsh)) bgfx::destroy(fsh);
+        return BGFX_INVALID_HANDLE;
+    }
+    return bgfx::createProgram(vsh, fsh, true);
+}
+
 RendererBGFX::RendererBGFX()
     : m_vbh(BGFX_INVALID_HANDLE)
     , m_program(BGFX_INVALID_HANDLE)
+    , m_meshProgram(BGFX_INVALID_HANDLE)
+    , m_meshInstancedProgram(BGFX_INVALID_HANDLE)
 {
 }
 
@@ -71,21 +107,32 @@ RendererBGFX::~RendererBGFX()
 
 bool RendererBGFX::initialize(GLFWwindow* window, uint32_t width, uint32_t height)
 {
+    m_headless = (window == nullptr);
+    m_width = width;
+    m_height = height;
+
     bgfx::PlatformData pd;
-    pd.nwh = getNativeWindowHandle(window);
+    pd.nwh = m_headless ? nullptr : getNativeWindowHandle(window);
 
     bgfx::Init bgfxInit;
-    bgfxInit.type = bgfx::RendererType::Count;
+    bgfxInit.type = m_headless ? bgfx::RendererType::Noop : bgfx::RendererType::Count;
     bgfxInit.resolution.width = width;
     bgfxInit.resolution.height = height;
     bgfxInit.resolution.reset = BGFX_RESET_VSYNC;
     bgfxInit.platformData = pd;
+    bgfxInit.limits.maxEncoders = kMaxEncoders;
+
+    // Rendering before init keeps bgfx on this thread instead of it starting a
+    // render thread of its own; ThreadedRenderer provides that thread.
+    bgfx::renderFrame();
 
     if (!bgfx::init(bgfxInit))
     {
         std::cerr << "Failed to initialize BGFX" << std::endl;
         return false;
     }
+    m_maxThreadEncoders = std::max<uint32_t>(1, bgfx::getCaps()->limits.maxEncoders - 1);
+    m_sliceScratch.resize(m_maxThreadEncoders);
 
     // Initialize vertex layout
     s_vertexLayout
@@ -94,39 +141,51 @@ bool RendererBGFX::initialize(GLFWwindow* window, uint32_t width, uint32_t heigh
         .add(bgfx::Attrib::Color0, 4, bgfx::AttribType::Uint8, true)
         .end();
 
+    // Matches nyanchu::Vertex: position, normal, texcoord.
+    m_meshLayout
+        .begin()
+        .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
+        .add(bgfx::Attrib::Normal, 3, bgfx::AttribType::Float)
+        .add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float)
+        .end();
+    if (m_meshLayout.getStride() != sizeof(Vertex)) {
+        std::cerr << "Mesh vertex layout does not match nyanchu::Vertex" << std::endl;
+        return false;
+    }
+
     // Create vertex buffer
     m_vbh = bgfx::createVertexBuffer(
         bgfx::makeRef(s_triangleVertices, sizeof(s_triangleVertices)),
         s_vertexLayout
     );
 
-    // Load shaders and create program
-    bgfx::ShaderHandle vsh = bgfx::createShader(loadShader("vs_triangle.bin"));
-    bgfx::ShaderHandle fsh = bgfx::createShader(loadShader("fs_triangle.bin"));
-    if (!bgfx::isValid(vsh) || !bgfx::isValid(fsh)) {
-        std::cerr << "Failed to load shaders" << std::endl;
-        return false;
+    // The Noop backend never executes shaders, and submitting with an
+    // invalid program is allowed, so headless runs skip shader loading.
+    if (!m_headless) {
+        m_program = loadProgram("vs_triangle.bin", "fs_triangle.bin");
+        m_meshProgram = loadProgram("vs_mesh.bin", "fs_mesh.bin");
+        m_meshInstancedProgram = loadProgram("vs_mesh_instanced.bin", "fs_mesh.bin");
+        if (!bgfx::isValid(m_program) || !bgfx::isValid(m_meshProgram) || !bgfx::isValid(m_meshInstancedProgram)) {
+            std::cerr << "Failed to load shaders" << std::endl;
+            return false;
+        }
     }
-    m_program = bgfx::createProgram(vsh, fsh, true);
 
-    bgfx::setViewClear(0, BGFX_CLEAR_COLOR | BGFX_CLEAR_DEPTH, 0x303030ff, 1.0f, 0);
-
-    float orthoProjection[16];
-    bx::mtxOrtho(orthoProjection, 0.0f, (float)width, (float)height, 0.0f, 0.0f, 100.0f, 0.0f, bgfx::getCaps()->homogeneousDepth);
-    bgfx::setViewTransform(0, nullptr, orthoProjection);
-    bgfx::setViewRect(0, 0, 0, (uint16_t)width, (uint16_t)height);
+    bgfx::setViewClear(kSceneView, BGFX_CLEAR_COLOR | BGFX_CLEAR_DEPTH, 0x303030ff, 1.0f, 0);
+    resize(width, height);
 
     return true;
 }
 
 void RendererBGFX::render()
 {
+    NYANCHU_PROFILE_SCOPE("bgfx::frame");
     bgfx::frame();
 }
 
 void RendererBGFX::drawTriangle()
 {
-    bgfx::touch(0);
+    bgfx::touch(kOverlayView);
 
     // Set vertex buffer
     bgfx::setVertexBuffer(0, m_vbh);
@@ -134,22 +193,249 @@ void RendererBGFX::drawTriangle()
     // Set render states.
     bgfx::setState(BGFX_STATE_DEFAULT);
 
-    // Submit primitive for rendering to view 0.
-    bgfx::submit(0, m_program);
+    // Submit primitive for rendering to the overlay view.
+    bgfx::submit(kOverlayView, m_program);
 }
 
 void RendererBGFX::shutdown()
 {
+    for (auto& [meshId, buffers] : m_meshBuffers) {
+        if (bgfx::isValid(buffers.vbh)) bgfx::destroy(buffers.vbh);
+        if (bgfx::isValid(buffers.ibh)) bgfx::destroy(buffers.ibh);
+    }
+    m_meshBuffers.clear();
+
+    if (bgfx::isValid(m_meshInstancedProgram)) bgfx::destroy(m_meshInstancedProgram);
+    if (bgfx::isValid(m_meshProgram)) bgfx::destroy(m_meshProgram);
+    if (bgfx::isValid(m_program)) bgfx::destroy(m_program);
     bgfx::destroy(m_vbh);
-    bgfx::destroy(m_program);
     bgfx::shutdown();
 }
 
+void RendererBGFX::uploadMesh(const Mesh& mesh)
+{
+    getMeshBuffers(mesh);
+}
+
+void RendererBGFX::releaseMesh(const Mesh& mesh)
+{
+    auto it = m_meshBuffers.find(mesh.getId());
+    if (it == m_meshBuffers.end()) {
+        return;
+    }
+    if (bgfx::isValid(it->second.vbh)) bgfx::destroy(it->second.vbh);
+    if (bgfx::isValid(it->second.ibh)) bgfx::destroy(it->second.ibh);
+    m_meshBuffers.erase(it);
+}
+
+const RendererBGFX::MeshBuffers& RendererBGFX::getMeshBuffers(const Mesh& mesh)
+{
+    auto it = m_meshBuffers.find(mesh.getId());
+    if (it != m_meshBuffers.end()) {
+        return it->second;
+    }
+
+    MeshBuffers buffers;
+    buffers.bounds = mesh.getBounds();
+    const auto vertices = mesh.getVertices();
+    const auto indices = mesh.getIndices();
+    if (!vertices.empty() && !indices.empty()) {
+        buffers.vbh = bgfx::createVertexBuffer(
+            bgfx::copy(vertices.data(), static_cast<uint32_t>(vertices.size_bytes())),
+            m_meshLayout
+        );
+        buffers.ibh = bgfx::createIndexBuffer(
+            bgfx::copy(indices.data(), static_cast<uint32_t>(indices.size_bytes())),
+            BGFX_BUFFER_INDEX32
+        );
+    }
+    return m_meshBuffers.emplace(mesh.getId(), buffers).first->second;
+}
+
+const RendererBGFX::MeshBuffers* RendererBGFX::findMeshBuffers(const Mesh& mesh) const
+{
+    auto it = m_meshBuffers.find(mesh.getId());
+    return it != m_meshBuffers.end() ? &it->second : nullptr;
+}
+
+bool RendererBGFX::isVisible(const MeshBuffers& buffers, const glm::mat4& modelMatrix) const
+{
+    return m_frustum.intersects(buffers.bounds.transformed(modelMatrix));
+}
+
+void RendererBGFX::submitMesh(bgfx::Encoder* encoder, const MeshBuffers& buffers, const glm::mat4& modelMatrix)
+{
+    if (!bgfx::isValid(buffers.vbh)) {
+        return;
+    }
+
+    encoder->setTransform(glm::value_ptr(modelMatrix));
+    encoder->setVertexBuffer(0, buffers.vbh);
+    encoder->setIndexBuffer(buffers.ibh);
+    encoder->setState(BGFX_STATE_DEFAULT);
+    encoder->submit(kSceneView, m_meshProgram);
+}
+
 void RendererBGFX::drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix) {
-    // Placeholder implementation
-    std::cout << "Drawing mesh with " << mesh.getVertices().size() << " vertices." << std::endl;
-    // In a real implementation, this would involve loading mesh data,
-    // setting up different vertex/index buffers, and submitting a draw call.
+    const MeshBuffers& buffers = getMeshBuffers(mesh);
+    if (!isVisible(buffers, modelMatrix)) {
+        ++m_stats.culled;
+        return;
+    }
+    ++m_stats.visible;
+
+    // On the API thread this is the main encoder, so there is no locking.
+    bgfx::Encoder* encoder = bgfx::begin();
+    submitMesh(encoder, buffers, modelMatrix);
+    bgfx::end(encoder);
+}
+
+void RendererBGFX::recordParallel(JobSystem& jobs, uint32_t itemCount, const RecordFn& record)
+{
+    NYANCHU_PROFILE_SCOPE("RendererBGFX::recordParallel");
+    if (itemCount == 0) {
+        return;
+    }
+
+    const uint32_t sliceCount = std::min<uint32_t>({ jobs.getThreadCount(), m_maxThreadEncoders, itemCount });
+    const uint32_t sliceSize = (itemCount + sliceCount - 1) / sliceCount;
+
+    // Each slice counts into its own stats; they are merged after the join.
+    std::vector<RenderStats> sliceStats(sliceCount);
+
+    jobs.parallelFor(sliceCount, 1, [&](uint32_t sliceBegin, uint32_t sliceEnd) {
+        for (uint32_t slice = sliceBegin; slice < sliceEnd; ++slice) {
+            const uint32_t begin = slice * sliceSize;
+            const uint32_t end = std::min(itemCount, begin + sliceSize);
+            if (begin >= end) {
+                continue;
+            }
+
+            NYANCHU_PROFILE_SCOPE("RendererBGFX::recordSlice");
+            bgfx::Encoder* encoder = bgfx::begin(true);
+            if (encoder == nullptr) {
+                std::cerr << "No free bgfx encoder for parallel recording" << std::endl;
+                continue;
+            }
+            RenderEncoderBGFX renderEncoder(*this, encoder, m_sliceScratch[slice]);
+            record(renderEncoder, begin, end);
+            bgfx::end(encoder);
+            sliceStats[slice] = renderEncoder.m_stats;
+        }
+    });
+
+    for (const RenderStats& stats : sliceStats) {
+        m_stats.visible += stats.visible;
+        m_stats.culled += stats.culled;
+    }
+}
+
+RenderEncoderBGFX::RenderEncoderBGFX(RendererBGFX& renderer, bgfx::Encoder* encoder, InstanceScratch& scratch)
+    : m_renderer(renderer)
+    , m_encoder(encoder)
+    , m_scratch(scratch)
+{
+}
+
+void RenderEncoderBGFX::drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix)
+{
+    // Worker threads only read the buffer cache; uploads happen on the API thread.
+    const RendererBGFX::MeshBuffers* buffers = m_renderer.findMeshBuffers(mesh);
+    if (buffers == nullptr) {
+        return;
+    }
+    if (!m_renderer.isVisible(*buffers, modelMatrix)) {
+        ++m_stats.culled;
+        return;
+    }
+    ++m_stats.visible;
+    m_renderer.submitMesh(m_encoder, *buffers, modelMatrix);
+}
+
+void RenderEncoderBGFX::drawMeshInstanced(const Mesh& mesh, std::span<const glm::mat4> modelMatrices)
+{
+    const RendererBGFX::MeshBuffers* buffers = m_renderer.findMeshBuffers(mesh);
+    if (buffers == nullptr) {
+        return;
+    }
+    if ((bgfx::getCaps()->supported & BGFX_CAPS_INSTANCING) == 0) {
+        for (const glm::mat4& modelMatrix : modelMatrices) {
+            drawMesh(mesh, modelMatrix);
+        }
+        return;
+    }
+    m_renderer.submitMeshInstanced(m_encoder, *buffers, modelMatrices, m_scratch, m_stats);
+}
+
+void RendererBGFX::drawMeshInstanced(const Mesh& mesh, std::span<const glm::mat4> modelMatrices) {
+    NYANCHU_PROFILE_SCOPE("RendererBGFX::drawMeshInstanced");
+    if ((bgfx::getCaps()->supported & BGFX_CAPS_INSTANCING) == 0) {
+        for (const glm::mat4& modelMatrix : modelMatrices) {
+            drawMesh(mesh, modelMatrix);
+        }
+        return;
+    }
+
+    const MeshBuffers& buffers = getMeshBuffers(mesh);
+    bgfx::Encoder* encoder = bgfx::begin();
+    submitMeshInstanced(encoder, buffers, modelMatrices, m_instanceScratch, m_stats);
+    bgfx::end(encoder);
+}
+
+void RendererBGFX::submitMeshInstanced(bgfx::Encoder* encoder, const MeshBuffers& buffers,
+                                       std::span<const glm::mat4> modelMatrices, InstanceScratch& scratch,
+                                       RenderStats& stats)
+{
+    // Cull every instance in batches of eight, then pack the survivors.
+    const size_t count = modelMatrices.size();
+    scratch.bounds.resize(count);
+    scratch.visible.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        scratch.bounds[i] = buffers.bounds.transformed(modelMatrices[i]);
+    }
+    const uint32_t visibleCount = m_frustum.cull(scratch.bounds, scratch.visible);
+    stats.visible += visibleCount;
+    stats.culled += static_cast<uint32_t>(count) - visibleCount;
+
+    scratch.instances.clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (scratch.visible[i]) {
+            scratch.instances.push_back(modelMatrices[i]);
+        }
+    }
+    if (!bgfx::isValid(buffers.vbh)) {
+        return;
+    }
+    const std::span<const glm::mat4> visible = scratch.instances;
+
+    // Each instance carries its model matrix as four vec4s (i_data0..3).
+    constexpr uint16_t stride = sizeof(glm::mat4);
+    size_t offset = 0;
+    while (offset < visible.size()) {
+        const uint32_t wanted = static_cast<uint32_t>(std::min<size_t>(visible.size() - offset, UINT32_MAX));
+        // Only splits into several submits once the transient buffer for this frame runs short.
+        const uint32_t batch = bgfx::getAvailInstanceDataBuffer(wanted, stride);
+        if (batch == 0) {
+            break;
+        }
+
+        // Other encoders may take space between the check and the
+        // allocation, so bgfx can grant fewer instances than asked for.
+        bgfx::InstanceDataBuffer idb;
+        bgfx::allocInstanceDataBuffer(&idb, batch, stride);
+        if (idb.num == 0) {
+            break;
+        }
+        std::memcpy(idb.data, visible.data() + offset, size_t(idb.num) * stride);
+
+        encoder->setVertexBuffer(0, buffers.vbh);
+        encoder->setIndexBuffer(buffers.ibh);
+        encoder->setInstanceDataBuffer(&idb);
+        encoder->setState(BGFX_STATE_DEFAULT);
+        encoder->submit(kSceneView, m_meshInstancedProgram);
+
+        offset += idb.num;
+    }
 }
 
 void RendererBGFX::drawCube(const glm::mat4& modelMatrix) {
@@ -157,16 +443,34 @@ void RendererBGFX::drawCube(const glm::mat4& modelMatrix) {
 }
 
 void RendererBGFX::beginFrame(const Camera& camera) {
-    (void)camera; // Unused in this placeholder
-    // Placeholder
+    NYANCHU_PROFILE_SCOPE("RendererBGFX::beginFrame");
+    const bool homogeneousDepth = bgfx::getCaps()->homogeneousDepth;
+    const glm::mat4 view = camera.getViewMatrix();
+    const glm::mat4 proj = camera.getProjectionMatrix(homogeneousDepth);
+    bgfx::setViewTransform(kSceneView, glm::value_ptr(view), glm::value_ptr(proj));
+
+    m_frustum = Frustum(proj * view, homogeneousDepth);
+    m_stats = {};
+
+    // Make sure the scene view is cleared even when nothing is drawn.
+    bgfx::touch(kSceneView);
 }
 
 void RendererBGFX::endFrame() {
-    // Placeholder
+    render();
 }
 
 void RendererBGFX::resize(uint32_t width, uint32_t height) {
-    // Placeholder
+    m_width = width;
+    m_height = height;
+    bgfx::reset(width, height, BGFX_RESET_VSYNC);
+
+    bgfx::setViewRect(kSceneView, 0, 0, (uint16_t)width, (uint16_t)height);
+    bgfx::setViewRect(kOverlayView, 0, 0, (uint16_t)width, (uint16_t)height);
+
+    float orthoProjection[16];
+    bx::mtxOrtho(orthoProjection, 0.0f, (float)width, (float)height, 0.0f, 0.0f, 100.0f, 0.0f, bgfx::getCaps()->homogeneousDepth);
+    bgfx::setViewTransform(kOverlayView, nullptr, orthoProjection);
 }
 
 
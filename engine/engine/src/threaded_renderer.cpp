@@ -0,0 +1,308 @@
+#include "nyanchu/threaded_renderer.h"
+#include "nyanchu/job_system.h"
+#include "nyanchu/profiler.h"
+
+#include <algorithm>
+
+namespace nyanchu {
+
+void ThreadedRenderer::FrameData::CommandList::clear()
+{
+    commands.clear();
+    matrices.clear();
+}
+
+void ThreadedRenderer::FrameData::CommandList::add(CommandType type, const Mesh* mesh, std::span<const glm::mat4> modelMatrices)
+{
+    commands.push_back({ type, mesh, mesh ? mesh->getId() : 0, static_cast<uint32_t>(matrices.size()),
+                         static_cast<uint32_t>(modelMatrices.size()) });
+    matrices.insert(matrices.end(), modelMatrices.begin(), modelMatrices.end());
+}
+
+void ThreadedRenderer::FrameData::CommandList::remove(const Mesh& mesh)
+{
+    // By id, so commands queued before the mesh was moved go too.
+    commands.erase(std::remove_if(commands.begin(), commands.end(),
+                                  [&](const Command& command) { return command.meshId == mesh.getId(); }),
+                   commands.end());
+}
+
+void ThreadedRenderer::FrameData::clear()
+{
+    draws.clear();
+    for (uint32_t i = 0; i < usedSlices; ++i) {
+        slices[i].clear();
+    }
+    usedSlices = 0;
+    batches.clear();
+    resized = false;
+}
+
+// Appends one slice's draws to its command list; runs on a job system thread.
+class ThreadedRenderer::SliceEncoder final : public RenderEncoder
+{
+public:
+    explicit SliceEncoder(FrameData::CommandList& list) : m_list(list) {}
+
+    void drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix) override
+    {
+        m_list.add(FrameData::CommandType::Mesh, &mesh, { &modelMatrix, 1 });
+    }
+
+    void drawMeshInstanced(const Mesh& mesh, std::span<const glm::mat4> modelMatrices) override
+    {
+        m_list.add(FrameData::CommandType::MeshInstanced, &mesh, modelMatrices);
+    }
+
+private:
+    FrameData::CommandList& m_list;
+};
+
+ThreadedRenderer::ThreadedRenderer(std::unique_ptr<IRenderer> renderer)
+    : m_renderer(std::move(renderer))
+{
+}
+
+ThreadedRenderer::~ThreadedRenderer()
+{
+    if (m_thread.joinable()) {
+        shutdown();
+    }
+}
+
+bool ThreadedRenderer::initialize(GLFWwindow* window, uint32_t width, uint32_t height)
+{
+    m_quit = false;
+    m_thread = std::thread(&ThreadedRenderer::renderLoop, this);
+
+    bool initialized = false;
+    runOnRenderThread([&] { initialized = m_renderer->initialize(window, width, height); });
+    if (!initialized) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+    return initialized;
+}
+
+void ThreadedRenderer::shutdown()
+{
+    if (!m_thread.joinable()) {
+        return;
+    }
+    runOnRenderThread([&] { m_renderer->shutdown(); });
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+    m_frames[0].clear();
+    m_frames[1].clear();
+}
+
+void ThreadedRenderer::beginFrame(const Camera& camera)
+{
+    recording().camera = camera;
+}
+
+void ThreadedRenderer::endFrame()
+{
+    NYANCHU_PROFILE_SCOPE("ThreadedRenderer::endFrame");
+    if (!m_thread.joinable()) {
+        recording().clear();
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        {
+            NYANCHU_PROFILE_SCOPE("ThreadedRenderer::waitForRender");
+            waitForIdle(lock);
+        }
+        // The render thread is idle, so its renderer can be read here.
+        m_stats = m_renderer->getStats();
+        m_submitted = &recording();
+        m_recordIndex ^= 1;
+    }
+    m_cv.notify_all();
+
+    // This buffer held the frame that just finished rendering.
+    recording().clear();
+}
+
+void ThreadedRenderer::uploadMesh(const Mesh& mesh)
+{
+    recording().draws.add(FrameData::CommandType::Upload, &mesh, {});
+}
+
+void ThreadedRenderer::releaseMesh(const Mesh& mesh)
+{
+    FrameData& frame = recording();
+    frame.draws.remove(mesh);
+    for (uint32_t i = 0; i < frame.usedSlices; ++i) {
+        frame.slices[i].remove(mesh);
+    }
+    if (m_thread.joinable()) {
+        runOnRenderThread([&] { m_renderer->releaseMesh(mesh); });
+    }
+}
+
+void ThreadedRenderer::drawMesh(const Mesh& mesh, const glm::mat4& modelMatrix)
+{
+    recording().draws.add(FrameData::CommandType::Mesh, &mesh, { &modelMatrix, 1 });
+}
+
+void ThreadedRenderer::drawMeshInstanced(const Mesh& mesh, std::span<const glm::mat4> modelMatrices)
+{
+    recording().draws.add(FrameData::CommandType::MeshInstanced, &mesh, modelMatrices);
+}
+
+void ThreadedRenderer::drawTriangle()
+{
+    recording().draws.add(FrameData::CommandType::Triangle, nullptr, {});
+}
+
+void ThreadedRenderer::drawCube(const glm::mat4& modelMatrix)
+{
+    recording().draws.add(FrameData::CommandType::Cube, nullptr, { &modelMatrix, 1 });
+}
+
+void ThreadedRenderer::resize(uint32_t width, uint32_t height)
+{
+    FrameData& frame = recording();
+    frame.resized = true;
+    frame.width = width;
+    frame.height = height;
+}
+
+void ThreadedRenderer::recordParallel(JobSystem& jobs, uint32_t itemCount, const RecordFn& record)
+{
+    NYANCHU_PROFILE_SCOPE("ThreadedRenderer::recordParallel");
+    if (itemCount == 0) {
+        return;
+    }
+
+    FrameData& frame = recording();
+    const uint32_t sliceCount = std::min(jobs.getThreadCount(), itemCount);
+    const uint32_t sliceSize = (itemCount + sliceCount - 1) / sliceCount;
+    const uint32_t firstSlice = frame.usedSlices;
+    frame.usedSlices += sliceCount;
+    if (frame.slices.size() < frame.usedSlices) {
+        frame.slices.resize(frame.usedSlices);
+    }
+
+    jobs.parallelFor(sliceCount, 1, [&](uint32_t sliceBegin, uint32_t sliceEnd) {
+        for (uint32_t slice = sliceBegin; slice < sliceEnd; ++slice) {
+            const uint32_t begin = slice * sliceSize;
+            const uint32_t end = std::min(itemCount, begin + sliceSize);
+            if (begin < end) {
+                SliceEncoder encoder(frame.slices[firstSlice + slice]);
+                record(encoder, begin, end);
+            }
+        }
+    });
+
+    frame.draws.commands.push_back({ FrameData::CommandType::Parallel, nullptr, 0,
+                                     static_cast<uint32_t>(frame.batches.size()), 0 });
+    frame.batches.push_back({ &jobs, firstSlice, sliceCount });
+}
+
+void ThreadedRenderer::renderLoop()
+{
+    Profiler::setThreadName("Render");
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_cv.wait(lock, [&] { return m_task != nullptr || m_submitted != nullptr || m_quit; });
+
+        if (m_task != nullptr) {
+            const std::function<void()>* task = m_task;
+            lock.unlock();
+            (*task)();
+            lock.lock();
+            m_task = nullptr;
+        } else if (m_submitted != nullptr) {
+            FrameData* frame = m_submitted;
+            lock.unlock();
+            renderFrame(*frame);
+            lock.lock();
+            m_submitted = nullptr;
+        } else {
+            return;
+        }
+        m_cv.notify_all();
+    }
+}
+
+void ThreadedRenderer::renderFrame(FrameData& frame)
+{
+    NYANCHU_PROFILE_SCOPE("ThreadedRenderer::renderFrame");
+    if (frame.resized) {
+        m_renderer->resize(frame.width, frame.height);
+    }
+    m_renderer->beginFrame(frame.camera);
+
+    for (const FrameData::Command& command : frame.draws.commands) {
+        const std::span<const glm::mat4> matrices(frame.draws.matrices.data() + command.firstMatrix, command.matrixCount);
+        switch (command.type) {
+        case FrameData::CommandType::Upload:
+            m_renderer->uploadMesh(*command.mesh);
+            break;
+        case FrameData::CommandType::Mesh:
+            m_renderer->drawMesh(*command.mesh, matrices[0]);
+            break;
+        case FrameData::CommandType::MeshInstanced:
+            m_renderer->drawMeshInstanced(*command.mesh, matrices);
+            break;
+        case FrameData::CommandType::Triangle:
+            m_renderer->drawTriangle();
+            break;
+        case FrameData::CommandType::Cube:
+            m_renderer->drawCube(matrices[0]);
+            break;
+        case FrameData::CommandType::Parallel: {
+            const FrameData::ParallelBatch& batch = frame.batches[command.firstMatrix];
+            m_renderer->recordParallel(*batch.jobs, batch.sliceCount, [&](RenderEncoder& encoder, uint32_t begin, uint32_t end) {
+                for (uint32_t slice = begin; slice < end; ++slice) {
+                    replaySlice(frame.slices[batch.firstSlice + slice], encoder);
+                }
+            });
+            break;
+        }
+        }
+    }
+
+    m_renderer->endFrame();
+}
+
+void ThreadedRenderer::replaySlice(const FrameData::CommandList& slice, RenderEncoder& encoder)
+{
+    // Slices only ever hold mesh draws; see SliceEncoder.
+    for (const FrameData::Command& command : slice.commands) {
+        const std::span<const glm::mat4> matrices(slice.matrices.data() + command.firstMatrix, command.matrixCount);
+        if (command.type == FrameData::CommandType::MeshInstanced) {
+            encoder.drawMeshInstanced(*command.mesh, matrices);
+        } else {
+            encoder.drawMesh(*command.mesh, matrices[0]);
+        }
+    }
+}
+
+void ThreadedRenderer::waitForIdle(std::unique_lock<std::mutex>& lock)
+{
+    m_cv.wait(lock, [&] { return m_task == nullptr && m_submitted == nullptr; });
+}
+
+void ThreadedRenderer::runOnRenderThread(const std::function<void()>& task)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    waitForIdle(lock);
+    m_task = &task;
+    m_cv.notify_all();
+    waitForIdle(lock);
+}
+
+} // namespace nyanchu
@@ -0,0 +1,428 @@
+#include "nyanchu/triangle_bvh.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define NYANCHU_BVH_SSE 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define NYANCHU_BVH_NEON 1
+#endif
+
+namespace nyanchu {
+
+namespace {
+
+constexpr uint32_t kBlockWidth = 4;
+constexpr uint32_t kLeafTriangles = kBlockWidth;
+constexpr uint32_t kBins = 16;
+// Below this depth nodes are split at the centroid median instead of by
+// SAH, which caps the depth (and the traversal stack) at about 32 + log2(n).
+constexpr uint32_t kMaxSahDepth = 32;
+// Rays this close to parallel with a triangle's plane miss it.
+constexpr float kDetEpsilon = 1e-20f;
+// Barycentric slack so rays through an edge shared by two triangles cannot
+// slip between them to rounding.
+constexpr float kEdgeEpsilon = 1e-5f;
+
+// Four-wide float operations for the ray-triangle kernel.
+#if NYANCHU_BVH_SSE
+using Float4 = __m128;
+using Mask4 = __m128;
+inline Float4 load(const float* p) { return _mm_load_ps(p); }
+inline Float4 splat(float x) { return _mm_set1_ps(x); }
+inline Float4 add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+inline Float4 sub(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+inline Float4 mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+inline Float4 div(Float4 a, Float4 b) { return _mm_div_ps(a, b); }
+inline Float4 absolute(Float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline Mask4 greater(Float4 a, Float4 b) { return _mm_cmpgt_ps(a, b); }
+inline Mask4 greaterEqual(Float4 a, Float4 b) { return _mm_cmpge_ps(a, b); }
+inline Mask4 less(Float4 a, Float4 b) { return _mm_cmplt_ps(a, b); }
+inline Mask4 lessEqual(Float4 a, Float4 b) { return _mm_cmple_ps(a, b); }
+inline Mask4 both(Mask4 a, Mask4 b) { return _mm_and_ps(a, b); }
+inline int laneBits(Mask4 m) { return _mm_movemask_ps(m); }
+inline void store(float* p, Float4 a) { _mm_storeu_ps(p, a); }
+#elif NYANCHU_BVH_NEON
+using Float4 = float32x4_t;
+using Mask4 = uint32x4_t;
+inline Float4 load(const float* p) { return vld1q_f32(p); }
+inline Float4 splat(float x) { return vdupq_n_f32(x); }
+inline Float4 add(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+inline Float4 sub(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+inline Float4 mul(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+inline Float4 div(Float4 a, Float4 b) { return vdivq_f32(a, b); }
+inline Float4 absolute(Float4 a) { return vabsq_f32(a); }
+inline Mask4 greater(Float4 a, Float4 b) { return vcgtq_f32(a, b); }
+inline Mask4 greaterEqual(Float4 a, Float4 b) { return vcgeq_f32(a, b); }
+inline Mask4 less(Float4 a, Float4 b) { return vcltq_f32(a, b); }
+inline Mask4 lessEqual(Float4 a, Float4 b) { return vcleq_f32(a, b); }
+inline Mask4 both(Mask4 a, Mask4 b) { return vandq_u32(a, b); }
+inline int laneBits(Mask4 m) {
+    static const uint32_t bits[4] = { 1, 2, 4, 8 };
+    return static_cast<int>(vaddvq_u32(vandq_u32(m, vld1q_u32(bits))));
+}
+inline void store(float* p, Float4 a) { vst1q_f32(p, a); }
+#else
+struct Float4 { float v[4]; };
+struct Mask4 { bool v[4]; };
+template <typename Op>
+inline Float4 lanes(Float4 a, Float4 b, Op op) {
+    return { { op(a.v[0], b.v[0]), op(a.v[1], b.v[1]), op(a.v[2], b.v[2]), op(a.v[3], b.v[3]) } };
+}
+template <typename Op>
+inline Mask4 compare(Float4 a, Float4 b, Op op) {
+    return { { op(a.v[0], b.v[0]), op(a.v[1], b.v[1]), op(a.v[2], b.v[2]), op(a.v[3], b.v[3]) } };
+}
+inline Float4 load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+inline Float4 splat(float x) { return { { x, x, x, x } }; }
+inline Float4 add(Float4 a, Float4 b) { return lanes(a, b, [](float x, float y) { return x + y; }); }
+inline Float4 sub(Float4 a, Float4 b) { return lanes(a, b, [](float x, float y) { return x - y; }); }
+inline Float4 mul(Float4 a, Float4 b) { return lanes(a, b, [](float x, float y) { return x * y; }); }
+inline Float4 div(Float4 a, Float4 b) { return lanes(a, b, [](float x, float y) { return x / y; }); }
+inline Float4 absolute(Float4 a) { return lanes(a, a, [](float x, float) { return std::abs(x); }); }
+inline Mask4 greater(Float4 a, Float4 b) { return compare(a, b, [](float x, float y) { return x > y; }); }
+inline Mask4 greaterEqual(Float4 a, Float4 b) { return compare(a, b, [](float x, float y) { return x >= y; }); }
+inline Mask4 less(Float4 a, Float4 b) { return compare(a, b, [](float x, float y) { return x < y; }); }
+inline Mask4 lessEqual(Float4 a, Float4 b) { return compare(a, b, [](float x, float y) { return x <= y; }); }
+inline Mask4 both(Mask4 a, Mask4 b) { return { { a.v[0] && b.v[0], a.v[1] && b.v[1], a.v[2] && b.v[2], a.v[3] && b.v[3] } }; }
+inline int laneBits(Mask4 m) { return (m.v[0] ? 1 : 0) | (m.v[1] ? 2 : 0) | (m.v[2] ? 4 : 0) | (m.v[3] ? 8 : 0); }
+inline void store(float* p, Float4 a) { std::copy_n(a.v, 4, p); }
+#endif
+
+// Möller-Trumbore against the four triangles of a block. Writes each lane's
+// t, u and v and returns a bit per lane that hits within [0, maxDistance).
+int intersectBlock(const TriangleBVH::Block& block, const Ray& ray, float maxDistance, float t[4], float u[4], float v[4]) {
+    const Float4 dx = splat(ray.direction.x), dy = splat(ray.direction.y), dz = splat(ray.direction.z);
+    const Float4 e1x = load(block.e1[0]), e1y = load(block.e1[1]), e1z = load(block.e1[2]);
+    const Float4 e2x = load(block.e2[0]), e2y = load(block.e2[1]), e2z = load(block.e2[2]);
+
+    // p = d x e2, det = e1 . p
+    const Float4 px = sub(mul(dy, e2z), mul(dz, e2y));
+    const Float4 py = sub(mul(dz, e2x), mul(dx, e2z));
+    const Float4 pz = sub(mul(dx, e2y), mul(dy, e2x));
+    const Float4 det = add(add(mul(e1x, px), mul(e1y, py)), mul(e1z, pz));
+    const Float4 inverseDet = div(splat(1.0f), det);
+
+    // s = o - v0, u = (s . p) / det
+    const Float4 sx = sub(splat(ray.origin.x), load(block.v0[0]));
+    const Float4 sy = sub(splat(ray.origin.y), load(block.v0[1]));
+    const Float4 sz = sub(splat(ray.origin.z), load(block.v0[2]));
+    const Float4 uu = mul(add(add(mul(sx, px), mul(sy, py)), mul(sz, pz)), inverseDet);
+
+    // q = s x e1, v = (d . q) / det, t = (e2 . q) / det
+    const Float4 qx = sub(mul(sy, e1z), mul(sz, e1y));
+    const Float4 qy = sub(mul(sz, e1x), mul(sx, e1z));
+    const Float4 qz = sub(mul(sx, e1y), mul(sy, e1x));
+    const Float4 vv = mul(add(add(mul(dx, qx), mul(dy, qy)), mul(dz, qz)), inverseDet);
+    const Float4 tt = mul(add(add(mul(e2x, qx), mul(e2y, qy)), mul(e2z, qz)), inverseDet);
+
+    const Float4 slack = splat(-kEdgeEpsilon);
+    Mask4 hit = greater(absolute(det), splat(kDetEpsilon));
+    hit = both(hit, greaterEqual(uu, slack));
+    hit = both(hit, greaterEqual(vv, slack));
+    hit = both(hit, lessEqual(add(uu, vv), splat(1.0f + kEdgeEpsilon)));
+    hit = both(hit, greaterEqual(tt, splat(0.0f)));
+    hit = both(hit, less(tt, splat(maxDistance)));
+
+    store(t, tt);
+    store(u, uu);
+    store(v, vv);
+    return laneBits(hit);
+}
+
+AABB nodeBounds(const TriangleBVH::Node& node) {
+    return { glm::vec3(node.min[0], node.min[1], node.min[2]), glm::vec3(node.max[0], node.max[1], node.max[2]) };
+}
+
+AABB emptyBounds() {
+    return { glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max()) };
+}
+
+} // namespace
+
+TriangleBVH TriangleBVH::build(std::span<const glm::vec3> positions, std::span<const uint32_t> indices) {
+    TriangleBVH bvh;
+    const uint32_t count = static_cast<uint32_t>(indices.size() / 3);
+    if (count == 0) {
+        return bvh;
+    }
+
+    std::vector<AABB> bounds(count);
+    std::vector<glm::vec3> centroids(count);
+    std::vector<uint32_t> order(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const glm::vec3& a = positions[indices[3 * i + 0]];
+        const glm::vec3& b = positions[indices[3 * i + 1]];
+        const glm::vec3& c = positions[indices[3 * i + 2]];
+        bounds[i] = { glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c)) };
+        centroids[i] = (a + b + c) * (1.0f / 3.0f);
+        order[i] = i;
+    }
+
+    std::vector<Node>& nodes = bvh.m_nodes;
+    std::vector<Block>& blocks = bvh.m_blocks;
+    nodes.reserve(2 * (count / kLeafTriangles) + 1);
+    blocks.reserve(count / kBlockWidth + 1);
+
+    struct Range {
+        uint32_t node, begin, end, depth;
+    };
+    std::vector<Range> pending;
+    nodes.emplace_back();
+    pending.push_back({ 0, 0, count, 0 });
+
+    while (!pending.empty()) {
+        const Range range = pending.back();
+        pending.pop_back();
+
+        AABB box = emptyBounds();
+        AABB centroidBox = emptyBounds();
+        for (uint32_t i = range.begin; i < range.end; ++i) {
+            box = AABB::merge(box, bounds[order[i]]);
+            centroidBox.min = glm::min(centroidBox.min, centroids[order[i]]);
+            centroidBox.max = glm::max(centroidBox.max, centroids[order[i]]);
+        }
+        Node& node = nodes[range.node];
+        for (int c = 0; c < 3; ++c) {
+            node.min[c] = box.min[c];
+            node.max[c] = box.max[c];
+        }
+
+        const uint32_t triangles = range.end - range.begin;
+        const glm::vec3 spread = centroidBox.max - centroidBox.min;
+        const bool splittable = spread.x > 0.0f || spread.y > 0.0f || spread.z > 0.0f;
+        if (triangles <= kLeafTriangles || !splittable) {
+            // Leaf: pack the triangles four to a block.
+            node.first = static_cast<uint32_t>(blocks.size());
+            node.count = (triangles + kBlockWidth - 1) / kBlockWidth;
+            for (uint32_t i = range.begin; i < range.end; i += kBlockWidth) {
+                Block& block = blocks.emplace_back(); // zeroed lanes are degenerate
+                std::fill_n(block.triangle, kBlockWidth, std::numeric_limits<uint32_t>::max());
+                for (uint32_t lane = 0; lane < kBlockWidth && i + lane < range.end; ++lane) {
+                    const uint32_t triangle = order[i + lane];
+                    const glm::vec3& a = positions[indices[3 * triangle + 0]];
+                    const glm::vec3 e1 = positions[indices[3 * triangle + 1]] - a;
+                    const glm::vec3 e2 = positions[indices[3 * triangle + 2]] - a;
+                    for (int c = 0; c < 3; ++c) {
+                        block.v0[c][lane] = a[c];
+                        block.e1[c][lane] = e1[c];
+                        block.e2[c][lane] = e2[c];
+                    }
+                    block.triangle[lane] = triangle;
+                }
+            }
+            continue;
+        }
+
+        // Binned SAH: cost of a split is each side's surface area times its
+        // triangle count; try kBins - 1 planes on every axis.
+        int bestAxis = -1;
+        uint32_t bestSplit = 0;
+        if (range.depth < kMaxSahDepth) {
+            float bestCost = std::numeric_limits<float>::max();
+            for (int axis = 0; axis < 3; ++axis) {
+                if (spread[axis] <= 0.0f) continue;
+                AABB binBounds[kBins];
+                uint32_t binCounts[kBins] = {};
+                std::fill_n(binBounds, kBins, emptyBounds());
+                const float scale = kBins / spread[axis];
+                for (uint32_t i = range.begin; i < range.end; ++i) {
+                    const uint32_t t = order[i];
+                    const uint32_t bin = std::min(kBins - 1, static_cast<uint32_t>((centroids[t][axis] - centroidBox.min[axis]) * scale));
+                    binBounds[bin] = AABB::merge(binBounds[bin], bounds[t]);
+                    ++binCounts[bin];
+                }
+
+                float rightCost[kBins];
+                AABB accumulated = emptyBounds();
+                uint32_t accumulatedCount = 0;
+                for (uint32_t bin = kBins - 1; bin > 0; --bin) {
+                    accumulated = AABB::merge(accumulated, binBounds[bin]);
+                    accumulatedCount += binCounts[bin];
+                    rightCost[bin] = accumulatedCount > 0 ? accumulated.surfaceArea() * accumulatedCount : 0.0f;
+                }
+                accumulated = emptyBounds();
+                accumulatedCount = 0;
+                for (uint32_t split = 1; split < kBins; ++split) {
+                    accumulated = AABB::merge(accumulated, binBounds[split - 1]);
+                    accumulatedCount += binCounts[split - 1];
+                    if (accumulatedCount == 0 || accumulatedCount == triangles) continue;
+                    const float cost = accumulated.surfaceArea() * accumulatedCount + rightCost[split];
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = split;
+                    }
+                }
+            }
+        }
+
+        auto first = order.begin() + range.begin;
+        auto last = order.begin() + range.end;
+        auto middle = first;
+        if (bestAxis >= 0) {
+            const float scale = kBins / spread[bestAxis];
+            const float low = centroidBox.min[bestAxis];
+            middle = std::partition(first, last, [&](uint32_t t) {
+                return std::min(kBins - 1, static_cast<uint32_t>((centroids[t][bestAxis] - low) * scale)) < bestSplit;
+            });
+        }
+        if (middle == first || middle == last) {
+            // Median split along the widest centroid axis.
+            const int axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : (spread.y >= spread.z ? 1 : 2);
+            middle = first + triangles / 2;
+            std::nth_element(first, middle, last, [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        }
+
+        const uint32_t left = static_cast<uint32_t>(nodes.size());
+        const uint32_t split = static_cast<uint32_t>(middle - order.begin());
+        nodes[range.node].first = left;
+        nodes[range.node].count = 0;
+        nodes.emplace_back();
+        nodes.emplace_back();
+        pending.push_back({ left + 1, split, range.end, range.depth + 1 });
+        pending.push_back({ left, range.begin, split, range.depth + 1 });
+    }
+
+    bvh.m_nodeView = bvh.m_nodes;
+    bvh.m_blockView = bvh.m_blocks;
+    return bvh;
+}
+
+TriangleBVH TriangleBVH::view(std::span<const Node> nodes, std::span<const Block> blocks) {
+    TriangleBVH bvh;
+    bvh.m_nodeView = nodes;
+    bvh.m_blockView = blocks;
+    return bvh;
+}
+
+bool TriangleBVH::validate(std::span<const Node> nodes, std::span<const Block> blocks, uint32_t triangleCount) {
+    if (nodes.empty()) {
+        return blocks.empty();
+    }
+
+    // build() appends children after their parent, so one forward pass sees
+    // every node's depth before its children and no path can cycle.
+    std::vector<uint32_t> depth(nodes.size(), 0);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const Node& node = nodes[i];
+        if (node.count == 0) {
+            if (node.first <= i || uint64_t(node.first) + 1 >= nodes.size()) {
+                return false;
+            }
+            // Traversal holds at most one pending sibling per ancestor plus both children.
+            if (depth[i] + 2 > uint32_t(kStackSize)) {
+                return false;
+            }
+            depth[node.first] = depth[i] + 1;
+            depth[node.first + 1] = depth[i] + 1;
+            continue;
+        }
+        if (uint64_t(node.first) + node.count > blocks.size()) {
+            return false;
+        }
+    }
+
+    for (const Block& block : blocks) {
+        for (uint32_t lane = 0; lane < kBlockWidth; ++lane) {
+            if (block.triangle[lane] < triangleCount) {
+                continue;
+            }
+            // Unused lanes must stay degenerate, or a ray could hit a triangle that is not there.
+            if (block.triangle[lane] != std::numeric_limits<uint32_t>::max()) {
+                return false;
+            }
+            for (int c = 0; c < 3; ++c) {
+                if (block.e1[c][lane] != 0.0f || block.e2[c][lane] != 0.0f) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool TriangleBVH::raycast(const Ray& ray, float maxDistance, MeshHit& hit) const {
+    if (m_nodeView.empty()) {
+        return false;
+    }
+    const glm::vec3 inverseDirection = 1.0f / ray.direction;
+    float entry;
+    if (!intersectRay(ray.origin, inverseDirection, nodeBounds(m_nodeView[0]), maxDistance, entry)) {
+        return false;
+    }
+
+    uint32_t stack[kStackSize];
+    float stackEntry[kStackSize];
+    int count = 0;
+    // Built and validated trees never fill the stack; anything deeper is
+    // skipped rather than written past it.
+    auto push = [&](uint32_t node, float nodeEntry) {
+        if (count < kStackSize) {
+            stack[count] = node;
+            stackEntry[count++] = nodeEntry;
+        }
+    };
+    push(0, entry);
+
+    const Block* hitBlock = nullptr;
+    uint32_t hitLane = 0;
+    while (count > 0) {
+        --count;
+        if (stackEntry[count] > maxDistance) {
+            continue;
+        }
+        const Node& node = m_nodeView[stack[count]];
+
+        if (node.count > 0) {
+            for (uint32_t b = node.first; b < node.first + node.count; ++b) {
+                float t[4], u[4], v[4];
+                int lanes = intersectBlock(m_blockView[b], ray, maxDistance, t, u, v);
+                while (lanes != 0) {
+                    const int lane = std::countr_zero(static_cast<unsigned>(lanes));
+                    lanes &= lanes - 1;
+                    if (t[lane] < maxDistance) {
+                        maxDistance = t[lane];
+                        hit.distance = t[lane];
+                        hit.u = u[lane];
+                        hit.v = v[lane];
+                        hitBlock = &m_blockView[b];
+                        hitLane = static_cast<uint32_t>(lane);
+                    }
+                }
+            }
+            continue;
+        }
+
+        float near, far;
+        const bool hitLeft = intersectRay(ray.origin, inverseDirection, nodeBounds(m_nodeView[node.first]), maxDistance, near);
+        const bool hitRight = intersectRay(ray.origin, inverseDirection, nodeBounds(m_nodeView[node.first + 1]), maxDistance, far);
+        // Visit the nearer child first so its hits clip the other.
+        if (hitLeft && hitRight) {
+            const bool leftFirst = near <= far;
+            push(node.first + (leftFirst ? 1 : 0), leftFirst ? far : near);
+            push(node.first + (leftFirst ? 0 : 1), leftFirst ? near : far);
+        } else if (hitLeft) {
+            push(node.first, near);
+        } else if (hitRight) {
+            push(node.first + 1, far);
+        }
+    }
+
+    if (hitBlock == nullptr) {
+        return false;
+    }
+    hit.triangle = hitBlock->triangle[hitLane];
+    const glm::vec3 e1(hitBlock->e1[0][hitLane], hitBlock->e1[1][hitLane], hitBlock->e1[2][hitLane]);
+    const glm::vec3 e2(hitBlock->e2[0][hitLane], hitBlock->e2[1][hitLane], hitBlock->e2[2][hitLane]);
+    const glm::vec3 normal = glm::normalize(glm::cross(e1, e2));
+    hit.normal = glm::dot(normal, ray.direction) > 0.0f ? -normal : normal;
+    return true;
+}
+
+} // namespace nyanchu
@@ -0,0 +1,42 @@
+#include "nyanchu/vertex_welder.h"
+
+namespace nyanchu {
+
+namespace {
+
+// Keep the load factor at or below 3/4.
+size_t capacityFor(size_t count) {
+    size_t capacity = 16;
+    while (capacity * 3 < count * 4) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+} // namespace
+
+VertexWelder::VertexWelder(size_t expectedVertices) {
+    const size_t capacity = capacityFor(expectedVertices);
+    m_slots.assign(capacity, Slot{ 0, kEmpty });
+    m_mask = capacity - 1;
+    m_growAt = capacity * 3 / 4;
+}
+
+void VertexWelder::grow() {
+    const size_t capacity = (m_mask + 1) * 2;
+    std::vector<Slot> old(capacity, Slot{ 0, kEmpty });
+    old.swap(m_slots);
+    m_mask = capacity - 1;
+    m_growAt = capacity * 3 / 4;
+
+    for (const Slot& s : old) {
+        if (s.index == kEmpty) continue;
+        size_t slot = static_cast<size_t>(hashVertex(m_vertices[s.index])) & m_mask;
+        while (m_slots[slot].index != kEmpty) {
+            slot = (slot + 1) & m_mask;
+        }
+        m_slots[slot] = s;
+    }
+}
+
+} // namespace nyanchu